@@ -0,0 +1,444 @@
+// Parameter sweep over libconveyor configurations and workloads.
+//
+// Every combination of the list-valued options below is run once, against
+// either a simulated backend (per-op latency, jitter and a shared bandwidth
+// cap) or a real file, and reported as one JSON object or CSV row:
+//
+//   conveyor_bench_suite [--backend=sim|file] [--path=conveyor_bench.dat]
+//                        [--block=4K,64K] [--buffer=1M,8M] [--threads=1,4]
+//                        [--read-pct=0,50] [--seek-pct=0,1] [--instances=1]
+//                        [--total=8M] [--latency-us=200] [--jitter-us=0]
+//                        [--bandwidth-mbs=0] [--format=json|csv]
+//
+// --total is the data moved per instance, split across its threads. With
+// one thread the workload uses conveyor_read/conveyor_write and moves the
+// file position with conveyor_lseek; with more, each thread works through
+// its own region with conveyor_pread/conveyor_pwrite. --seek-pct is the
+// chance, per operation, of jumping to a random block first.
+//
+// Results: throughput over the whole run including the final flush,
+// p50/p99/p999/max of each call as the application saw it, and process CPU
+// time (user + system) per byte moved.
+
+#include "libconveyor/conveyor.h"
+#include "libconveyor/detail/latency_histogram.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <sys/resource.h>
+#include <unistd.h>
+#define CONVEYOR_BENCH_HAVE_FILE 1
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// --- Options ---
+
+struct Options {
+    std::string backend = "sim";
+    std::string path = "conveyor_bench.dat";
+    std::vector<size_t> block = {4096, 65536};
+    std::vector<size_t> buffer = {1 << 20, 8 << 20};
+    std::vector<size_t> threads = {1, 4};
+    std::vector<size_t> read_pct = {0, 50};
+    std::vector<size_t> seek_pct = {0, 1};
+    std::vector<size_t> instances = {1};
+    size_t total = 8 << 20;
+    size_t latency_us = 200;
+    size_t jitter_us = 0;
+    size_t bandwidth_mbs = 0; // 0: unlimited
+    std::string format = "json";
+};
+
+// "4096", "64K", "8M" or "1G".
+bool parse_size(const std::string& s, size_t& out) {
+    char* end = nullptr;
+    unsigned long long v = std::strtoull(s.c_str(), &end, 10);
+    if (end == s.c_str()) return false;
+    switch (*end) {
+    case 'k': case 'K': v <<= 10; end++; break;
+    case 'm': case 'M': v <<= 20; end++; break;
+    case 'g': case 'G': v <<= 30; end++; break;
+    default: break;
+    }
+    if (*end != '\0') return false;
+    out = static_cast<size_t>(v);
+    return true;
+}
+
+bool parse_list(const std::string& s, std::vector<size_t>& out) {
+    out.clear();
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t comma = s.find(',', pos);
+        if (comma == std::string::npos) comma = s.size();
+        size_t v;
+        if (!parse_size(s.substr(pos, comma - pos), v)) return false;
+        out.push_back(v);
+        pos = comma + 1;
+    }
+    return !out.empty();
+}
+
+bool parse_options(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) return false;
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        bool ok = true;
+        if (key == "backend") o.backend = value;
+        else if (key == "path") o.path = value;
+        else if (key == "format") o.format = value;
+        else if (key == "block") ok = parse_list(value, o.block);
+        else if (key == "buffer") ok = parse_list(value, o.buffer);
+        else if (key == "threads") ok = parse_list(value, o.threads);
+        else if (key == "read-pct") ok = parse_list(value, o.read_pct);
+        else if (key == "seek-pct") ok = parse_list(value, o.seek_pct);
+        else if (key == "instances") ok = parse_list(value, o.instances);
+        else if (key == "total") ok = parse_size(value, o.total);
+        else if (key == "latency-us") ok = parse_size(value, o.latency_us);
+        else if (key == "jitter-us") ok = parse_size(value, o.jitter_us);
+        else if (key == "bandwidth-mbs") ok = parse_size(value, o.bandwidth_mbs);
+        else ok = false;
+        if (!ok) return false;
+    }
+    if (o.backend == "file") {
+#ifndef CONVEYOR_BENCH_HAVE_FILE
+        return false;
+#endif
+        o.latency_us = o.jitter_us = o.bandwidth_mbs = 0; // Not simulated
+    }
+    return (o.backend == "sim" || o.backend == "file") &&
+           (o.format == "json" || o.format == "csv");
+}
+
+// --- Simulated backend ---
+
+// An in-memory file behind a link with a fixed per-op latency, random
+// jitter and a bandwidth cap. Transfers are serialized on the link, so
+// concurrent operations share the bandwidth the way they would on a NIC.
+struct SimBackend {
+    std::chrono::microseconds latency{0};
+    size_t jitter_us = 0;
+    double bytes_per_us = 0; // 0: unlimited
+
+    std::mutex mutex;
+    std::vector<char> data;
+    Clock::time_point link_free{};
+
+    void delay(size_t bytes) {
+        Clock::time_point ready = Clock::now();
+        if (bytes_per_us > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            link_free = std::max(link_free, ready) +
+                        std::chrono::microseconds(static_cast<int64_t>(bytes / bytes_per_us));
+            ready = link_free;
+        }
+        ready += latency;
+        if (jitter_us > 0) {
+            thread_local std::minstd_rand rng(std::random_device{}());
+            ready += std::chrono::microseconds(rng() % jitter_us);
+        }
+        std::this_thread::sleep_until(ready);
+    }
+};
+
+ssize_t sim_pwrite(storage_handle_t h, const void* buf, size_t count, off_t offset) {
+    SimBackend* b = static_cast<SimBackend*>(h);
+    b->delay(count);
+    std::lock_guard<std::mutex> lock(b->mutex);
+    size_t end = static_cast<size_t>(offset) + count;
+    if (b->data.size() < end) b->data.resize(end);
+    std::memcpy(b->data.data() + offset, buf, count);
+    return static_cast<ssize_t>(count);
+}
+
+ssize_t sim_pread(storage_handle_t h, void* buf, size_t count, off_t offset) {
+    SimBackend* b = static_cast<SimBackend*>(h);
+    b->delay(count);
+    std::lock_guard<std::mutex> lock(b->mutex);
+    if (static_cast<size_t>(offset) >= b->data.size()) return 0;
+    size_t n = std::min(count, b->data.size() - static_cast<size_t>(offset));
+    std::memcpy(buf, b->data.data() + offset, n);
+    return static_cast<ssize_t>(n);
+}
+
+off_t sim_lseek(storage_handle_t h, off_t offset, int whence) {
+    SimBackend* b = static_cast<SimBackend*>(h);
+    if (whence == SEEK_END) {
+        std::lock_guard<std::mutex> lock(b->mutex);
+        return static_cast<off_t>(b->data.size()) + offset;
+    }
+    return offset; // SEEK_CUR is resolved by the conveyor
+}
+
+// --- Real file backend ---
+
+#ifdef CONVEYOR_BENCH_HAVE_FILE
+int fd_of(storage_handle_t h) { return static_cast<int>(reinterpret_cast<intptr_t>(h)); }
+
+ssize_t file_pwrite(storage_handle_t h, const void* buf, size_t count, off_t offset) {
+    return ::pwrite(fd_of(h), buf, count, offset);
+}
+
+ssize_t file_pread(storage_handle_t h, void* buf, size_t count, off_t offset) {
+    return ::pread(fd_of(h), buf, count, offset);
+}
+
+off_t file_lseek(storage_handle_t h, off_t offset, int whence) {
+    return ::lseek(fd_of(h), offset, whence);
+}
+#endif
+
+// --- Measurement ---
+
+double cpu_seconds() {
+#ifdef CONVEYOR_BENCH_HAVE_FILE
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+           (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+#else
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+struct Scenario {
+    size_t block, buffer, threads, read_pct, seek_pct, instances;
+};
+
+struct Result {
+    size_t ops = 0;
+    size_t bytes = 0;
+    double seconds = 0;
+    double throughput_mbs = 0;
+    double p50_us = 0, p99_us = 0, p999_us = 0, max_us = 0;
+    double cpu_ns_per_byte = 0;
+    int errors = 0;
+};
+
+// One conveyor with its backend.
+struct Instance {
+    std::unique_ptr<SimBackend> sim;
+    int fd = -1;
+    conveyor_t* conv = nullptr;
+};
+
+bool open_instance(const Options& o, const Scenario& s, size_t index, Instance& inst) {
+    conveyor_config_t cfg = {0};
+    cfg.flags = O_RDWR;
+    cfg.initial_write_size = s.buffer;
+    cfg.initial_read_size = s.buffer;
+    cfg.max_write_size = s.buffer;
+    cfg.max_read_size = s.buffer;
+
+    // Preload the region so reads find data.
+    std::vector<char> fill(o.total, 'x');
+    if (o.backend == "sim") {
+        inst.sim.reset(new SimBackend());
+        inst.sim->latency = std::chrono::microseconds(o.latency_us);
+        inst.sim->jitter_us = o.jitter_us;
+        inst.sim->bytes_per_us = o.bandwidth_mbs * 1048576.0 / 1e6;
+        inst.sim->data = fill;
+        cfg.handle = inst.sim.get();
+        cfg.ops = {sim_pwrite, sim_pread, sim_lseek};
+    } else {
+#ifdef CONVEYOR_BENCH_HAVE_FILE
+        std::string path = o.path + "." + std::to_string(index);
+        inst.fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (inst.fd < 0) return false;
+        ::unlink(path.c_str()); // Gone once closed
+        if (::pwrite(inst.fd, fill.data(), fill.size(), 0) != static_cast<ssize_t>(fill.size()))
+            return false;
+        cfg.handle = reinterpret_cast<storage_handle_t>(static_cast<intptr_t>(inst.fd));
+        cfg.ops = {file_pwrite, file_pread, file_lseek};
+#endif
+    }
+    (void)index;
+    inst.conv = conveyor_create(&cfg);
+    return inst.conv != nullptr;
+}
+
+void close_instance(Instance& inst) {
+    if (inst.conv) conveyor_destroy(inst.conv);
+#ifdef CONVEYOR_BENCH_HAVE_FILE
+    if (inst.fd >= 0) ::close(inst.fd);
+#endif
+}
+
+// One thread's share of an instance: 'ops' operations within
+// [base, base + span).
+void run_worker(conveyor_t* conv, const Scenario& s, size_t ops, off_t base, size_t span,
+                unsigned seed, libconveyor::LatencyHistogram& latency,
+                std::atomic<size_t>& bytes, std::atomic<int>& errors) {
+    std::minstd_rand rng(seed);
+    std::vector<char> buf(s.block, 'w');
+    size_t blocks = std::max<size_t>(span / s.block, 1);
+    bool positional = s.threads > 1;
+    size_t cursor = 0; // Block index within the region
+    size_t moved = 0;
+    for (size_t i = 0; i < ops; i++) {
+        if (s.seek_pct > 0 && rng() % 100 < s.seek_pct) {
+            cursor = rng() % blocks;
+            if (!positional) conveyor_lseek(conv, base + static_cast<off_t>(cursor * s.block), SEEK_SET);
+        } else if (cursor >= blocks) {
+            cursor = 0;
+            if (!positional) conveyor_lseek(conv, base, SEEK_SET);
+        }
+        off_t off = base + static_cast<off_t>(cursor * s.block);
+        bool read = rng() % 100 < s.read_pct;
+
+        Clock::time_point start = Clock::now();
+        ssize_t n;
+        if (positional)
+            n = read ? conveyor_pread(conv, buf.data(), s.block, off)
+                     : conveyor_pwrite(conv, buf.data(), s.block, off);
+        else
+            n = read ? conveyor_read(conv, buf.data(), s.block)
+                     : conveyor_write(conv, buf.data(), s.block);
+        latency.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()));
+
+        if (n < 0) {
+            errors++;
+            return;
+        }
+        moved += static_cast<size_t>(n);
+        cursor++;
+    }
+    bytes += moved;
+}
+
+Result run_scenario(const Options& o, const Scenario& s) {
+    Result r;
+    std::vector<Instance> instances(s.instances);
+    for (size_t i = 0; i < s.instances; i++) {
+        if (!open_instance(o, s, i, instances[i])) {
+            r.errors++;
+            for (auto& inst : instances) close_instance(inst);
+            return r;
+        }
+    }
+
+    size_t ops_per_thread = std::max<size_t>(o.total / s.block / s.threads, 1);
+    size_t span = o.total / s.threads;
+    libconveyor::LatencyHistogram latency;
+    std::atomic<size_t> bytes{0};
+    std::atomic<int> errors{0};
+
+    double cpu_start = cpu_seconds();
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < s.instances; i++) {
+        for (size_t t = 0; t < s.threads; t++) {
+            workers.emplace_back(run_worker, instances[i].conv, std::cref(s), ops_per_thread,
+                                 static_cast<off_t>(t * span), span,
+                                 static_cast<unsigned>(i * 1000 + t + 1), std::ref(latency),
+                                 std::ref(bytes), std::ref(errors));
+        }
+    }
+    for (auto& w : workers) w.join();
+    for (auto& inst : instances) {
+        if (conveyor_flush(inst.conv) != 0) errors++;
+    }
+    r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double cpu = cpu_seconds() - cpu_start;
+    for (auto& inst : instances) close_instance(inst);
+
+    libconveyor::LatencyHistogram::Snapshot snap;
+    latency.take(snap);
+    r.ops = snap.count;
+    r.bytes = bytes.load();
+    r.errors = errors.load();
+    r.throughput_mbs = r.seconds > 0 ? r.bytes / 1048576.0 / r.seconds : 0;
+    r.p50_us = snap.percentile(0.50) / 1e3;
+    r.p99_us = snap.percentile(0.99) / 1e3;
+    r.p999_us = snap.percentile(0.999) / 1e3;
+    r.max_us = snap.max / 1e3;
+    r.cpu_ns_per_byte = r.bytes > 0 ? cpu * 1e9 / r.bytes : 0;
+    return r;
+}
+
+// --- Output ---
+
+void print_csv_header() {
+    std::printf("backend,block,buffer,threads,read_pct,seek_pct,instances,latency_us,jitter_us,"
+                "bandwidth_mbs,ops,bytes,seconds,throughput_mbs,p50_us,p99_us,p999_us,max_us,"
+                "cpu_ns_per_byte,errors\n");
+}
+
+void print_result(const Options& o, const Scenario& s, const Result& r, bool first) {
+    if (o.format == "csv") {
+        std::printf("%s,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%.6f,%.3f,%.3f,%.3f,%.3f,%.3f,"
+                    "%.4f,%d\n",
+                    o.backend.c_str(), s.block, s.buffer, s.threads, s.read_pct, s.seek_pct,
+                    s.instances, o.latency_us, o.jitter_us, o.bandwidth_mbs, r.ops, r.bytes,
+                    r.seconds, r.throughput_mbs, r.p50_us, r.p99_us, r.p999_us, r.max_us,
+                    r.cpu_ns_per_byte, r.errors);
+        return;
+    }
+    std::printf("%s  {\"backend\": \"%s\", \"block\": %zu, \"buffer\": %zu, \"threads\": %zu, "
+                "\"read_pct\": %zu, \"seek_pct\": %zu, \"instances\": %zu, \"latency_us\": %zu, "
+                "\"jitter_us\": %zu, \"bandwidth_mbs\": %zu, \"ops\": %zu, \"bytes\": %zu, "
+                "\"seconds\": %.6f, \"throughput_mbs\": %.3f, \"p50_us\": %.3f, "
+                "\"p99_us\": %.3f, \"p999_us\": %.3f, \"max_us\": %.3f, "
+                "\"cpu_ns_per_byte\": %.4f, \"errors\": %d}",
+                first ? "" : ",\n", o.backend.c_str(), s.block, s.buffer, s.threads, s.read_pct,
+                s.seek_pct, s.instances, o.latency_us, o.jitter_us, o.bandwidth_mbs, r.ops,
+                r.bytes, r.seconds, r.throughput_mbs, r.p50_us, r.p99_us, r.p999_us, r.max_us,
+                r.cpu_ns_per_byte, r.errors);
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parse_options(argc, argv, o)) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--backend=sim|file] [--path=FILE] [--block=LIST] [--buffer=LIST]"
+                     " [--threads=LIST] [--read-pct=LIST] [--seek-pct=LIST]"
+                     " [--instances=LIST] [--total=SIZE] [--latency-us=N] [--jitter-us=N]"
+                     " [--bandwidth-mbs=N] [--format=json|csv]\n";
+        return 2;
+    }
+
+    if (o.format == "csv") print_csv_header();
+    else std::printf("[\n");
+    bool first = true;
+    int failures = 0;
+    for (size_t block : o.block)
+        for (size_t buffer : o.buffer)
+            for (size_t threads : o.threads)
+                for (size_t read_pct : o.read_pct)
+                    for (size_t seek_pct : o.seek_pct)
+                        for (size_t instances : o.instances) {
+                            if (block == 0 || threads == 0 || instances == 0 || block > buffer)
+                                continue;
+                            Scenario s{block, buffer, threads, read_pct, seek_pct, instances};
+                            Result r = run_scenario(o, s);
+                            failures += r.errors;
+                            print_result(o, s, r, first);
+                            first = false;
+                        }
+    if (o.format == "json") std::printf("\n]\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+#ifndef LIBCONVEYOR_CODECS_H
+#define LIBCONVEYOR_CODECS_H
+
+#include "libconveyor/conveyor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Built-in codecs for conveyor_config_t::codec, available when the library
+// was built against liblz4 / libzstd. Each fills 'codec' and returns 0, or
+// returns -1 with errno set to ENOSYS when built without that library.
+
+// LZ4: fast enough to keep up with local disks, ~2x on typical data.
+int conveyor_codec_lz4(conveyor_codec_t* codec);
+
+// Zstandard at 'level' (1-22; 0 = the library default, 3). Packs tighter
+// than LZ4 for bandwidth-bound backends at some CPU cost.
+int conveyor_codec_zstd(int level, conveyor_codec_t* codec);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // LIBCONVEYOR_CODECS_H
@@ -30,12 +30,86 @@ extern "C" {
 // Opaque handle to the conveyor object
 typedef struct conveyor_t conveyor_t;
 
+// Opaque handle to a pool of worker threads that can be shared by many
+// conveyors (see conveyor_config_t::executor).
+typedef struct conveyor_executor_t conveyor_executor_t;
+
+// Scatter/gather element. Layout-compatible with POSIX struct iovec so the
+// array can be handed straight to ::pwritev/::preadv.
+typedef struct {
+    void*  iov_base;
+    size_t iov_len;
+} conveyor_iovec_t;
+
+// One entry of conveyor_submit_batch: 'len' bytes from 'buf' to 'offset'.
+// 'result' is filled in by the call: 'len' once the entry is queued, or -1
+// with the errno in 'error'.
+typedef struct {
+    off_t       offset;
+    const void* buf;
+    size_t      len;
+    ssize_t     result;
+    int         error;
+} conveyor_io_t;
+
+// Asynchronous backend interface (see storage_operations_t::submit). Each
+// conveyor drives two independent queues, one per direction, each from a
+// single thread.
+#define CONVEYOR_QUEUE_WRITE 0
+#define CONVEYOR_QUEUE_READ  1
+#define CONVEYOR_OP_WRITE 0
+#define CONVEYOR_OP_READ  1
+
+typedef struct {
+    unsigned long long user_data; // As passed to submit
+    ssize_t result;               // Bytes transferred, or -errno
+} conveyor_completion_t;
+
 // Represents the underlying storage handle
 // Callbacks for the library to interact with the real storage
 typedef struct {
     ssize_t (*pwrite)(storage_handle_t, const void*, size_t, off_t);
     ssize_t (*pread)(storage_handle_t, void*, size_t, off_t);
     off_t   (*lseek)(storage_handle_t, off_t, int);
+    // Optional. When set, the write worker hands the (up to two) ring buffer
+    // segments of a write straight to the backend instead of copying them
+    // into a scratch buffer first. May return a short count like pwrite.
+    ssize_t (*pwritev)(storage_handle_t, const conveyor_iovec_t*, int, off_t);
+    // Optional, set both or neither. With them, one worker per direction
+    // keeps up to write_queue_depth / read_ahead_depth operations in flight
+    // instead of blocking a thread per operation. submit(h, queue, op, iov,
+    // iovcnt, offset, user_data) queues a vectored read or write (the iovec
+    // array stays valid until its completion is reaped) and returns 0, or -1
+    // with errno. reap(h, queue, out, max, min) sends everything queued on
+    // that queue and waits until at least 'min' completions are available,
+    // storing up to 'max' of them; returns the count, or -1 with errno. A
+    // failed reap sets the sticky error, but what is in flight stays in
+    // flight (its buffers untouched) and reap is retried until it has all
+    // completed, which conveyor_destroy waits for.
+    int (*submit)(storage_handle_t, int, int, const conveyor_iovec_t*, int,
+                  off_t, unsigned long long);
+    int (*reap)(storage_handle_t, int, conveyor_completion_t*, int, int);
+    // Optional. Makes everything written so far durable (fsync/fdatasync);
+    // returns 0, or -1 with errno. Used by conveyor_fsync and
+    // conveyor_fsync_async, which share one call among all barriers that
+    // are ready together.
+    int (*fsync)(storage_handle_t);
+    // Optional, for storage that is memory-mapped (see conveyor_mmap_open).
+    // map(h, offset, count, &data) points 'data' at the bytes at 'offset' and
+    // returns how many of the 'count' are there (fewer at the end of the
+    // file, 0 past it), or -1 with errno; they must stay addressable until
+    // the handle is closed. With it the conveyor keeps no read buffer and
+    // starts no read workers: reads copy straight from the mapping and
+    // conveyor_read_acquire lends it out. advise(h, offset, count), also
+    // optional, stands in for read-ahead: sequential reads pass it the
+    // max_read_size bytes ahead of them, once per half window, so the
+    // backend can start loading them (madvise MADV_WILLNEED).
+    ssize_t (*map)(storage_handle_t, off_t, size_t, const void**);
+    int (*advise)(storage_handle_t, off_t, size_t);
+    // Optional. Sets the size of the storage (ftruncate); returns 0, or -1
+    // with errno. Under direct_io_block_size it trims the zero padding that
+    // block-sized writes leave past the end of the file.
+    int (*truncate)(storage_handle_t, off_t);
 } storage_operations_t;
 
 // Statistics structure for observability
@@ -51,10 +125,203 @@ typedef struct {
     // Congestion events in the last window
     size_t write_buffer_full_events;
 
+    // Reads in the last window served entirely from buffered data (read
+    // cache, read-ahead or prefetch) versus ones that waited for storage
+    size_t read_hits;
+    size_t read_misses;
+
+    // Bytes of pending writes in the last window that a newer write covered
+    // before they were issued, and so never reached storage (write_absorb)
+    size_t bytes_absorbed;
+
+    // Backend operations in the last window that waited for a rate limit
+    // (conveyor_config_t::rate_limit or conveyor_set_rate_limit), and the
+    // total time they waited
+    size_t throttled_ops;
+    size_t throttle_wait_ms;
+
     // Persistent sticky error code
     int last_error_code;
 } conveyor_stats_t;
 
+// Latency distribution of one kind of operation over a stats window, in
+// nanoseconds. Percentiles are accurate to within about 3%; max is exact.
+typedef struct {
+    unsigned long long count;
+    unsigned long long p50_ns;
+    unsigned long long p99_ns;
+    unsigned long long p999_ns;
+    unsigned long long max_ns;
+} conveyor_latency_t;
+
+// conveyor_stats_t plus latency percentiles for the same window
+typedef struct {
+    conveyor_stats_t basic;
+
+    // Each storage operation issued by the workers (or by a read that
+    // bypassed the buffers)
+    conveyor_latency_t backend_write;
+    conveyor_latency_t backend_read;
+
+    // conveyor_write/conveyor_pwrite and conveyor_read/conveyor_pread as the
+    // caller saw them, from entry to return
+    conveyor_latency_t write_call;
+    conveyor_latency_t read_call;
+} conveyor_stats_ex_t;
+
+// Cumulative metrics (conveyor_get_metrics). Counters only ever grow, from
+// the conveyor's creation on, so any number of scrapers can read them and
+// take their own differences; gauges are live values. Later versions only
+// append fields and raise CONVEYOR_METRICS_VERSION.
+#define CONVEYOR_METRICS_VERSION 1
+
+typedef struct {
+    unsigned int version; // CONVEYOR_METRICS_VERSION of the library
+
+    // Counters: bytes accepted by writes and returned by reads
+    unsigned long long bytes_written;
+    unsigned long long bytes_read;
+    // Backend operations the workers (or an unbuffered read) completed, and
+    // the total time they took
+    unsigned long long backend_writes;
+    unsigned long long backend_write_ns;
+    unsigned long long backend_reads;
+    unsigned long long backend_read_ns;
+    unsigned long long write_buffer_full_events;
+    // Reads served entirely from buffered data versus not, in calls and bytes
+    unsigned long long read_hits;
+    unsigned long long read_misses;
+    unsigned long long read_hit_bytes;
+    unsigned long long read_miss_bytes;
+    // Bytes reads took from writes still pending in the write buffer
+    unsigned long long snoop_patched_bytes;
+    unsigned long long bytes_absorbed;
+    // Times buffered read-ahead was discarded (a seek away, a shrink)
+    unsigned long long read_invalidations;
+    // Times each buffer grew or shrank
+    unsigned long long write_resizes;
+    unsigned long long read_resizes;
+    // conveyor_flush calls and flush/fsync barriers, and the total time from
+    // each one's start to its completion
+    unsigned long long flushes;
+    unsigned long long flush_wait_ns;
+    unsigned long long throttled_ops;
+    unsigned long long throttle_wait_ns;
+
+    // Gauges: buffer capacity and bytes held, and writes queued
+    unsigned long long write_capacity;
+    unsigned long long write_buffered;
+    unsigned long long write_queue_depth;
+    unsigned long long read_capacity;
+    unsigned long long read_buffered;
+    int last_error_code;
+} conveyor_metrics_t;
+
+// Points on the I/O path that can be traced. A *_BEGIN/*_END pair is
+// recorded on the thread that started and finished the operation
+// respectively; the *_END record carries its duration.
+typedef enum {
+    CONVEYOR_TRACE_ENQUEUE,             // A write joined the queue (offset, bytes)
+    CONVEYOR_TRACE_DEQUEUE,             // A batch left the queue for the backend
+    CONVEYOR_TRACE_BACKEND_WRITE_BEGIN, // Storage write issued (offset, bytes)
+    CONVEYOR_TRACE_BACKEND_WRITE_END,
+    CONVEYOR_TRACE_BACKEND_READ_BEGIN,  // Storage read issued (offset, bytes)
+    CONVEYOR_TRACE_BACKEND_READ_END,
+    CONVEYOR_TRACE_WRITE_RESIZE,        // Write buffer resized (bytes = new capacity)
+    CONVEYOR_TRACE_READ_RESIZE,         // Read buffer resized (bytes = new capacity)
+    CONVEYOR_TRACE_GROW_WAIT_BEGIN,     // A write waits for the queue before growing
+    CONVEYOR_TRACE_GROW_WAIT_END,
+    CONVEYOR_TRACE_BACKPRESSURE_BEGIN,  // A write waits for buffer space (bytes)
+    CONVEYOR_TRACE_BACKPRESSURE_END,
+    CONVEYOR_TRACE_INVALIDATE,          // Read-ahead discarded; restarts at offset
+    CONVEYOR_TRACE_FLUSH_BEGIN,         // conveyor_flush waits for the queue
+    CONVEYOR_TRACE_FLUSH_END,
+    CONVEYOR_TRACE_FSYNC_BEGIN,         // One group-commit fsync (bytes = barriers)
+    CONVEYOR_TRACE_FSYNC_END
+} conveyor_trace_event_t;
+
+typedef struct {
+    conveyor_trace_event_t event;
+    unsigned long long timestamp_ns; // Steady clock
+    unsigned long long duration_ns;  // *_END only: time since the *_BEGIN
+    off_t offset;
+    size_t bytes;
+    unsigned long long thread_id;    // Small per-process thread number
+} conveyor_trace_record_t;
+
+// Called synchronously on the thread where the event happens, possibly with
+// conveyor locks held: it must be quick and must not call back into the
+// conveyor.
+typedef void (*conveyor_trace_fn)(void* context, const conveyor_trace_record_t* record);
+
+// Pluggable block compressor (conveyor_config_t::codec). compress packs
+// src_len bytes into at most dst_cap bytes and returns the packed size, or
+// 0 when they do not fit (the block is then stored as is). decompress
+// unpacks into dst and returns the unpacked size. Both return -1 with errno
+// on failure, and may be called from several worker threads at once.
+typedef struct {
+    ssize_t (*compress)(void* context, const void* src, size_t src_len, void* dst, size_t dst_cap);
+    ssize_t (*decompress)(void* context, const void* src, size_t src_len, void* dst, size_t dst_cap);
+    void* context;
+} conveyor_codec_t;
+
+// Where a conveyor's worker threads run and its buffers live
+// (conveyor_config_t::placement, conveyor_executor_create_placed). Linux
+// only; elsewhere it is validated and otherwise ignored. Workers are pinned
+// to the cpu_count CPUs in 'cpus' (NULL = any CPU). With bind_numa_node,
+// buffer memory is preferably allocated on NUMA node 'numa_node' wherever
+// it is first touched, and when no CPUs are given, workers are pinned to
+// that node's CPUs.
+typedef struct {
+    const int* cpus;
+    size_t cpu_count;
+    int bind_numa_node;
+    int numa_node;
+} conveyor_placement_t;
+
+// Token-bucket limit on backend I/O (conveyor_config_t::rate_limit,
+// conveyor_set_rate_limit). Reads and writes draw on the same buckets of
+// bytes and of operations per second (0 = unlimited); each holds 100 ms
+// worth of its rate as burst. An operation larger than the burst still
+// passes once the bucket is full, and the debt delays the ones after it.
+typedef struct {
+    size_t bytes_per_sec;
+    size_t ops_per_sec;
+} conveyor_rate_limit_t;
+
+// Priority of a conveyor's backend I/O (conveyor_config_t::qos_class).
+// Under NORMAL, reads the application is waiting on (a pread that misses,
+// read-ahead a reader is blocked on) are foreground; write-behind and
+// speculative read-ahead are background. Foreground I/O is admitted first
+// by the rate limits and runs first on a shared executor. Under BACKGROUND
+// all of the conveyor's I/O is background (bulk ingest, scrubbing).
+#define CONVEYOR_QOS_NORMAL 0
+#define CONVEYOR_QOS_BACKGROUND 1
+
+// What conveyor_write does when the write buffer has no room
+// (conveyor_config_t::write_backpressure)
+#define CONVEYOR_BACKPRESSURE_BLOCK 0   // Wait for space, up to write_timeout_ms
+#define CONVEYOR_BACKPRESSURE_FAIL 1    // Fail with EAGAIN at once
+#define CONVEYOR_BACKPRESSURE_PARTIAL 2 // Take what fits; EAGAIN if nothing does
+
+// Fired once after a write was refused or came up short, as soon as buffer
+// space frees up (or a sticky error means it never will). Usually runs on a
+// worker thread, but it runs on the application's thread when that thread
+// frees the space or meets the error: inside conveyor_write_commit, a write
+// refused once a sticky error is set, or a call whose own I/O fails (such
+// as conveyor_fsync). Either way conveyor locks may be held, write_mutex
+// among them: it must not call back into the conveyor, only wake whoever
+// will retry.
+typedef void (*conveyor_writable_fn)(void* context);
+
+// Completion of conveyor_flush_async / conveyor_fsync_async. 'error' is 0,
+// or the errno that kept the writes (or the fsync) from completing. Runs on
+// a write worker, or on the thread that queued the barrier when nothing was
+// pending, with no conveyor locks held. It may write or queue barriers but
+// must not wait on the conveyor (conveyor_flush, conveyor_fsync,
+// conveyor_destroy, a blocking write).
+typedef void (*conveyor_flush_fn)(void* context, int error);
+
 // --- API Functions ---
 
 // Configuration for creating a conveyor instance
@@ -66,30 +333,281 @@ typedef struct {
     size_t initial_read_size;
     size_t max_write_size;
     size_t max_read_size;
+    // Upper bound on the bytes the write worker merges from file-contiguous
+    // pending writes into a single backend pwrite (0 disables coalescing).
+    size_t max_coalesce_size;
+    // Number of backend writes that may be in flight at once, each issued by
+    // its own write worker (0 or 1 = a single worker). Overlapping writes are
+    // never in flight together, and ring space is still retired in order.
+    size_t write_queue_depth;
+    // Read-ahead is split into preads of at most read_chunk_size bytes
+    // (0 = one pread for all free buffer space), with up to read_ahead_depth
+    // of them in flight (0 or 1 = one). Chunks are committed in file order.
+    size_t read_chunk_size;
+    size_t read_ahead_depth;
+    // Non-zero promises that conveyor_write, conveyor_pwrite, conveyor_flush
+    // and conveyor_lseek are only ever called from one thread at a time. Writes
+    // then reach the workers without locking in the common case.
+    int single_producer;
+    // Optional. When set, the conveyor starts no threads of its own and its
+    // read-ahead and write-behind run on this shared pool instead, with at
+    // most one read and one write in flight per conveyor (write_queue_depth
+    // and read_ahead_depth are then ignored). The executor must outlive
+    // every conveyor that uses it.
+    conveyor_executor_t* executor;
+    // Non-zero keeps the data already read in a cache of blocks of this size,
+    // up to max_read_size bytes on top of the read-ahead buffer.
+    // conveyor_read is then served from it at any offset, and conveyor_lseek
+    // only repositions instead of discarding what is buffered.
+    size_t read_cache_block_size;
+    // Non-zero lets a write supersede pending writes that lie entirely inside
+    // the range it covers and have not been issued yet: they are dropped
+    // instead of reaching storage, which saves the backend from writing
+    // every version of a frequently rewritten region (a header, an index).
+    // Reads still see the newest bytes. Ignored under O_APPEND.
+    int write_absorb;
+    // Non-zero asks for transparent huge pages on buffer storage of 2 MiB
+    // and up. Buffers always reserve room for max_write_size/max_read_size
+    // up front, but memory is only committed as they fill.
+    int huge_pages;
+    // Reclaim order under the memory budget (conveyor_set_memory_budget):
+    // capacity is taken back from lower priorities first, and never from a
+    // conveyor with a higher priority than the one that needs it.
+    int memory_priority;
+    // Non-zero shrinks buffers that have grown back to their initial sizes
+    // after this many milliseconds without reads or writes, dropping any
+    // buffered read-ahead. Done by the conveyor's own workers, so not on an
+    // executor, and not for the write buffer in single_producer mode.
+    unsigned int idle_shrink_ms;
+    // Tracing (see conveyor_trace_event_t). Each event goes to trace_callback
+    // when set, and into a log of the last trace_log_events records when that
+    // is non-zero, for conveyor_trace_read/conveyor_trace_export_chrome.
+    // With neither set, or in builds without LIBCONVEYOR_WITH_TRACING, a
+    // trace point costs at most one branch.
+    conveyor_trace_fn trace_callback;
+    void* trace_context;
+    size_t trace_log_events;
+    // Backpressure policy (CONVEYOR_BACKPRESSURE_*). Under the default,
+    // BLOCK, a write waits up to write_timeout_ms for space (0 = 30 s) and
+    // then fails with ETIMEDOUT. FAIL and PARTIAL never wait; PARTIAL also
+    // applies to conveyor_write_reserve, and lets a write larger than
+    // max_write_size take its first max_write_size bytes.
+    int write_backpressure;
+    unsigned int write_timeout_ms;
+    // Optional; see conveyor_writable_fn and conveyor_writable_fd.
+    conveyor_writable_fn writable_callback;
+    void* writable_context;
+    // Optional. Stores the file in codec_block_size blocks (0 = 64 KiB),
+    // each compressed on its own in a fixed slot, so any offset maps to its
+    // block by division. Compression runs wherever the backend I/O does (the
+    // workers, for buffered I/O); writes that cover part of a block read it
+    // back first. The asynchronous submit/reap ops are not used.
+    conveyor_codec_t codec;
+    size_t codec_block_size;
+    // Non-zero (a power of two up to 4096) is for a handle opened with
+    // O_DIRECT: every backend pread and pwrite is then aligned to this block
+    // size in offset, length and memory. Buffers and scratch memory are
+    // aligned to it, and read-ahead chunks end on block boundaries, so
+    // sequential traffic reaches storage untouched. Other requests go
+    // through aligned bounce buffers, and partial edge blocks are
+    // read-modify-written. The file is padded to a block boundary until
+    // the padding is trimmed with ops.truncate, when the backend has one.
+    // The asynchronous submit/reap ops and map are not used.
+    size_t direct_io_block_size;
+    // Optional; see conveyor_placement_t. Covers the conveyor's own worker
+    // threads and its write and read buffers; an executor's threads are
+    // placed by conveyor_executor_create_placed, so sharding the pool per
+    // node means one executor per node. Fails with EINVAL for a CPU or node
+    // this machine does not have.
+    conveyor_placement_t placement;
+    // Optional limit on this conveyor's backend I/O, on top of the process
+    // limit (conveyor_set_rate_limit). Throttled work waits before it is
+    // issued, on the worker (or, for foreground reads, the caller) that
+    // issues it; executor jobs are put back on the pool until their turn
+    // instead of holding a thread.
+    conveyor_rate_limit_t rate_limit;
+    int qos_class; // CONVEYOR_QOS_*
+    // Non-NULL: journal every buffered write to this file (memory-mapped;
+    // put it on fast local storage) before acknowledging it, and drop it
+    // again once it has reached the backend, so that writes still pending
+    // when the process dies can be replayed by conveyor_recover. Needs a
+    // write buffer and excludes O_APPEND (EINVAL), whose offsets are only
+    // resolved as writes are issued; single_producer staging is off. The
+    // journal holds journal_size bytes of records (0 = twice the largest
+    // write buffer) and writes wait for its space as they do for ring space.
+    // Each record is msynced before its write returns, so it survives a
+    // crash of the machine; journal_no_sync skips that, and records then
+    // only survive a crash of the process.
+    const char* journal_path;
+    size_t journal_size;
+    int journal_no_sync;
 } conveyor_config_t;
 
-// Creates a conveyor instance with the specified configuration
+// Creates a conveyor instance with the specified configuration. With a
+// journal_path that still holds unreplayed writes it fails with EEXIST:
+// call conveyor_recover first.
 conveyor_t* conveyor_create(const conveyor_config_t* cfg);
 
+// Replays the writes left in cfg->journal_path by a conveyor that did not
+// shut down cleanly, oldest first, at the offsets they were queued for,
+// through a conveyor made from 'cfg' without the journal (so codecs and
+// direct I/O apply as before). Once they are flushed (and fsynced, where
+// the backend can) the journal is emptied. Returns how many writes were
+// replayed (0 when there is no journal file), or -1 with errno; on failure
+// the journal is left as it was, and replaying again is harmless.
+ssize_t conveyor_recover(const conveyor_config_t* cfg);
+
 
 // Destroys the conveyor, flushing any remaining data in the write buffer
 void conveyor_destroy(conveyor_t* conv);
 
+// Creates a pool of num_threads worker threads that services the I/O of any
+// number of conveyors, taking turns between them.
+conveyor_executor_t* conveyor_executor_create(size_t num_threads);
+// As conveyor_executor_create, with the pool's threads pinned as 'placement'
+// says (NULL = unpinned). Fails with EINVAL as the config placement does.
+conveyor_executor_t* conveyor_executor_create_placed(size_t num_threads,
+                                                     const conveyor_placement_t* placement);
+// Stops and joins the pool. Destroy every conveyor using it first.
+void conveyor_executor_destroy(conveyor_executor_t* executor);
+// A process-wide pool with one thread per hardware thread, created on first
+// use and never destroyed.
+conveyor_executor_t* conveyor_executor_default(void);
+
+// Process-wide memory budget shared by all conveyors: 'bytes' caps the total
+// capacity of their buffers (0, the default, means no limit). A conveyor
+// always gets its initial sizes. Growing past them has to fit, first taking
+// capacity back from colder conveyors (lowest memory_priority, then least
+// recently used); otherwise the buffer keeps its size. Lowering the limit
+// reclaims from idle conveyors right away.
+void conveyor_set_memory_budget(size_t bytes);
+
+// Total buffer capacity currently held by all conveyors, in bytes.
+size_t conveyor_memory_in_use(void);
+
+// Process-wide limit on the backend I/O of all conveyors together, applied
+// on top of each one's own rate_limit. NULL (or zero rates) lifts it.
+void conveyor_set_rate_limit(const conveyor_rate_limit_t* limit);
+
 // POSIX-like I/O operations
 ssize_t conveyor_write(conveyor_t* conv, const void* buf, size_t count);
 ssize_t conveyor_read(conveyor_t* conv, void* buf, size_t count);
+
+// Positional I/O. Like pwrite(2)/pread(2): the data goes to or comes from
+// 'offset' and the conveyor's position is left alone. Neither one flushes:
+// conveyor_pwrite queues the write behind the others (under O_APPEND it
+// appends, as pwrite(2) does on Linux), and conveyor_pread is served from
+// the read cache and read-ahead where possible and from storage otherwise,
+// with pending writes applied. Both are safe to call from many threads.
+ssize_t conveyor_pwrite(conveyor_t* conv, const void* buf, size_t count,
+                        off_t offset);
+ssize_t conveyor_pread(conveyor_t* conv, void* buf, size_t count,
+                       off_t offset);
+
+// In-place write. Reserves 'count' bytes in the write buffer and returns them
+// as one or two writable segments, growing the buffer and applying
+// backpressure exactly like conveyor_write. Fill them, then call
+// conveyor_write_commit. Only one reservation may be outstanding; other
+// writes wait until it is committed (or, unless the policy is BLOCK, fail
+// with EAGAIN). Returns the bytes reserved, which under
+// CONVEYOR_BACKPRESSURE_PARTIAL may be fewer than 'count'.
+ssize_t conveyor_write_reserve(conveyor_t* conv, size_t count,
+                               conveyor_iovec_t segs[2], int* nsegs);
+// Queues the first 'count' reserved bytes (at most what was reserved) as a
+// write at the current position and ends the reservation. A count of 0
+// cancels it. Returns 'count'.
+ssize_t conveyor_write_commit(conveyor_t* conv, size_t count);
 off_t conveyor_lseek(conveyor_t* conv, off_t offset, int whence);
 
+// Gather write: queues the iovcnt buffers, in order, as a single write at
+// the current position (one lock acquisition, one request). Backpressure
+// applies to the total as it does to conveyor_write.
+ssize_t conveyor_writev(conveyor_t* conv, const conveyor_iovec_t* iov, int iovcnt);
+// Scatter read: fills the buffers in order from the current position, as
+// one conveyor_read of their total size would.
+ssize_t conveyor_readv(conveyor_t* conv, const conveyor_iovec_t* iov, int iovcnt);
+
+// Queues 'n' positional writes at once, as conveyor_pwrite would each, but
+// under one lock acquisition and without touching the file position. When
+// no two entries overlap they are queued in ascending offset order, so
+// adjacent ones coalesce into single backend writes (max_coalesce_size);
+// otherwise, and under O_APPEND, they keep their order. Every entry is
+// queued whole or not at all. Returns how many entries were queued, which
+// are reported in their 'result'; if that is fewer than 'n' errno says why
+// (-1 if none was).
+ssize_t conveyor_submit_batch(conveyor_t* conv, conveyor_io_t* ios, size_t n);
+
+// Zero-copy read. Lends out up to max_len bytes at the current position
+// directly from the read buffer, as one or two segments (two when the data
+// wraps the ring), blocking like conveyor_read until some data is buffered.
+// Returns the number of bytes lent; 0 (end of file, or max_len == 0) leaves
+// no view outstanding. Pending writes are applied to the lent bytes just as
+// conveyor_read would apply them. With a mapped backend (storage_operations_t
+// ::map) the view is the read-only mapping itself, in one segment, showing
+// later writes as they reach storage; while writes to the range are pending
+// it is a private copy instead.
+// Only one view may be outstanding; until it is released, conveyor_read,
+// conveyor_lseek and conveyor_read_acquire fail with EBUSY.
+ssize_t conveyor_read_acquire(conveyor_t* conv, size_t max_len,
+                              conveyor_iovec_t segs[2], int* nsegs);
+// Returns the view, consuming its first 'consumed' bytes (at most what was
+// acquired) and advancing the file position by that much. Unconsumed bytes
+// are handed out again by the next read.
+int conveyor_read_release(conveyor_t* conv, size_t consumed);
+
+// An eventfd that becomes readable whenever writable_callback would fire,
+// for poll/epoll loops. Created on first call and owned by the conveyor;
+// read it to reset. Fails with ENOSYS where eventfd is unavailable.
+int conveyor_writable_fd(conveyor_t* conv);
+
 // Forces a flush of the write-buffer to the underlying storage
 int conveyor_flush(conveyor_t* conv);
 
-// Retrieves the latest statistics, resetting the counters for the next window.
+// Non-blocking conveyor_flush: returns at once and calls 'callback' once
+// every write queued before the call has reached storage. Callbacks fire in
+// the order their barriers were queued. Fails only with EBADF or EINVAL (null
+// callback); write errors are passed to the callback.
+int conveyor_flush_async(conveyor_t* conv, conveyor_flush_fn callback, void* context);
+
+// As conveyor_flush_async, but the callback also waits for
+// storage_operations_t::fsync, which is called once for all barriers ready
+// at the same time (group commit). Without an fsync op this is a plain
+// asynchronous flush.
+int conveyor_fsync_async(conveyor_t* conv, conveyor_flush_fn callback, void* context);
+
+// Blocking conveyor_fsync_async.
+int conveyor_fsync(conveyor_t* conv);
+
+// Retrieves the latest statistics, resetting the counters (and latency
+// histograms) for the next window. Windows are per conveyor, so there should
+// be one caller; other consumers can use conveyor_get_metrics.
 int conveyor_get_stats(conveyor_t* conv, conveyor_stats_t* stats);
 
+// As conveyor_get_stats, adding latency percentiles for the window.
+int conveyor_get_stats_ex(conveyor_t* conv, conveyor_stats_ex_t* stats);
+
+// Fills the first 'size' bytes of 'metrics' (pass sizeof(conveyor_metrics_t))
+// without resetting anything. A caller built against an older, shorter
+// struct gets just the fields it knows; 'version' says which the library
+// has. Safe to call from any thread, concurrently with I/O.
+int conveyor_get_metrics(conveyor_t* conv, conveyor_metrics_t* metrics, size_t size);
+
+// Moves up to 'max' of the oldest records from the trace log into
+// 'records'. Returns how many were copied, or -1 (EINVAL without a log,
+// ENOSYS when tracing is compiled out).
+ssize_t conveyor_trace_read(conveyor_t* conv, conveyor_trace_record_t* records, size_t max);
+
+// Drains the trace log into 'path' in the Chrome trace event format, which
+// chrome://tracing and Perfetto load directly. Paired events become one
+// slice each. Errors as for conveyor_trace_read, plus those of writing.
+int conveyor_trace_export_chrome(conveyor_t* conv, const char* path);
+
 // Stops the worker threads without destroying the conveyor object
 void conveyor_stop(conveyor_t* conv);
 
-// Clears any sticky error code in the conveyor.
+// Clears any sticky error code in the conveyor. Fails with EBUSY in journal
+// mode once the journal has kept records of writes retired after the
+// error: destroy the conveyor and replay them with conveyor_recover.
 int conveyor_clear_error(conveyor_t* conv);
 
 } // End extern "C" block
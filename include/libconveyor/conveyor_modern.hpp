@@ -2,12 +2,19 @@
 #define LIBCONVEYOR_MODERN_HPP
 
 #include "libconveyor/conveyor.h"
+#include <algorithm> // std::min
 #include <array>
 #include <chrono> // std::chrono
+#include <cstdint>  // uint64_t
+#include <cstdio>   // std::snprintf
+#include <cstring>  // std::memcpy
+#include <future>   // std::future
+#include <initializer_list>
 #include <memory> // std::unique_ptr
 #include <string>
 #include <system_error> // std::error_code
 #include <type_traits>  // std::enable_if, std::void_t
+#include <utility>      // std::pair
 #include <variant>      // C++17
 #include <vector>
 
@@ -61,16 +68,252 @@ struct is_contiguous<T, std::void_t<decltype(std::data(std::declval<T>())),
                                     decltype(std::size(std::declval<T>()))>>
     : std::true_type {};
 
-// --- 3. Configuration Struct ---
+// --- 3. Span (Poor man's std::span) ---
+template <typename T> class Span {
+  T *data_ = nullptr;
+  size_t size_ = 0;
+
+public:
+  Span() = default;
+  Span(T *data, size_t size) : data_(data), size_(size) {}
+
+  T *data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  T &operator[](size_t i) const { return data_[i]; }
+  T *begin() const { return data_; }
+  T *end() const { return data_ + size_; }
+};
+
+// --- 4. Shared Worker Pool ---
+// Owns a conveyor_executor_t. Must outlive every Conveyor created with it.
+class Executor {
+  struct Deleter {
+    void operator()(conveyor_executor_t *ptr) const {
+      conveyor_executor_destroy(ptr);
+    }
+  };
+  std::unique_ptr<conveyor_executor_t, Deleter> impl_;
+
+public:
+  explicit Executor(conveyor_executor_t *raw) : impl_(raw) {}
+
+  static Result<Executor> create(size_t num_threads) {
+    conveyor_executor_t *raw = conveyor_executor_create(num_threads);
+    if (!raw) {
+      return std::error_code(errno, std::system_category());
+    }
+    return Executor(raw);
+  }
+
+  // A pool pinned per 'placement' (one per NUMA node shards the pool).
+  static Result<Executor> create(size_t num_threads,
+                                 const conveyor_placement_t &placement) {
+    conveyor_executor_t *raw =
+        conveyor_executor_create_placed(num_threads, &placement);
+    if (!raw) {
+      return std::error_code(errno, std::system_category());
+    }
+    return Executor(raw);
+  }
+
+  conveyor_executor_t *get() const { return impl_.get(); }
+};
+
+// Process-wide cap on the buffer capacity of all conveyors (0 = no limit);
+// see conveyor_set_memory_budget.
+inline void set_memory_budget(size_t bytes) { conveyor_set_memory_budget(bytes); }
+inline size_t memory_in_use() { return conveyor_memory_in_use(); }
+
+// Process-wide limit on backend I/O (zero rates = none); see
+// conveyor_set_rate_limit.
+inline void set_rate_limit(const conveyor_rate_limit_t &limit) {
+  conveyor_set_rate_limit(&limit);
+}
+
+// Priority of a conveyor's backend I/O (see CONVEYOR_QOS_*).
+enum class Qos { Normal = CONVEYOR_QOS_NORMAL, Background = CONVEYOR_QOS_BACKGROUND };
+
+// What a write does when the buffer is full (see CONVEYOR_BACKPRESSURE_*).
+enum class Backpressure {
+  Block = CONVEYOR_BACKPRESSURE_BLOCK,
+  Fail = CONVEYOR_BACKPRESSURE_FAIL,
+  Partial = CONVEYOR_BACKPRESSURE_PARTIAL
+};
+
+// --- 5. Configuration Struct ---
 struct Config {
   storage_handle_t handle;
   storage_operations_t ops;
   size_t write_capacity = 1024 * 1024;
   size_t read_capacity = 1024 * 1024;
+  size_t coalesce_limit = 0; // Max bytes per merged backend write (0 = off)
+  size_t write_queue_depth = 1; // Backend writes allowed in flight
+  size_t read_chunk_size = 0;   // Max bytes per read-ahead pread (0 = all)
+  size_t read_ahead_depth = 1;  // Read-ahead preads allowed in flight
+  bool single_producer = false; // Writes come from one thread (lock-free path)
+  conveyor_executor_t *executor = nullptr; // Shared worker pool (optional)
+  size_t read_cache_block_size = 0; // Random-access read cache (0 = off)
+  bool write_absorb = false; // Drop pending writes a newer write covers
+  bool huge_pages = false;   // Transparent huge pages for large buffers
+  int memory_priority = 0;   // Reclaimed later under the budget when higher
+  std::chrono::milliseconds idle_shrink{0}; // Shrink after idling (0 = never)
+  conveyor_trace_fn trace_callback = nullptr; // Called for every trace event
+  void *trace_context = nullptr;
+  size_t trace_log_events = 0; // Trace events kept for export (0 = none)
+  Backpressure backpressure = Backpressure::Block;
+  std::chrono::milliseconds write_timeout{0}; // Block limit (0 = 30 s)
+  conveyor_writable_fn writable_callback = nullptr; // Space freed after EAGAIN
+  void *writable_context = nullptr;
+  conveyor_codec_t codec{};    // Block compression (optional)
+  size_t codec_block_size = 0; // Bytes per compressed block (0 = 64 KiB)
+  size_t direct_io_block_size = 0; // O_DIRECT alignment (0 = buffered I/O)
+  conveyor_placement_t placement{}; // Worker CPUs and buffer NUMA node
+  conveyor_rate_limit_t rate_limit{}; // Backend bytes/ops per second (0 = any)
+  Qos qos = Qos::Normal;
+  std::string journal_path; // Crash-safe write-behind journal (empty = none)
+  size_t journal_size = 0;  // Record space (0 = twice write_capacity)
+  bool journal_no_sync = false; // Survive process crashes only, without msync
   int open_flags = O_RDWR;
 };
 
-// --- 4. The Modern Conveyor Class ---
+// --- 6. Zero-Copy Read View ---
+// Bytes lent straight out of the read buffer (see conveyor_read_acquire),
+// as one or two segments. Handed back on destruction, consuming all of them
+// unless release() is called first with a smaller count.
+class ReadView {
+  conveyor_t *conv_ = nullptr;
+  std::array<Span<const char>, 2> segments_{};
+  size_t count_ = 0;
+  size_t size_ = 0;
+
+public:
+  ReadView() = default;
+  ReadView(conveyor_t *conv, const conveyor_iovec_t *iov, int iovcnt)
+      : conv_(conv), count_(static_cast<size_t>(iovcnt)) {
+    for (size_t i = 0; i < count_; ++i) {
+      segments_[i] = Span<const char>(static_cast<const char *>(iov[i].iov_base),
+                                      iov[i].iov_len);
+      size_ += iov[i].iov_len;
+    }
+  }
+
+  ReadView(ReadView &&other) noexcept { *this = std::move(other); }
+  ReadView &operator=(ReadView &&other) noexcept {
+    if (this != &other) {
+      release(size_);
+      conv_ = other.conv_;
+      segments_ = other.segments_;
+      count_ = other.count_;
+      size_ = other.size_;
+      other.conv_ = nullptr;
+      other.count_ = 0;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+  ReadView(const ReadView &) = delete;
+  ReadView &operator=(const ReadView &) = delete;
+  ~ReadView() { release(size_); }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t segment_count() const { return count_; }
+  Span<const char> segment(size_t i) const { return segments_[i]; }
+
+  // Ends the view early, consuming only its first 'consumed' bytes.
+  Result<void> release(size_t consumed) {
+    if (!conv_)
+      return Result<void>();
+    conveyor_t *conv = conv_;
+    conv_ = nullptr;
+    if (conveyor_read_release(conv, consumed) != 0) {
+      return std::error_code(errno, std::system_category());
+    }
+    return Result<void>();
+  }
+};
+
+// --- 7. In-Place Write Reservation ---
+// Writable space inside the write buffer (see conveyor_write_reserve), as one
+// or two segments. commit(n) queues the first n bytes; a reservation that
+// goes out of scope uncommitted is cancelled, so nothing half-built is ever
+// written.
+class WriteReservation {
+  conveyor_t *conv_ = nullptr;
+  std::array<Span<char>, 2> segments_{};
+  size_t count_ = 0;
+  size_t size_ = 0;
+
+public:
+  WriteReservation() = default;
+  WriteReservation(conveyor_t *conv, const conveyor_iovec_t *iov, int iovcnt)
+      : conv_(conv), count_(static_cast<size_t>(iovcnt)) {
+    for (size_t i = 0; i < count_; ++i) {
+      segments_[i] =
+          Span<char>(static_cast<char *>(iov[i].iov_base), iov[i].iov_len);
+      size_ += iov[i].iov_len;
+    }
+  }
+
+  WriteReservation(WriteReservation &&other) noexcept {
+    *this = std::move(other);
+  }
+  WriteReservation &operator=(WriteReservation &&other) noexcept {
+    if (this != &other) {
+      commit(0);
+      conv_ = other.conv_;
+      segments_ = other.segments_;
+      count_ = other.count_;
+      size_ = other.size_;
+      other.conv_ = nullptr;
+      other.count_ = 0;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+  WriteReservation(const WriteReservation &) = delete;
+  WriteReservation &operator=(const WriteReservation &) = delete;
+  ~WriteReservation() { commit(0); }
+
+  size_t size() const { return size_; }
+  size_t segment_count() const { return count_; }
+  Span<char> segment(size_t i) const { return segments_[i]; }
+
+  // Copies 'len' bytes to 'offset' within the reservation, across the
+  // segment boundary if needed.
+  void fill(size_t offset, const void *src, size_t len) {
+    const char *p = static_cast<const char *>(src);
+    for (size_t i = 0; i < count_ && len > 0; ++i) {
+      size_t seg_len = segments_[i].size();
+      if (offset >= seg_len) {
+        offset -= seg_len;
+        continue;
+      }
+      size_t n = std::min(len, seg_len - offset);
+      std::memcpy(segments_[i].data() + offset, p, n);
+      p += n;
+      len -= n;
+      offset = 0;
+    }
+  }
+
+  // Queues the first 'len' bytes and ends the reservation.
+  Result<size_t> commit(size_t len) {
+    if (!conv_)
+      return static_cast<size_t>(0);
+    conveyor_t *conv = conv_;
+    conv_ = nullptr;
+    ssize_t res = conveyor_write_commit(conv, len);
+    if (res == LIBCONVEYOR_ERROR) {
+      return std::error_code(errno, std::system_category());
+    }
+    return static_cast<size_t>(res);
+  }
+  Result<size_t> commit() { return commit(size_); }
+};
+
+// --- 8. The Modern Conveyor Class ---
 class Conveyor {
 private:
   struct Deleter {
@@ -92,6 +335,24 @@ public:
 
   // Factory
   static Result<Conveyor> create(const Config &cfg_v2) {
+    conveyor_config_t cfg_c = to_c(cfg_v2);
+    conveyor_t *raw = conveyor_create(&cfg_c);
+    if (!raw) {
+      return std::error_code(errno, std::system_category());
+    }
+    return Conveyor(raw);
+  }
+
+  // Replays the writes a conveyor that died left in cfg.journal_path (see
+  // conveyor_recover). Returns how many there were.
+  static Result<size_t> recover(const Config &cfg_v2) {
+    conveyor_config_t cfg_c = to_c(cfg_v2);
+    return check(conveyor_recover(&cfg_c));
+  }
+
+private:
+  // The C configuration for 'cfg_v2'; it points into 'cfg_v2'.
+  static conveyor_config_t to_c(const Config &cfg_v2) {
     conveyor_config_t cfg_c = {0};
     cfg_c.handle = cfg_v2.handle;
     cfg_c.flags = cfg_v2.open_flags;
@@ -101,14 +362,40 @@ public:
     cfg_c.max_write_size =
         cfg_v2.write_capacity;                  // For now, initial size is max
     cfg_c.max_read_size = cfg_v2.read_capacity; // For now, initial size is max
-
-    conveyor_t *raw = conveyor_create(&cfg_c);
-    if (!raw) {
-      return std::error_code(errno, std::system_category());
-    }
-    return Conveyor(raw);
+    cfg_c.max_coalesce_size = cfg_v2.coalesce_limit;
+    cfg_c.write_queue_depth = cfg_v2.write_queue_depth;
+    cfg_c.read_chunk_size = cfg_v2.read_chunk_size;
+    cfg_c.read_ahead_depth = cfg_v2.read_ahead_depth;
+    cfg_c.single_producer = cfg_v2.single_producer ? 1 : 0;
+    cfg_c.executor = cfg_v2.executor;
+    cfg_c.read_cache_block_size = cfg_v2.read_cache_block_size;
+    cfg_c.write_absorb = cfg_v2.write_absorb ? 1 : 0;
+    cfg_c.huge_pages = cfg_v2.huge_pages ? 1 : 0;
+    cfg_c.memory_priority = cfg_v2.memory_priority;
+    cfg_c.idle_shrink_ms = static_cast<unsigned int>(cfg_v2.idle_shrink.count());
+    cfg_c.trace_callback = cfg_v2.trace_callback;
+    cfg_c.trace_context = cfg_v2.trace_context;
+    cfg_c.trace_log_events = cfg_v2.trace_log_events;
+    cfg_c.write_backpressure = static_cast<int>(cfg_v2.backpressure);
+    cfg_c.write_timeout_ms =
+        static_cast<unsigned int>(cfg_v2.write_timeout.count());
+    cfg_c.writable_callback = cfg_v2.writable_callback;
+    cfg_c.writable_context = cfg_v2.writable_context;
+    cfg_c.codec = cfg_v2.codec;
+    cfg_c.codec_block_size = cfg_v2.codec_block_size;
+    cfg_c.direct_io_block_size = cfg_v2.direct_io_block_size;
+    cfg_c.placement = cfg_v2.placement;
+    cfg_c.rate_limit = cfg_v2.rate_limit;
+    cfg_c.qos_class = static_cast<int>(cfg_v2.qos);
+    cfg_c.journal_path =
+        cfg_v2.journal_path.empty() ? nullptr : cfg_v2.journal_path.c_str();
+    cfg_c.journal_size = cfg_v2.journal_size;
+    cfg_c.journal_no_sync = cfg_v2.journal_no_sync ? 1 : 0;
+    return cfg_c;
   }
 
+public:
+
   // --- Modern Write API ---
   // Accepts std::vector, std::string, std::array, etc.
   template <typename Container,
@@ -126,6 +413,49 @@ public:
     return static_cast<size_t>(res);
   }
 
+  // Positional write: queues the bytes for 'offset' without moving the
+  // file position or flushing.
+  template <typename Container,
+            typename = std::enable_if_t<is_contiguous<Container>::value>>
+  Result<size_t> pwrite(const Container &buffer, off_t offset) {
+    const void *ptr = std::data(buffer);
+    size_t len = std::size(buffer) * sizeof(typename Container::value_type);
+
+    ssize_t res = conveyor_pwrite(impl_.get(), ptr, len, offset);
+
+    if (res == LIBCONVEYOR_ERROR) {
+      return std::error_code(errno, std::system_category());
+    }
+    return static_cast<size_t>(res);
+  }
+
+  // Gather write of several buffers as one request (see conveyor_writev).
+  Result<size_t> writev(Span<const Span<const char>> buffers) {
+    IovecList iov(buffers);
+    return check(conveyor_writev(impl_.get(), iov.data(), iov.count()));
+  }
+  Result<size_t> writev(std::initializer_list<Span<const char>> buffers) {
+    return writev(Span<const Span<const char>>(buffers.begin(), buffers.size()));
+  }
+
+  // Many positional writes under one lock (see conveyor_submit_batch).
+  // Returns how many were queued; each entry's result says which.
+  Result<size_t> submit_batch(Span<conveyor_io_t> ios) {
+    return check(conveyor_submit_batch(impl_.get(), ios.data(), ios.size()));
+  }
+
+  // --- In-Place Write API ---
+  // Reserves 'len' bytes of the write buffer to be filled and committed.
+  Result<WriteReservation> reserve(size_t len) {
+    conveyor_iovec_t iov[2];
+    int iovcnt = 0;
+    ssize_t res = conveyor_write_reserve(impl_.get(), len, iov, &iovcnt);
+    if (res == LIBCONVEYOR_ERROR) {
+      return std::error_code(errno, std::system_category());
+    }
+    return WriteReservation(impl_.get(), iov, iovcnt);
+  }
+
   // --- Modern Read API ---
   // Accepts mutable vector/string/array to fill
   template <typename Container,
@@ -142,6 +472,44 @@ public:
     return static_cast<size_t>(res);
   }
 
+  // Scatter read into several buffers, in order (see conveyor_readv).
+  Result<size_t> readv(Span<const Span<char>> buffers) {
+    IovecList iov(buffers);
+    return check(conveyor_readv(impl_.get(), iov.data(), iov.count()));
+  }
+  Result<size_t> readv(std::initializer_list<Span<char>> buffers) {
+    return readv(Span<const Span<char>>(buffers.begin(), buffers.size()));
+  }
+
+  // Positional read: fills 'buffer' from 'offset' without moving the file
+  // position, seeing any writes still pending.
+  template <typename Container,
+            typename = std::enable_if_t<is_contiguous<Container>::value>>
+  Result<size_t> pread(Container &buffer, off_t offset) {
+    void *ptr = (void *)std::data(buffer);
+    size_t len = std::size(buffer) * sizeof(typename Container::value_type);
+
+    ssize_t res = conveyor_pread(impl_.get(), ptr, len, offset);
+
+    if (res == LIBCONVEYOR_ERROR) {
+      return std::error_code(errno, std::system_category());
+    }
+    return static_cast<size_t>(res);
+  }
+
+  // --- Zero-Copy Read API ---
+  // Borrows up to max_len buffered bytes without copying them. An empty
+  // view means end of file.
+  Result<ReadView> read_view(size_t max_len) {
+    conveyor_iovec_t iov[2];
+    int iovcnt = 0;
+    ssize_t res = conveyor_read_acquire(impl_.get(), max_len, iov, &iovcnt);
+    if (res == LIBCONVEYOR_ERROR) {
+      return std::error_code(errno, std::system_category());
+    }
+    return ReadView(res > 0 ? impl_.get() : nullptr, iov, iovcnt);
+  }
+
   // --- Seek ---
   Result<off_t> seek(off_t offset, int whence = SEEK_SET) {
     off_t res = conveyor_lseek(impl_.get(), offset, whence);
@@ -159,28 +527,240 @@ public:
     return Result<void>();
   }
 
+  // Resolves once every write issued so far has reached storage; the value
+  // is the first write error, if any (see conveyor_flush_async).
+  std::future<std::error_code> flush_async() {
+    return barrier(conveyor_flush_async);
+  }
+
+  // As flush_async, but also durable: concurrent callers share one
+  // storage_operations_t::fsync (see conveyor_fsync_async).
+  std::future<std::error_code> fsync_async() {
+    return barrier(conveyor_fsync_async);
+  }
+
+  Result<void> fsync() {
+    if (conveyor_fsync(impl_.get()) != 0) {
+      return std::error_code(errno, std::system_category());
+    }
+    return Result<void>();
+  }
+
+  // --- Backpressure ---
+  // Pollable fd signalled when space frees up after a refused or short
+  // write (see conveyor_writable_fd). Owned by the conveyor.
+  Result<int> writable_fd() {
+    int fd = conveyor_writable_fd(impl_.get());
+    if (fd < 0) {
+      return std::error_code(errno, std::system_category());
+    }
+    return fd;
+  }
+
+  // --- Tracing ---
+  // Drains the trace log to 'path' as a Chrome/Perfetto trace.
+  Result<void> export_trace(const std::string &path) {
+    if (conveyor_trace_export_chrome(impl_.get(), path.c_str()) != 0) {
+      return std::error_code(errno, std::system_category());
+    }
+    return Result<void>();
+  }
+
   // --- Stats ---
+  // Percentiles of one kind of operation over the window (see
+  // conveyor_latency_t).
+  struct Latency {
+    uint64_t count;
+    std::chrono::nanoseconds p50;
+    std::chrono::nanoseconds p99;
+    std::chrono::nanoseconds p999;
+    std::chrono::nanoseconds max;
+  };
+
   struct Stats {
     size_t bytes_written;
     size_t bytes_read;
     std::chrono::milliseconds avg_write_latency;
     std::chrono::milliseconds avg_read_latency;
     size_t write_buffer_full_events;
+    size_t read_hits;
+    size_t read_misses;
+    size_t bytes_absorbed;
+    size_t throttled_ops;
+    std::chrono::milliseconds throttle_wait;
     int last_error_code;
+    Latency backend_write;
+    Latency backend_read;
+    Latency write_call;
+    Latency read_call;
   };
 
   Stats stats() {
-    conveyor_stats_t raw;
-    conveyor_get_stats(impl_.get(), &raw);
+    conveyor_stats_ex_t ex;
+    conveyor_get_stats_ex(impl_.get(), &ex);
+    const conveyor_stats_t &raw = ex.basic;
     return Stats{raw.bytes_written,
                  raw.bytes_read,
                  std::chrono::milliseconds(raw.avg_write_latency_ms),
                  std::chrono::milliseconds(raw.avg_read_latency_ms),
                  raw.write_buffer_full_events,
-                 raw.last_error_code};
+                 raw.read_hits,
+                 raw.read_misses,
+                 raw.bytes_absorbed,
+                 raw.throttled_ops,
+                 std::chrono::milliseconds(raw.throttle_wait_ms),
+                 raw.last_error_code,
+                 latency(ex.backend_write),
+                 latency(ex.backend_read),
+                 latency(ex.write_call),
+                 latency(ex.read_call)};
+  }
+
+  // Cumulative counters and current gauges; unlike stats() this resets
+  // nothing, so any number of scrapers may call it.
+  Result<conveyor_metrics_t> metrics() const {
+    conveyor_metrics_t m;
+    if (conveyor_get_metrics(impl_.get(), &m, sizeof(m)) != 0) {
+      return std::error_code(errno, std::system_category());
+    }
+    return m;
+  }
+
+private:
+  // A span of spans as conveyor_iovec_t, on the stack for short lists.
+  class IovecList {
+    static constexpr size_t kInline = 8;
+    std::array<conveyor_iovec_t, kInline> inline_{};
+    std::vector<conveyor_iovec_t> heap_;
+    conveyor_iovec_t *data_;
+    size_t count_;
+
+  public:
+    template <typename T>
+    explicit IovecList(Span<const Span<T>> buffers)
+        : data_(inline_.data()), count_(buffers.size()) {
+      if (count_ > kInline) {
+        heap_.resize(count_);
+        data_ = heap_.data();
+      }
+      for (size_t i = 0; i < count_; ++i) {
+        data_[i].iov_base = const_cast<char *>(buffers[i].data());
+        data_[i].iov_len = buffers[i].size();
+      }
+    }
+    const conveyor_iovec_t *data() const { return data_; }
+    int count() const { return static_cast<int>(count_); }
+  };
+
+  static Result<size_t> check(ssize_t res) {
+    if (res == LIBCONVEYOR_ERROR) {
+      return std::error_code(errno, std::system_category());
+    }
+    return static_cast<size_t>(res);
+  }
+
+  using BarrierFn = int (*)(conveyor_t *, conveyor_flush_fn, void *);
+
+  // The promise lives on the heap until the callback has fulfilled it.
+  std::future<std::error_code> barrier(BarrierFn queue) {
+    auto *promise = new std::promise<std::error_code>();
+    std::future<std::error_code> done = promise->get_future();
+    auto on_done = [](void *context, int error) {
+      auto *p = static_cast<std::promise<std::error_code> *>(context);
+      p->set_value(error ? std::error_code(error, std::system_category())
+                         : std::error_code());
+      delete p;
+    };
+    if (queue(impl_.get(), on_done, promise) != 0) {
+      on_done(promise, errno);
+    }
+    return done;
+  }
+
+  static Latency latency(const conveyor_latency_t &l) {
+    return Latency{l.count, std::chrono::nanoseconds(l.p50_ns),
+                   std::chrono::nanoseconds(l.p99_ns),
+                   std::chrono::nanoseconds(l.p999_ns),
+                   std::chrono::nanoseconds(l.max_ns)};
   }
 };
 
+// Renders metrics in the Prometheus text exposition format, one series per
+// conveyor labelled conveyor="<name>". Nanosecond totals are exported in
+// seconds, as Prometheus naming expects.
+inline std::string
+prometheus_text(const std::vector<std::pair<std::string, conveyor_metrics_t>> &conveyors,
+                const std::string &prefix = "libconveyor") {
+  struct Series {
+    const char *name;
+    const char *help;
+    unsigned long long conveyor_metrics_t::*field;
+    bool counter;
+    bool nanoseconds;
+  };
+  using M = conveyor_metrics_t;
+  static const Series kSeries[] = {
+      {"bytes_written_total", "Bytes accepted by writes.", &M::bytes_written, true, false},
+      {"bytes_read_total", "Bytes returned by reads.", &M::bytes_read, true, false},
+      {"backend_writes_total", "Backend write operations.", &M::backend_writes, true, false},
+      {"backend_write_seconds_total", "Time spent in backend writes.", &M::backend_write_ns, true, true},
+      {"backend_reads_total", "Backend read operations.", &M::backend_reads, true, false},
+      {"backend_read_seconds_total", "Time spent in backend reads.", &M::backend_read_ns, true, true},
+      {"write_buffer_full_total", "Writes that found the write buffer full.", &M::write_buffer_full_events, true, false},
+      {"read_hits_total", "Reads served from buffered data.", &M::read_hits, true, false},
+      {"read_misses_total", "Reads that went to the backend.", &M::read_misses, true, false},
+      {"read_hit_bytes_total", "Bytes of reads served from buffered data.", &M::read_hit_bytes, true, false},
+      {"read_miss_bytes_total", "Bytes of reads that went to the backend.", &M::read_miss_bytes, true, false},
+      {"snoop_patched_bytes_total", "Bytes reads took from pending writes.", &M::snoop_patched_bytes, true, false},
+      {"bytes_absorbed_total", "Bytes overwritten before reaching the backend.", &M::bytes_absorbed, true, false},
+      {"read_invalidations_total", "Times buffered read-ahead was discarded.", &M::read_invalidations, true, false},
+      {"write_resizes_total", "Write buffer resizes.", &M::write_resizes, true, false},
+      {"read_resizes_total", "Read buffer resizes.", &M::read_resizes, true, false},
+      {"flushes_total", "Flushes and flush barriers completed.", &M::flushes, true, false},
+      {"flush_wait_seconds_total", "Time from each flush's start to its completion.", &M::flush_wait_ns, true, true},
+      {"throttled_ops_total", "Operations delayed by a rate limit.", &M::throttled_ops, true, false},
+      {"throttle_wait_seconds_total", "Time spent waiting on rate limits.", &M::throttle_wait_ns, true, true},
+      {"write_capacity_bytes", "Write buffer capacity.", &M::write_capacity, false, false},
+      {"write_buffered_bytes", "Bytes held in the write buffer.", &M::write_buffered, false, false},
+      {"write_queue_depth", "Writes queued for the backend.", &M::write_queue_depth, false, false},
+      {"read_capacity_bytes", "Read buffer capacity.", &M::read_capacity, false, false},
+      {"read_buffered_bytes", "Bytes held in the read buffer.", &M::read_buffered, false, false},
+  };
+
+  auto label = [](const std::string &name) {
+    std::string out;
+    for (char c : name) {
+      if (c == '\\' || c == '"') {
+        out += '\\';
+        out += c;
+      } else if (c == '\n') {
+        out += "\\n";
+      } else {
+        out += c;
+      }
+    }
+    return out;
+  };
+
+  std::string text;
+  char value[32];
+  for (const Series &series : kSeries) {
+    std::string name = prefix + "_" + series.name;
+    text += "# HELP " + name + " " + series.help + "\n";
+    text += "# TYPE " + name + (series.counter ? " counter\n" : " gauge\n");
+    for (const auto &conveyor : conveyors) {
+      unsigned long long raw = conveyor.second.*series.field;
+      if (series.nanoseconds) {
+        std::snprintf(value, sizeof(value), "%.9f", static_cast<double>(raw) / 1e9);
+      } else {
+        std::snprintf(value, sizeof(value), "%llu", raw);
+      }
+      text += name + "{conveyor=\"" + label(conveyor.first) + "\"} " + value + "\n";
+    }
+  }
+  return text;
+}
+
 } // namespace v2
 } // namespace libconveyor
 
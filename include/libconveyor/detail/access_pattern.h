@@ -0,0 +1,66 @@
+#ifndef LIBCONVEYOR_DETAIL_ACCESS_PATTERN_H
+#define LIBCONVEYOR_DETAIL_ACCESS_PATTERN_H
+
+#include <cstddef> // For size_t
+#include <algorithm> // For std::min, std::max
+#include <sys/types.h> // For off_t
+
+namespace libconveyor {
+
+// Classifies a stream of reads by the distance between consecutive request
+// starts. Two equal distances in a row confirm a stream: sequential when
+// the distance is at most the request length, strided when it is larger,
+// reverse when it is negative. 'depth' is how many records ahead of the
+// latest read to prefetch; the owner doubles it while a confirmed stream
+// still misses, and it halves whenever a stream breaks, so mispredictions
+// get cheaper over time.
+// Thread-Safety: Not thread-safe; the owner serializes access.
+struct AccessPattern {
+    enum Kind { kRandom, kSequential, kStrided, kReverse };
+
+    Kind kind = kRandom;
+    off_t last_offset = -1;
+    size_t last_len = 0;
+    off_t stride = 0;      // Distance between the last two request starts
+    size_t depth = 1;      // Records to keep prefetched ahead
+    size_t prefetched = 0; // Records ahead of last_offset already requested
+
+    Kind observe(off_t offset, size_t len) {
+        bool confirmed = false;
+        if (last_offset >= 0) {
+            off_t delta = offset - last_offset;
+            if (delta != 0 && delta == stride) {
+                confirmed = true;
+            } else {
+                if (kind != kRandom) depth = std::max<size_t>(1, depth / 2);
+                stride = delta;
+                prefetched = 0;
+            }
+        }
+        last_offset = offset;
+        last_len = len;
+
+        if (!confirmed) {
+            kind = kRandom;
+        } else if (stride < 0) {
+            kind = kReverse;
+        } else if (static_cast<size_t>(stride) <= len) {
+            kind = kSequential;
+        } else {
+            kind = kStrided;
+        }
+        // The stream moved one record on; one fewer is queued ahead of it.
+        if (confirmed && prefetched > 0) prefetched--;
+        return kind;
+    }
+
+    // A confirmed stream missed anyway: prefetch further ahead.
+    void grow(size_t max_depth) { depth = std::min(depth * 2, std::max<size_t>(1, max_depth)); }
+
+    // Start of the i-th predicted record after the latest read.
+    off_t predict(size_t i) const { return last_offset + static_cast<off_t>(i) * stride; }
+};
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_ACCESS_PATTERN_H
@@ -0,0 +1,38 @@
+#ifndef LIBCONVEYOR_DETAIL_ALIGNED_BUFFER_H
+#define LIBCONVEYOR_DETAIL_ALIGNED_BUFFER_H
+
+#include <cstddef> // For size_t
+#include <new>     // For std::align_val_t
+#include <vector>
+
+namespace libconveyor {
+
+// Scratch storage that may be handed straight to a direct-I/O backend
+// (conveyor_config_t::direct_io_block_size): every allocation starts on a
+// kScratchAlignment boundary, the largest block size direct I/O accepts.
+// Thread-Safety: Stateless.
+template <typename T>
+struct AlignedAllocator {
+    static constexpr size_t kScratchAlignment = 4096;
+    using value_type = T;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(kScratchAlignment)));
+    }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(kScratchAlignment)); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+using ScratchBuffer = std::vector<char, AlignedAllocator<char>>;
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_ALIGNED_BUFFER_H
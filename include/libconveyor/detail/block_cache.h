@@ -0,0 +1,161 @@
+#ifndef LIBCONVEYOR_DETAIL_BLOCK_CACHE_H
+#define LIBCONVEYOR_DETAIL_BLOCK_CACHE_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef> // For size_t
+#include <algorithm> // For std::min, std::max
+#include <cstring> // For std::memcpy
+#include <sys/types.h> // For off_t
+
+namespace libconveyor {
+
+// Block-granular cache of file contents, keyed by block index and evicted
+// with CLOCK. Each block holds a valid prefix of up to block_size bytes, so
+// partially read blocks (including the one at EOF) can still be served.
+// Blocks earn their second chance on a read hit, not on insertion, so a
+// long sequential scan cycles through the cache without pushing out blocks
+// that are actually being revisited. Storage for a slot is allocated the
+// first time it is used.
+// Thread-Safety: Not thread-safe; the owner serializes access.
+struct BlockCache {
+    struct Block {
+        off_t index = -1; // -1 = free slot
+        size_t valid = 0; // Bytes valid from the start of the block
+        bool referenced = false;
+        std::vector<char> data;
+    };
+
+    size_t block_size = 0;
+    std::vector<Block> blocks;
+    std::unordered_map<off_t, size_t> lookup; // Block index -> slot
+    size_t hand = 0;
+
+    // Holds at most capacity bytes (at least one block). A block_size of 0
+    // makes every operation a no-op.
+    BlockCache(size_t block_sz = 0, size_t capacity = 0) : block_size(block_sz) {
+        if (block_size > 0) blocks.resize(std::max<size_t>(1, capacity / block_size));
+    }
+
+    bool enabled() const { return block_size > 0; }
+    size_t capacity() const { return blocks.size() * block_size; }
+
+    // True when every block overlapping [offset, offset + len) is cached.
+    bool contains(off_t offset, size_t len) const {
+        if (!enabled() || len == 0) return false;
+        off_t first = offset / static_cast<off_t>(block_size);
+        off_t last = (offset + static_cast<off_t>(len) - 1) / static_cast<off_t>(block_size);
+        for (off_t index = first; index <= last; ++index) {
+            if (lookup.find(index) == lookup.end()) return false;
+        }
+        return true;
+    }
+
+    // Copies cached bytes starting at 'offset' into dest, stopping at the
+    // first byte that is not cached. Returns the bytes copied.
+    size_t read(off_t offset, char* dest, size_t len) {
+        if (!enabled()) return 0;
+        size_t done = 0;
+        while (done < len) {
+            off_t pos = offset + static_cast<off_t>(done);
+            auto it = lookup.find(pos / static_cast<off_t>(block_size));
+            if (it == lookup.end()) break;
+            Block& b = blocks[it->second];
+            size_t in_block = static_cast<size_t>(pos % static_cast<off_t>(block_size));
+            if (b.valid <= in_block) break;
+            size_t n = std::min(len - done, b.valid - in_block);
+            std::memcpy(dest + done, b.data.data() + in_block, n);
+            b.referenced = true;
+            done += n;
+            if (in_block + n < block_size) break; // Rest of the block unknown
+        }
+        return done;
+    }
+
+    // Records that [offset, offset + len) holds src. Bytes that would leave
+    // a gap in a block's valid prefix are not kept.
+    void insert(off_t offset, const char* src, size_t len) {
+        if (!enabled()) return;
+        size_t done = 0;
+        while (done < len) {
+            off_t pos = offset + static_cast<off_t>(done);
+            off_t index = pos / static_cast<off_t>(block_size);
+            size_t in_block = static_cast<size_t>(pos % static_cast<off_t>(block_size));
+            size_t n = std::min(len - done, block_size - in_block);
+
+            auto it = lookup.find(index);
+            Block* b = nullptr;
+            if (it != lookup.end()) {
+                b = &blocks[it->second];
+            } else if (in_block == 0) {
+                b = &blocks[allocate(index)];
+            }
+            if (b && in_block <= b->valid) {
+                std::memcpy(b->data.data() + in_block, src + done, n);
+                b->valid = std::max(b->valid, in_block + n);
+            }
+            done += n;
+        }
+    }
+
+    // Drops every block that overlaps [offset, offset + len).
+    void invalidate(off_t offset, size_t len) {
+        if (!enabled() || len == 0 || lookup.empty()) return;
+        off_t first = offset / static_cast<off_t>(block_size);
+        off_t last = (offset + static_cast<off_t>(len) - 1) / static_cast<off_t>(block_size);
+        if (static_cast<size_t>(last - first) >= lookup.size()) {
+            // Cheaper to scan what is cached than the whole range.
+            for (auto it = lookup.begin(); it != lookup.end();) {
+                if (it->first >= first && it->first <= last) {
+                    release(blocks[it->second]);
+                    it = lookup.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            return;
+        }
+        for (off_t index = first; index <= last; ++index) {
+            auto it = lookup.find(index);
+            if (it == lookup.end()) continue;
+            release(blocks[it->second]);
+            lookup.erase(it);
+        }
+    }
+
+    void clear() {
+        for (auto& b : blocks) release(b);
+        lookup.clear();
+    }
+
+private:
+    static void release(Block& b) {
+        b.index = -1;
+        b.valid = 0;
+        b.referenced = false;
+    }
+
+    // CLOCK: sweep from the hand, clearing reference bits, and take the
+    // first free or unreferenced slot. Terminates within two sweeps.
+    size_t allocate(off_t index) {
+        while (true) {
+            size_t slot = hand;
+            hand = (hand + 1) % blocks.size();
+            Block& b = blocks[slot];
+            if (b.index >= 0 && b.referenced) {
+                b.referenced = false;
+                continue;
+            }
+            if (b.index >= 0) lookup.erase(b.index);
+            release(b);
+            b.index = index;
+            if (b.data.size() != block_size) b.data.resize(block_size);
+            lookup[index] = slot;
+            return slot;
+        }
+    }
+};
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_BLOCK_CACHE_H
@@ -0,0 +1,289 @@
+#ifndef LIBCONVEYOR_DETAIL_BLOCK_CODEC_H
+#define LIBCONVEYOR_DETAIL_BLOCK_CODEC_H
+
+#include "libconveyor/conveyor.h"
+#include <algorithm> // For std::min, std::max
+#include <atomic>
+#include <cerrno>
+#include <cstddef> // For size_t
+#include <cstdint> // For uint32_t
+#include <cstring> // For std::memcpy
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace libconveyor {
+
+// Storage adaptor that compresses a file block by block with a
+// conveyor_codec_t. Block i of the logical file lives in slot i of the
+// underlying storage, at i * slot_size(): a header followed by the packed
+// bytes, with the rest of the slot left unwritten. An offset therefore maps
+// to its block with one division, a block is rewritten in place, and only
+// packed bytes cross the wire. The file ends inside the last slot written;
+// slots never written read back as zeros.
+//
+// Blocks are spread over stripes, each with its own lock, the last block it
+// unpacked, and the packed sizes of its blocks seen so far. A run of small
+// writes or reads within one block unpacks it once, and a block whose size
+// is known is fetched with a single pread.
+// Thread-Safety: every operation may be called from any thread.
+class BlockCodecStorage {
+public:
+    static constexpr uint32_t kMagic = 0x31425643; // "CVB1"
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+    static constexpr size_t kStripes = 16;
+
+    // Slot header, in host byte order. A block is stored raw when packing
+    // does not make it smaller, so stored == length means "not packed".
+    struct Header {
+        uint32_t magic;
+        uint32_t block_size;
+        uint32_t stored; // Bytes after the header
+        uint32_t length; // Bytes of the block in use
+    };
+    static constexpr size_t kHeaderSize = sizeof(Header);
+
+    BlockCodecStorage(storage_handle_t inner, const storage_operations_t& inner_ops,
+                      const conveyor_codec_t& codec, size_t block_size)
+        : inner(inner), inner_ops(inner_ops), codec(codec),
+          block_size(block_size > 0 ? block_size : kDefaultBlockSize) {}
+
+    BlockCodecStorage(const BlockCodecStorage&) = delete;
+    BlockCodecStorage& operator=(const BlockCodecStorage&) = delete;
+
+    // Finds where an existing file ends. Returns false with errno set when
+    // the storage cannot be read or was written with another block size.
+    bool open() {
+        if (block_size > UINT32_MAX - kHeaderSize) {
+            errno = EINVAL;
+            return false;
+        }
+        off_t physical = inner_ops.lseek(inner, 0, SEEK_END);
+        if (physical < 0) return false;
+        if (physical == 0) return true;
+        int64_t last = (physical - 1) / static_cast<off_t>(slot_size());
+        Stripe& s = stripe(last);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (!load(s, last)) return false;
+        logical_size = static_cast<off_t>(last * block_size + s.length);
+        return true;
+    }
+
+    size_t slot_size() const { return kHeaderSize + block_size; }
+    off_t size() const { return logical_size.load(); }
+
+    // The adaptor as a backend, with 'this' as its handle.
+    storage_operations_t ops() const {
+        storage_operations_t o = {};
+        o.pwrite = &BlockCodecStorage::pwrite_op;
+        o.pread = &BlockCodecStorage::pread_op;
+        o.lseek = &BlockCodecStorage::lseek_op;
+        if (inner_ops.fsync) o.fsync = &BlockCodecStorage::fsync_op;
+        return o;
+    }
+
+    ssize_t pwrite(const void* buf, size_t count, off_t offset) {
+        const char* src = static_cast<const char*>(buf);
+        size_t done = 0;
+        while (done < count) {
+            off_t pos = offset + static_cast<off_t>(done);
+            int64_t index = pos / static_cast<off_t>(block_size);
+            size_t in_block = static_cast<size_t>(pos % static_cast<off_t>(block_size));
+            size_t len = std::min(count - done, block_size - in_block);
+            off_t block_start = pos - static_cast<off_t>(in_block);
+
+            Stripe& s = stripe(index);
+            std::lock_guard<std::mutex> lock(s.mutex);
+            // Nothing stored in the block survives the write: skip reading it.
+            bool fresh = block_start >= size() ||
+                         (in_block == 0 && (len == block_size || pos + (off_t)len >= size()));
+            if (fresh) {
+                s.data.resize(block_size);
+                s.index = index;
+                s.length = 0;
+            } else if (!load(s, index)) {
+                return done > 0 ? static_cast<ssize_t>(done) : -1;
+            }
+            if (in_block > s.length) std::memset(s.data.data() + s.length, 0, in_block - s.length);
+            std::memcpy(s.data.data() + in_block, src + done, len);
+            s.length = std::max(s.length, in_block + len);
+            if (!store(s)) {
+                s.index = -1;
+                return done > 0 ? static_cast<ssize_t>(done) : -1;
+            }
+            off_t end = pos + static_cast<off_t>(len);
+            off_t seen = logical_size.load();
+            while (end > seen && !logical_size.compare_exchange_weak(seen, end)) {
+            }
+            done += len;
+        }
+        return static_cast<ssize_t>(done);
+    }
+
+    ssize_t pread(void* buf, size_t count, off_t offset) {
+        off_t end = size();
+        if (offset >= end) return 0;
+        count = std::min(count, static_cast<size_t>(end - offset));
+        char* dest = static_cast<char*>(buf);
+        size_t done = 0;
+        while (done < count) {
+            off_t pos = offset + static_cast<off_t>(done);
+            int64_t index = pos / static_cast<off_t>(block_size);
+            size_t in_block = static_cast<size_t>(pos % static_cast<off_t>(block_size));
+            size_t len = std::min(count - done, block_size - in_block);
+
+            Stripe& s = stripe(index);
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (!load(s, index)) return done > 0 ? static_cast<ssize_t>(done) : -1;
+            size_t stored = in_block < s.length ? std::min(len, s.length - in_block) : 0;
+            std::memcpy(dest + done, s.data.data() + in_block, stored);
+            std::memset(dest + done + stored, 0, len - stored); // A hole inside the file
+            done += len;
+        }
+        return static_cast<ssize_t>(done);
+    }
+
+    // Offsets are logical; only the end of the file needs translating.
+    off_t lseek(off_t offset, int whence) {
+        if (whence == SEEK_END) return size() + offset;
+        if (whence == SEEK_SET) return offset;
+        return inner_ops.lseek(inner, offset, whence);
+    }
+
+    int fsync() { return inner_ops.fsync(inner); }
+
+private:
+    struct Stripe {
+        std::mutex mutex;
+        int64_t index = -1;       // Block unpacked in 'data' (-1 = none)
+        size_t length = 0;        // Bytes of it in use
+        std::vector<char> data;   // Unpacked block
+        std::vector<char> packed; // Slot image (header + packed bytes)
+        std::unordered_map<int64_t, uint32_t> stored; // Block -> packed size
+    };
+
+    storage_handle_t inner;
+    storage_operations_t inner_ops;
+    conveyor_codec_t codec;
+    size_t block_size;
+    std::atomic<off_t> logical_size{0};
+    Stripe stripes[kStripes];
+
+    Stripe& stripe(int64_t index) { return stripes[static_cast<size_t>(index) % kStripes]; }
+    off_t slot_offset(int64_t index) const { return index * static_cast<off_t>(slot_size()); }
+
+    // Reads up to 'count' bytes, stopping early only at the end of storage.
+    ssize_t read_fully(char* dest, size_t count, off_t offset) {
+        size_t done = 0;
+        while (done < count) {
+            ssize_t n = inner_ops.pread(inner, dest + done, count - done, offset + static_cast<off_t>(done));
+            if (n < 0) return -1;
+            if (n == 0) break;
+            done += static_cast<size_t>(n);
+        }
+        return static_cast<ssize_t>(done);
+    }
+
+    bool write_fully(const char* src, size_t count, off_t offset) {
+        size_t done = 0;
+        while (done < count) {
+            ssize_t n = inner_ops.pwrite(inner, src + done, count - done, offset + static_cast<off_t>(done));
+            if (n < 0) return false;
+            if (n == 0) {
+                errno = EIO;
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Makes 's' hold block 'index', unpacked. Returns false with errno set.
+    // Thread-Safety: s.mutex must be held.
+    bool load(Stripe& s, int64_t index) {
+        if (s.index == index) return true;
+        s.index = -1;
+        s.data.resize(block_size);
+        s.packed.resize(slot_size());
+        auto known = s.stored.find(index);
+        size_t want = kHeaderSize + (known != s.stored.end() ? known->second : 0);
+        ssize_t got = read_fully(s.packed.data(), want, slot_offset(index));
+        if (got < 0) return false;
+
+        Header h = {};
+        if (static_cast<size_t>(got) >= kHeaderSize) std::memcpy(&h, s.packed.data(), kHeaderSize);
+        if (got == 0 || (static_cast<size_t>(got) == kHeaderSize && h.magic == 0 && h.length == 0)) {
+            s.index = index; // Never written
+            s.length = 0;
+            return true;
+        }
+        if (static_cast<size_t>(got) < kHeaderSize || h.magic != kMagic ||
+            h.block_size != block_size || h.length > block_size || h.stored > h.length) {
+            errno = EIO;
+            return false;
+        }
+        size_t full = kHeaderSize + h.stored;
+        if (static_cast<size_t>(got) < full) {
+            ssize_t rest = read_fully(s.packed.data() + got, full - got, slot_offset(index) + got);
+            if (rest < 0) return false;
+            if (static_cast<size_t>(got + rest) < full) {
+                errno = EIO; // Slot cut short
+                return false;
+            }
+        }
+        const char* payload = s.packed.data() + kHeaderSize;
+        if (h.stored == h.length) {
+            std::memcpy(s.data.data(), payload, h.length);
+        } else {
+            ssize_t n = codec.decompress(codec.context, payload, h.stored, s.data.data(), block_size);
+            if (n < 0) return false;
+            if (static_cast<size_t>(n) != h.length) {
+                errno = EIO;
+                return false;
+            }
+        }
+        s.stored[index] = h.stored;
+        s.index = index;
+        s.length = h.length;
+        return true;
+    }
+
+    // Packs the block held by 's' and writes its slot.
+    // Thread-Safety: s.mutex must be held.
+    bool store(Stripe& s) {
+        s.packed.resize(slot_size());
+        char* payload = s.packed.data() + kHeaderSize;
+        ssize_t packed = 0;
+        if (s.length > 1) {
+            // Anything short of a saving is stored raw.
+            packed = codec.compress(codec.context, s.data.data(), s.length, payload, s.length - 1);
+            if (packed < 0) return false;
+        }
+        Header h;
+        h.magic = kMagic;
+        h.block_size = static_cast<uint32_t>(block_size);
+        h.length = static_cast<uint32_t>(s.length);
+        h.stored = packed > 0 ? static_cast<uint32_t>(packed) : h.length;
+        if (packed == 0) std::memcpy(payload, s.data.data(), s.length);
+        std::memcpy(s.packed.data(), &h, kHeaderSize);
+        if (!write_fully(s.packed.data(), kHeaderSize + h.stored, slot_offset(s.index))) return false;
+        s.stored[s.index] = h.stored;
+        return true;
+    }
+
+    static BlockCodecStorage* self(storage_handle_t h) { return static_cast<BlockCodecStorage*>(h); }
+    static ssize_t pwrite_op(storage_handle_t h, const void* buf, size_t count, off_t offset) {
+        return self(h)->pwrite(buf, count, offset);
+    }
+    static ssize_t pread_op(storage_handle_t h, void* buf, size_t count, off_t offset) {
+        return self(h)->pread(buf, count, offset);
+    }
+    static off_t lseek_op(storage_handle_t h, off_t offset, int whence) {
+        return self(h)->lseek(offset, whence);
+    }
+    static int fsync_op(storage_handle_t h) { return self(h)->fsync(); }
+};
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_BLOCK_CODEC_H
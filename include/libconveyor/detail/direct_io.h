@@ -0,0 +1,361 @@
+#ifndef LIBCONVEYOR_DETAIL_DIRECT_IO_H
+#define LIBCONVEYOR_DETAIL_DIRECT_IO_H
+
+#include "libconveyor/conveyor.h"
+#include "libconveyor/detail/aligned_buffer.h"
+#include <algorithm> // For std::min, std::max
+#include <atomic>
+#include <cerrno>
+#include <cstddef> // For size_t
+#include <cstdint> // For uintptr_t
+#include <cstring> // For std::memcpy
+#include <mutex>
+#include <vector>
+
+namespace libconveyor {
+
+// Storage adaptor for backends opened with O_DIRECT. Every pread and pwrite
+// it issues has its offset, length and buffer aligned to block_size. Aligned
+// requests, which is what sequential ring traffic becomes, pass straight
+// through. Anything else goes through an aligned bounce buffer. A partial
+// block at either edge of a write is read, patched and written back whole.
+// The block a write ends in is kept, so the next sequential write does not
+// have to read it back.
+//
+// Writes that end inside a block pad the file to the block boundary. The
+// logical size is tracked here: reads stop at it and SEEK_END reports it.
+// With the backend's truncate op, the padding is trimmed off whenever no
+// write is in flight.
+//
+// Edge blocks are locked by stripe. Two writes that share a block can be in
+// flight at once without overlapping, so their read-modify-write cycles
+// must not interleave.
+// Thread-Safety: every operation may be called from any thread.
+class DirectIoStorage {
+public:
+    static constexpr size_t kMaxBlockSize = AlignedAllocator<char>::kScratchAlignment;
+    static constexpr size_t kBounceSize = 256 * 1024;
+    static constexpr size_t kStripes = 16;
+
+    DirectIoStorage(storage_handle_t inner, const storage_operations_t& inner_ops, size_t block_size)
+        : inner(inner), inner_ops(inner_ops), block_size(block_size), tail_block(block_size) {}
+
+    DirectIoStorage(const DirectIoStorage&) = delete;
+    DirectIoStorage& operator=(const DirectIoStorage&) = delete;
+
+    static bool valid_block_size(size_t bs) {
+        return bs > 0 && bs <= kMaxBlockSize && (bs & (bs - 1)) == 0;
+    }
+
+    // Takes the current end of storage as the logical size. Returns false
+    // with errno set.
+    bool open() {
+        off_t end = inner_ops.lseek(inner, 0, SEEK_END);
+        if (end < 0) return false;
+        logical_size = end;
+        physical_end = end;
+        return true;
+    }
+
+    off_t size() const { return logical_size.load(); }
+
+    // The adaptor as a backend, with 'this' as its handle.
+    storage_operations_t ops() const {
+        storage_operations_t o = {};
+        o.pwrite = &DirectIoStorage::pwrite_op;
+        o.pread = &DirectIoStorage::pread_op;
+        o.lseek = &DirectIoStorage::lseek_op;
+        o.pwritev = &DirectIoStorage::pwritev_op;
+        if (inner_ops.fsync) o.fsync = &DirectIoStorage::fsync_op;
+        return o;
+    }
+
+    ssize_t pwritev(const conveyor_iovec_t* iov, int iovcnt, off_t offset) {
+        size_t count = 0;
+        bool aligned = is_aligned(offset);
+        for (int i = 0; i < iovcnt; ++i) {
+            count += iov[i].iov_len;
+            aligned = aligned && is_aligned(iov[i].iov_base) && is_aligned(iov[i].iov_len);
+        }
+        if (count == 0) return 0;
+        off_t end = offset + static_cast<off_t>(count);
+        off_t padded_end = align_up(end);
+        begin_write();
+        bool ok = aligned ? write_aligned(iov, iovcnt, offset) : write_bounced(iov, iovcnt, count, offset);
+        if (aligned) forget_tail(offset, padded_end);
+        end_write(ok, end, padded_end);
+        return ok ? static_cast<ssize_t>(count) : -1;
+    }
+
+    ssize_t pwrite(const void* buf, size_t count, off_t offset) {
+        conveyor_iovec_t iov = {const_cast<void*>(buf), count};
+        return pwritev(&iov, 1, offset);
+    }
+
+    ssize_t pread(void* buf, size_t count, off_t offset) {
+        off_t end = size();
+        if (offset >= end) return 0;
+        count = std::min(count, static_cast<size_t>(end - offset));
+        char* dest = static_cast<char*>(buf);
+        size_t direct = 0;
+        if (is_aligned(dest) && is_aligned(offset)) {
+            // Whole blocks straight into the caller's buffer.
+            direct = count / block_size * block_size;
+            ssize_t n = read_fully(dest, direct, offset);
+            if (n < 0) return -1;
+            if (static_cast<size_t>(n) < direct) return n;
+        }
+        ssize_t n = read_bounced(dest + direct, count - direct, offset + static_cast<off_t>(direct));
+        if (n < 0) return direct > 0 ? static_cast<ssize_t>(direct) : -1;
+        return static_cast<ssize_t>(direct) + n;
+    }
+
+    // Offsets are logical; only the end of the file needs translating.
+    off_t lseek(off_t offset, int whence) {
+        if (whence == SEEK_END) return size() + offset;
+        if (whence == SEEK_SET) return offset;
+        return inner_ops.lseek(inner, offset, whence);
+    }
+
+    int fsync() { return inner_ops.fsync(inner); }
+
+private:
+    // A bounce buffer borrowed from the pool for one call.
+    struct Bounce {
+        DirectIoStorage& owner;
+        ScratchBuffer buffer;
+        explicit Bounce(DirectIoStorage& o) : owner(o) {
+            std::lock_guard<std::mutex> lock(owner.pool_mutex);
+            if (!owner.pool.empty()) {
+                buffer.swap(owner.pool.back());
+                owner.pool.pop_back();
+            }
+            buffer.resize(kBounceSize);
+        }
+        ~Bounce() {
+            std::lock_guard<std::mutex> lock(owner.pool_mutex);
+            owner.pool.push_back(std::move(buffer));
+        }
+        char* data() { return buffer.data(); }
+    };
+
+    storage_handle_t inner;
+    storage_operations_t inner_ops;
+    size_t block_size;
+    std::atomic<off_t> logical_size{0};
+
+    std::mutex size_mutex;
+    off_t physical_end = 0;    // Furthest padded end written; under size_mutex
+    size_t writes_inflight = 0; // Under size_mutex
+
+    std::mutex stripes[kStripes]; // Read-modify-write of edge blocks
+
+    std::mutex tail_mutex;
+    int64_t tail_index = -1; // Block held in tail_block (-1 = none); under tail_mutex
+    ScratchBuffer tail_block;
+
+    std::mutex pool_mutex;
+    std::vector<ScratchBuffer> pool;
+
+    bool is_aligned(off_t v) const { return static_cast<size_t>(v) % block_size == 0; }
+    bool is_aligned(size_t v) const { return v % block_size == 0; }
+    bool is_aligned(const void* p) const { return reinterpret_cast<uintptr_t>(p) % block_size == 0; }
+    off_t align_down(off_t v) const { return v / static_cast<off_t>(block_size) * static_cast<off_t>(block_size); }
+    off_t align_up(off_t v) const { return align_down(v + static_cast<off_t>(block_size) - 1); }
+    int64_t block_of(off_t v) const { return v / static_cast<off_t>(block_size); }
+
+    void begin_write() {
+        std::lock_guard<std::mutex> lock(size_mutex);
+        writes_inflight++;
+    }
+
+    // Extends the logical size and, once nothing else is being written,
+    // trims the padding past it. Trimming is best effort: a failure only
+    // leaves the padding in place.
+    void end_write(bool ok, off_t end, off_t padded_end) {
+        std::lock_guard<std::mutex> lock(size_mutex);
+        writes_inflight--;
+        physical_end = std::max(physical_end, padded_end);
+        off_t seen = logical_size.load();
+        if (ok && end > seen) logical_size = end;
+        off_t logical = logical_size.load();
+        if (writes_inflight == 0 && physical_end > logical && inner_ops.truncate &&
+            inner_ops.truncate(inner, logical) == 0)
+            physical_end = logical;
+    }
+
+    // Reads up to 'count' bytes, stopping early only at the end of storage.
+    // A partial block can only be the end, and reading on from there would
+    // not be aligned.
+    ssize_t read_fully(char* dest, size_t count, off_t offset) {
+        size_t done = 0;
+        while (done < count) {
+            ssize_t n = inner_ops.pread(inner, dest + done, count - done, offset + static_cast<off_t>(done));
+            if (n < 0) return -1;
+            if (n == 0) break;
+            done += static_cast<size_t>(n);
+            if (!is_aligned(static_cast<size_t>(n))) break;
+        }
+        return static_cast<ssize_t>(done);
+    }
+
+    bool write_fully(const char* src, size_t count, off_t offset) {
+        size_t done = 0;
+        while (done < count) {
+            ssize_t n = inner_ops.pwrite(inner, src + done, count - done, offset + static_cast<off_t>(done));
+            if (n < 0) return false;
+            if (n == 0) {
+                errno = EIO;
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Every segment is aligned already: hand them over as they are.
+    bool write_aligned(const conveyor_iovec_t* iov, int iovcnt, off_t offset) {
+        if (!inner_ops.pwritev) {
+            for (int i = 0; i < iovcnt; ++i) {
+                if (!write_fully(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len, offset)) return false;
+                offset += static_cast<off_t>(iov[i].iov_len);
+            }
+            return true;
+        }
+        std::vector<conveyor_iovec_t> rest(iov, iov + iovcnt);
+        size_t first = 0;
+        while (first < rest.size()) {
+            ssize_t n = inner_ops.pwritev(inner, rest.data() + first, static_cast<int>(rest.size() - first), offset);
+            if (n < 0) return false;
+            if (n == 0) {
+                errno = EIO;
+                return false;
+            }
+            offset += n;
+            size_t left = static_cast<size_t>(n);
+            while (first < rest.size() && left >= rest[first].iov_len) left -= rest[first++].iov_len;
+            if (left > 0) {
+                rest[first].iov_base = static_cast<char*>(rest[first].iov_base) + left;
+                rest[first].iov_len -= left;
+            }
+        }
+        return true;
+    }
+
+    // Fills 'dest' with the stored block at 'block_start', zeros past the
+    // end of storage.
+    bool load_block(char* dest, off_t block_start) {
+        {
+            std::lock_guard<std::mutex> lock(tail_mutex);
+            if (tail_index == block_of(block_start)) {
+                std::memcpy(dest, tail_block.data(), block_size);
+                return true;
+            }
+        }
+        ssize_t n = read_fully(dest, block_size, block_start);
+        if (n < 0) return false;
+        std::memset(dest + n, 0, block_size - static_cast<size_t>(n));
+        return true;
+    }
+
+    // Drops the kept block if [start, end) rewrote it.
+    void forget_tail(off_t start, off_t end) {
+        std::lock_guard<std::mutex> lock(tail_mutex);
+        if (tail_index >= block_of(start) && tail_index < block_of(end)) tail_index = -1;
+    }
+
+    bool write_bounced(const conveyor_iovec_t* iov, int iovcnt, size_t count, off_t offset) {
+        off_t end = offset + static_cast<off_t>(count);
+        off_t first = align_down(offset);
+        off_t last = align_up(end);
+
+        // Edge stripes, locked in index order.
+        size_t head_stripe = static_cast<size_t>(block_of(first)) % kStripes;
+        size_t tail_stripe = static_cast<size_t>(block_of(last - 1)) % kStripes;
+        std::unique_lock<std::mutex> lock_a(stripes[std::min(head_stripe, tail_stripe)]);
+        std::unique_lock<std::mutex> lock_b;
+        if (tail_stripe != head_stripe) lock_b = std::unique_lock<std::mutex>(stripes[std::max(head_stripe, tail_stripe)]);
+
+        Bounce bounce(*this);
+        int seg = 0;
+        size_t seg_off = 0;
+        for (off_t chunk = first; chunk < last; chunk += static_cast<off_t>(kBounceSize)) {
+            off_t chunk_end = std::min(chunk + static_cast<off_t>(kBounceSize), last);
+            size_t len = static_cast<size_t>(chunk_end - chunk);
+            char* b = bounce.data();
+            if (chunk < offset && !load_block(b, chunk)) return false;
+            if (chunk_end > end && !(chunk_end - static_cast<off_t>(block_size) == chunk && chunk < offset) &&
+                !load_block(b + len - block_size, chunk_end - static_cast<off_t>(block_size)))
+                return false;
+
+            // Gather this chunk's share of the caller's bytes.
+            size_t at = static_cast<size_t>(std::max(offset, chunk) - chunk);
+            size_t want = static_cast<size_t>(std::min(end, chunk_end) - std::max(offset, chunk));
+            while (want > 0) {
+                size_t n = std::min(want, iov[seg].iov_len - seg_off);
+                std::memcpy(b + at, static_cast<const char*>(iov[seg].iov_base) + seg_off, n);
+                at += n;
+                want -= n;
+                seg_off += n;
+                if (seg_off == iov[seg].iov_len && seg + 1 < iovcnt) {
+                    seg++;
+                    seg_off = 0;
+                }
+            }
+            if (!write_fully(b, len, chunk)) {
+                forget_tail(first, last);
+                return false;
+            }
+            if (chunk_end == last) {
+                std::lock_guard<std::mutex> lock(tail_mutex);
+                if (!is_aligned(end)) {
+                    tail_index = block_of(last - 1);
+                    std::memcpy(tail_block.data(), b + len - block_size, block_size);
+                } else if (tail_index >= block_of(first) && tail_index < block_of(last)) {
+                    tail_index = -1;
+                }
+            }
+        }
+        return true;
+    }
+
+    ssize_t read_bounced(char* dest, size_t count, off_t offset) {
+        if (count == 0) return 0;
+        off_t end = offset + static_cast<off_t>(count);
+        off_t first = align_down(offset);
+        off_t last = align_up(end);
+        Bounce bounce(*this);
+        size_t done = 0;
+        for (off_t chunk = first; chunk < last; chunk += static_cast<off_t>(kBounceSize)) {
+            size_t len = static_cast<size_t>(std::min(chunk + static_cast<off_t>(kBounceSize), last) - chunk);
+            ssize_t n = read_fully(bounce.data(), len, chunk);
+            if (n < 0) return done > 0 ? static_cast<ssize_t>(done) : -1;
+            off_t from = std::max(offset, chunk);
+            off_t to = std::min(end, chunk + n);
+            if (to <= from) break;
+            std::memcpy(dest + done, bounce.data() + (from - chunk), static_cast<size_t>(to - from));
+            done += static_cast<size_t>(to - from);
+            if (static_cast<size_t>(n) < len) break;
+        }
+        return static_cast<ssize_t>(done);
+    }
+
+    static DirectIoStorage* self(storage_handle_t h) { return static_cast<DirectIoStorage*>(h); }
+    static ssize_t pwrite_op(storage_handle_t h, const void* buf, size_t count, off_t offset) {
+        return self(h)->pwrite(buf, count, offset);
+    }
+    static ssize_t pwritev_op(storage_handle_t h, const conveyor_iovec_t* iov, int iovcnt, off_t offset) {
+        return self(h)->pwritev(iov, iovcnt, offset);
+    }
+    static ssize_t pread_op(storage_handle_t h, void* buf, size_t count, off_t offset) {
+        return self(h)->pread(buf, count, offset);
+    }
+    static off_t lseek_op(storage_handle_t h, off_t offset, int whence) {
+        return self(h)->lseek(offset, whence);
+    }
+    static int fsync_op(storage_handle_t h) { return self(h)->fsync(); }
+};
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_DIRECT_IO_H
@@ -0,0 +1,142 @@
+#ifndef LIBCONVEYOR_DETAIL_LATENCY_HISTOGRAM_H
+#define LIBCONVEYOR_DETAIL_LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t
+
+namespace libconveyor {
+
+// Log-linear latency histogram in nanoseconds, in the style of HdrHistogram:
+// every power of two is split into kSubBuckets linear buckets, so a recorded
+// value is known to within 1/kSubBuckets (about 3%) from 32 ns up to several
+// hours. Values below kSubBuckets are exact; larger ones than the last
+// bucket are clamped into it, while max() stays exact.
+//
+// Recording is a relaxed increment on a shard picked per thread. A shard is
+// only allocated the first time a thread that maps to it records, so a
+// conveyor driven from one thread pays for one. take() merges the shards and
+// resets them; a value recorded concurrently lands in this window or the
+// next, never in neither.
+// Thread-Safety: record() and take() may be called from any thread.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+    static constexpr int kMaxExponent = 43; // Top bucket starts at ~2.4 hours
+    static constexpr size_t kNumBuckets = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+    static constexpr size_t kShards = 8;
+
+    // The distribution of one window.
+    struct Snapshot {
+        uint64_t counts[kNumBuckets];
+        uint64_t count;
+        uint64_t max;
+
+        // Highest value equivalent to the q-th quantile (0 < q <= 1), capped
+        // at the exact maximum. 0 for an empty window.
+        uint64_t percentile(double q) const {
+            if (count == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count) + 0.5);
+            if (rank == 0) rank = 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kNumBuckets; i++) {
+                seen += counts[i];
+                if (seen >= rank) {
+                    uint64_t v = bucket_upper(i);
+                    return v < max ? v : max;
+                }
+            }
+            return max;
+        }
+    };
+
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    ~LatencyHistogram() {
+        for (auto& s : shards) delete s.load(std::memory_order_relaxed);
+    }
+
+    void record(uint64_t ns) {
+        Shard* s = shard(thread_slot() % kShards);
+        s->counts[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t prev = max_ns.load(std::memory_order_relaxed);
+        while (ns > prev && !max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Moves everything recorded since the last take() into 'out'.
+    void take(Snapshot& out) {
+        out.count = 0;
+        for (size_t i = 0; i < kNumBuckets; i++) out.counts[i] = 0;
+        for (auto& slot : shards) {
+            Shard* s = slot.load(std::memory_order_acquire);
+            if (!s) continue;
+            for (size_t i = 0; i < kNumBuckets; i++) {
+                if (s->counts[i].load(std::memory_order_relaxed) == 0) continue;
+                uint64_t n = s->counts[i].exchange(0, std::memory_order_relaxed);
+                out.counts[i] += n;
+                out.count += n;
+            }
+        }
+        out.max = max_ns.exchange(0, std::memory_order_relaxed);
+    }
+
+    static size_t bucket_index(uint64_t ns) {
+        if (ns < kSubBuckets) return static_cast<size_t>(ns);
+        int e = 63 - count_leading_zeros(ns); // >= kSubBucketBits
+        if (e > kMaxExponent) return kNumBuckets - 1;
+        uint64_t sub = (ns >> (e - kSubBucketBits)) & (kSubBuckets - 1);
+        return static_cast<size_t>((e - kSubBucketBits + 1) * kSubBuckets + sub);
+    }
+
+    // Largest value that lands in bucket 'i'.
+    static uint64_t bucket_upper(size_t i) {
+        if (i < kSubBuckets) return i;
+        int e = static_cast<int>(i / kSubBuckets) + kSubBucketBits - 1;
+        uint64_t sub = i % kSubBuckets;
+        uint64_t lower = (kSubBuckets + sub) << (e - kSubBucketBits);
+        return lower + (uint64_t(1) << (e - kSubBucketBits)) - 1;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counts[kNumBuckets] = {};
+    };
+
+    std::atomic<Shard*> shards[kShards] = {};
+    std::atomic<uint64_t> max_ns{0};
+
+    Shard* shard(size_t i) {
+        Shard* s = shards[i].load(std::memory_order_acquire);
+        if (s) return s;
+        Shard* fresh = new Shard();
+        if (shards[i].compare_exchange_strong(s, fresh, std::memory_order_acq_rel)) return fresh;
+        delete fresh; // Another thread won the race; 's' now holds its shard
+        return s;
+    }
+
+    // Threads are numbered in order of first use, which spreads them over
+    // the shards evenly.
+    static size_t thread_slot() {
+        static std::atomic<size_t> next{0};
+        thread_local size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    static int count_leading_zeros(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_clzll(v);
+#else
+        int n = 0;
+        for (uint64_t bit = uint64_t(1) << 63; !(v & bit); bit >>= 1) n++;
+        return n;
+#endif
+    }
+};
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_LATENCY_HISTOGRAM_H
@@ -0,0 +1,109 @@
+#ifndef LIBCONVEYOR_DETAIL_PLACEMENT_H
+#define LIBCONVEYOR_DETAIL_PLACEMENT_H
+
+#include "libconveyor/conveyor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace libconveyor {
+
+// A resolved conveyor_placement_t: the CPUs threads are pinned to and the
+// NUMA node buffers are bound to. Node CPU lists come from sysfs, so no
+// libnuma is needed. Off Linux, resolve() still checks its input but
+// nothing is pinned and no node is kept.
+// Thread-Safety: Immutable once resolved; pin() may be called from any thread.
+struct Placement {
+    std::vector<int> cpus; // Empty = unpinned
+    int node = -1;         // -1 = memory is not bound
+
+    // Fills in from 'p' (NULL = nothing to place). Returns false with errno
+    // EINVAL for a CPU or node that does not exist.
+    bool resolve(const conveyor_placement_t* p) {
+        cpus.clear();
+        node = -1;
+        if (!p) return true;
+        if ((p->cpus == nullptr) != (p->cpu_count == 0) || (p->bind_numa_node && p->numa_node < 0)) {
+            errno = EINVAL;
+            return false;
+        }
+        long limit = static_cast<long>(std::thread::hardware_concurrency());
+#ifdef __linux__
+        limit = std::min<long>(sysconf(_SC_NPROCESSORS_CONF), CPU_SETSIZE);
+#endif
+        for (size_t i = 0; i < p->cpu_count; ++i) {
+            int cpu = p->cpus[i];
+            if (cpu < 0 || (limit > 0 && cpu >= limit)) {
+                errno = EINVAL;
+                return false;
+            }
+            cpus.push_back(cpu);
+        }
+#ifdef __linux__
+        if (p->bind_numa_node) {
+            std::vector<int> node_cpus;
+            if (!read_node_cpus(p->numa_node, node_cpus)) {
+                errno = EINVAL;
+                return false;
+            }
+            node = p->numa_node;
+            if (cpus.empty()) cpus = node_cpus;
+        }
+#else
+        cpus.clear();
+#endif
+        return true;
+    }
+
+    // Pins 't' to the CPU set. Best effort: a thread the scheduler will not
+    // pin (a restricted cpuset) just keeps running where it may.
+    void pin(std::thread& t) const {
+#ifdef __linux__
+        if (cpus.empty()) return;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        }
+        pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#else
+        (void)t;
+#endif
+    }
+
+    // The CPUs of NUMA node 'n', from /sys/devices/system/node/node<n>/cpulist
+    // (ranges such as "0-3,8-11"). False when the node does not exist.
+    static bool read_node_cpus(int n, std::vector<int>& out) {
+        out.clear();
+        char path[64];
+        std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", n);
+        FILE* f = std::fopen(path, "r");
+        if (!f) return false;
+        int first, last;
+        char sep;
+        while (std::fscanf(f, "%d", &first) == 1) {
+            last = first;
+            if (std::fscanf(f, "%c", &sep) == 1 && sep == '-') {
+                if (std::fscanf(f, "%d", &last) != 1) break;
+                if (std::fscanf(f, "%c", &sep) != 1) sep = '\n';
+            }
+            for (int cpu = first; cpu <= last; ++cpu) out.push_back(cpu);
+            if (sep != ',') break;
+        }
+        std::fclose(f);
+        return true;
+    }
+};
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_PLACEMENT_H
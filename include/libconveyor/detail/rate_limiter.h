@@ -0,0 +1,118 @@
+#ifndef LIBCONVEYOR_DETAIL_RATE_LIMITER_H
+#define LIBCONVEYOR_DETAIL_RATE_LIMITER_H
+
+#include "libconveyor/conveyor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace libconveyor {
+
+// Token buckets of bytes and operations per second (conveyor_rate_limit_t).
+// Each holds up to kBurstSeconds of its rate and may run into debt: an
+// operation is admitted once both are non-negative and then takes its full
+// cost, so one larger than the burst still passes and delays the next.
+// Foreground operations go first: while one is waiting for tokens no
+// background operation is admitted.
+// Thread-Safety: All members may be called from any thread.
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr double kBurstSeconds = 0.1;
+    // How long background work backs off while foreground work is waiting.
+    static constexpr std::chrono::milliseconds kYield{1};
+
+    // Created on first use and never destroyed, like the memory budget.
+    static RateLimiter& shared() {
+        static RateLimiter* limiter = new RateLimiter();
+        return *limiter;
+    }
+
+    // Replaces the limit (NULL or zero rates = unlimited). The buckets
+    // start out full.
+    void set(const conveyor_rate_limit_t* limit) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bytes = Bucket(limit ? limit->bytes_per_sec : 0);
+        ops = Bucket(limit ? limit->ops_per_sec : 0);
+        last_refill = Clock::now();
+        enabled_.store(bytes.rate > 0 || ops.rate > 0, std::memory_order_release);
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_acquire); }
+
+    // Time until an operation of the given class would be admitted; zero
+    // means now.
+    Clock::duration delay(bool foreground) {
+        if (!enabled()) return Clock::duration::zero();
+        std::lock_guard<std::mutex> lock(mutex);
+        refill(Clock::now());
+        double seconds = std::max(bytes.deficit(), ops.deficit());
+        auto wait = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+        if (!foreground && foreground_waiting > 0) wait = std::max<Clock::duration>(wait, kYield);
+        return wait;
+    }
+
+    // Takes one admitted operation of 'count' bytes out of the buckets.
+    void consume(size_t count) {
+        if (!enabled()) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        refill(Clock::now());
+        bytes.take(static_cast<double>(count));
+        ops.take(1.0);
+    }
+
+    // Brackets the wait of a foreground operation, holding background
+    // operations back until it has been admitted.
+    void begin_foreground_wait() {
+        std::lock_guard<std::mutex> lock(mutex);
+        foreground_waiting++;
+    }
+    void end_foreground_wait() {
+        std::lock_guard<std::mutex> lock(mutex);
+        foreground_waiting--;
+    }
+
+private:
+    struct Bucket {
+        double rate = 0; // Per second; 0 = unlimited
+        double burst = 0;
+        double tokens = 0;
+
+        Bucket() = default;
+        explicit Bucket(size_t per_sec)
+            : rate(static_cast<double>(per_sec)),
+              burst(std::max(1.0, static_cast<double>(per_sec) * kBurstSeconds)),
+              tokens(burst) {}
+
+        // Seconds until the bucket is out of debt.
+        double deficit() const { return (rate > 0 && tokens < 0) ? -tokens / rate : 0.0; }
+        void take(double n) {
+            if (rate > 0) tokens -= n;
+        }
+        void add(double seconds) {
+            if (rate > 0) tokens = std::min(burst, tokens + seconds * rate);
+        }
+    };
+
+    // Thread-Safety: Must be called under mutex.
+    void refill(Clock::time_point now) {
+        double seconds = std::chrono::duration<double>(now - last_refill).count();
+        if (seconds <= 0) return;
+        last_refill = now;
+        bytes.add(seconds);
+        ops.add(seconds);
+    }
+
+    std::mutex mutex;
+    Bucket bytes;
+    Bucket ops;
+    Clock::time_point last_refill = Clock::now();
+    int foreground_waiting = 0;
+    std::atomic<bool> enabled_{false};
+};
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_RATE_LIMITER_H
@@ -0,0 +1,205 @@
+#ifndef LIBCONVEYOR_DETAIL_RING_ARENA_H
+#define LIBCONVEYOR_DETAIL_RING_ARENA_H
+
+#include <vector>
+#include <mutex>
+#include <new> // For std::bad_alloc
+#include <cstddef> // For size_t
+#include <cstdint> // For uintptr_t
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define LIBCONVEYOR_RING_ARENA_MMAP 1
+#endif
+
+#if defined(LIBCONVEYOR_RING_ARENA_MMAP) && defined(__linux__)
+#include <sys/syscall.h>
+#ifdef SYS_mbind
+#define LIBCONVEYOR_RING_ARENA_MBIND 1
+#endif
+#endif
+
+namespace libconveyor {
+
+// Process-wide source of ring buffer storage. Requests are rounded up to
+// power-of-two size classes, and released blocks are kept per class for the
+// next ring of that size instead of going back through the allocator.
+// Blocks are anonymous mappings: nothing is zero-filled up front, a page is
+// only backed once it is touched, and decommit()/release() hand the pages
+// back to the OS while the address range stays cached. Classes up to
+// kSlabClassMax are carved out of shared kSlabSize slabs, so thousands of
+// small rings do not cost a mapping each. Where mmap is unavailable blocks
+// come from operator new and are not cached. A block acquired for a NUMA
+// node carries an MPOL_PREFERRED policy for it (set with the raw mbind
+// syscall), so its pages land on that node whichever thread touches them
+// first; the policy is cleared again when the block is released.
+// Thread-Safety: All members may be called from any thread.
+struct RingArena {
+    struct Block {
+        char* data = nullptr;
+        size_t size = 0; // Class size; the usable length of 'data'
+        bool huge = false;
+        int node = -1; // NUMA node the pages are bound to (-1 = none)
+    };
+
+    static constexpr size_t kMinClass = 4096;
+    static constexpr size_t kSlabSize = 2 * 1024 * 1024;
+    static constexpr size_t kSlabClassMax = 256 * 1024;
+    static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+    static constexpr size_t kMaxCachedPerClass = 16;
+    static constexpr int kNumClasses = 48;
+
+    // Created on first use and never destroyed, so rings may outlive
+    // static destruction order.
+    static RingArena& shared() {
+        static RingArena* arena = new RingArena();
+        return *arena;
+    }
+
+    static size_t class_size(size_t bytes) {
+        size_t c = kMinClass;
+        while (c < bytes) c <<= 1;
+        return c;
+    }
+
+    // A block of at least 'bytes'. With 'huge', classes of kHugePageSize
+    // and up are aligned for and advised to use transparent huge pages.
+    // With a 'node' >= 0 the block's pages are preferably allocated there.
+    // Returns an empty block for 0 bytes; throws std::bad_alloc on failure.
+    Block acquire(size_t bytes, bool huge, int node = -1) {
+        Block b;
+        if (bytes == 0) return b;
+        b.size = class_size(bytes);
+        b.huge = huge && b.size >= kHugePageSize;
+#ifdef LIBCONVEYOR_RING_ARENA_MMAP
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<char*>& free_list = free_lists[b.huge][class_index(b.size)];
+            if (free_list.empty() && b.size <= kSlabClassMax) carve_slab(b.size, free_list);
+            if (!free_list.empty()) {
+                b.data = free_list.back();
+                free_list.pop_back();
+            }
+        }
+        if (!b.data) b.data = map(b.size, b.huge);
+        if (node >= 0 && bind(b.data, b.size, node)) b.node = node;
+#else
+        b.data = new char[b.size]; // Deliberately not value-initialized
+#endif
+        return b;
+    }
+
+    // Returns a block to its class. Its pages are dropped first, so a cached
+    // block costs address space only.
+    void release(Block b) {
+        if (!b.data) return;
+#ifdef LIBCONVEYOR_RING_ARENA_MMAP
+        decommit(b, 0, b.size);
+        if (b.node >= 0) bind(b.data, b.size, -1);
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<char*>& free_list = free_lists[b.huge][class_index(b.size)];
+        if (b.size <= kSlabClassMax || free_list.size() < kMaxCachedPerClass) {
+            free_list.push_back(b.data); // Slab pieces are never unmapped
+            return;
+        }
+        munmap(b.data, b.size);
+#else
+        delete[] b.data;
+#endif
+    }
+
+    // Hands the whole pages inside [from, to) of 'b' back to the OS. They
+    // read as zero when next touched.
+    void decommit(const Block& b, size_t from, size_t to) {
+#ifdef LIBCONVEYOR_RING_ARENA_MMAP
+        size_t page = page_size();
+        from = (from + page - 1) / page * page;
+        to = to / page * page;
+        if (b.data && from < to) madvise(b.data + from, to - from, MADV_DONTNEED);
+#else
+        (void)b; (void)from; (void)to;
+#endif
+    }
+
+    // Whether a block can be decommitted in place. Without it a shrinking
+    // ring has to move to a smaller block to give memory back.
+    static constexpr bool can_decommit() {
+#ifdef LIBCONVEYOR_RING_ARENA_MMAP
+        return true;
+#else
+        return false;
+#endif
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<char*> free_lists[2][kNumClasses]; // [huge][log2(size)]
+
+    static int class_index(size_t size) {
+        int i = 0;
+        while ((size_t(1) << i) < size) i++;
+        return i;
+    }
+
+#ifdef LIBCONVEYOR_RING_ARENA_MMAP
+    static size_t page_size() {
+        static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return page;
+    }
+
+    static char* map(size_t size, bool huge) {
+        size_t extra = huge ? kHugePageSize : 0; // Slack to align within
+        void* p = mmap(nullptr, size + extra, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS
+#ifdef MAP_NORESERVE
+                           | MAP_NORESERVE
+#endif
+                       , -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        char* data = static_cast<char*>(p);
+        if (huge) {
+            uintptr_t addr = reinterpret_cast<uintptr_t>(data);
+            size_t lead = (kHugePageSize - addr % kHugePageSize) % kHugePageSize;
+            if (lead > 0) munmap(data, lead);
+            if (extra - lead > 0) munmap(data + lead + size, extra - lead);
+            data += lead;
+#ifdef MADV_HUGEPAGE
+            madvise(data, size, MADV_HUGEPAGE);
+#endif
+        }
+        return data;
+    }
+
+    // Sets the memory policy of [data, data + size) to prefer 'node', or back
+    // to the default for -1. Pages already backed stay where they are; the
+    // arena's blocks arrive decommitted. Returns false where unsupported.
+    static bool bind(char* data, size_t size, int node) {
+#ifdef LIBCONVEYOR_RING_ARENA_MBIND
+        constexpr int kMpolDefault = 0;
+        constexpr int kMpolPreferred = 1;
+        constexpr size_t kBitsPerWord = sizeof(unsigned long) * 8;
+        if (reinterpret_cast<uintptr_t>(data) % page_size() != 0) return false;
+        if (node < 0) return syscall(SYS_mbind, data, size, kMpolDefault, nullptr, 0, 0) == 0;
+        std::vector<unsigned long> mask(static_cast<size_t>(node) / kBitsPerWord + 1, 0);
+        mask[node / kBitsPerWord] = 1UL << (node % kBitsPerWord);
+        return syscall(SYS_mbind, data, size, kMpolPreferred, mask.data(),
+                       mask.size() * kBitsPerWord, 0) == 0;
+#else
+        (void)data; (void)size; (void)node;
+        return false;
+#endif
+    }
+
+    // Splits a fresh slab into blocks of 'size' onto 'free_list'.
+    // Thread-Safety: Must be called under mutex.
+    static void carve_slab(size_t size, std::vector<char*>& free_list) {
+        char* slab = map(kSlabSize, false);
+        for (size_t off = 0; off + size <= kSlabSize; off += size) free_list.push_back(slab + off);
+    }
+#endif
+};
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_RING_ARENA_H
@@ -1,48 +1,92 @@
 #ifndef LIBCONVEYOR_DETAIL_RING_BUFFER_H
 #define LIBCONVEYOR_DETAIL_RING_BUFFER_H
 
-#include <vector>
 #include <cstddef> // For size_t
 #include <algorithm> // For std::min
 #include <cstring> // For std::memcpy
 
+#include "libconveyor/detail/ring_arena.h"
+
 namespace libconveyor {
 
+// A contiguous piece of the ring's storage.
+struct RingSegment {
+    char* data;
+    size_t len;
+};
+
+// Storage comes from the shared RingArena. A ring is created with the
+// largest capacity it may grow to, and its block is sized for that, so
+// growing usually just extends into memory that is already reserved (and
+// only backed by RAM once touched).
+// Thread-Safety: Not thread-safe; the owner serializes access.
 struct RingBuffer { // Still needed for read buffer
-    std::vector<char> buffer;
+    RingArena::Block storage;
     size_t capacity = 0;
     size_t head = 0;
     size_t tail = 0;
     size_t size = 0;
 
-    RingBuffer(size_t cap) : capacity(cap), buffer(cap) {}
+    RingBuffer(size_t cap, size_t max_cap = 0, bool huge = false, int node = -1)
+        : storage(RingArena::shared().acquire(std::max(cap, max_cap), huge, node)), capacity(cap) {}
+    ~RingBuffer() { RingArena::shared().release(storage); }
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // True when the buffered bytes do not run past the end of the ring.
+    bool contiguous() const { return tail + size <= capacity; }
 
-    // --- NEW: Resize Method ---
-    // Unrolls the circular buffer into a new larger linear buffer.
+    // Capacity the ring can grow to without moving its contents.
+    size_t reserved() const { return storage.size; }
+
+    // --- Resize Method ---
+    // Grows to new_capacity. While the block has room and the contents do
+    // not wrap, the ring simply extends into it: nothing is copied and every
+    // position stays valid. Otherwise the contents are unrolled into a new,
+    // larger block, which moves them to [0, size).
     // Thread-Safety: Must be called under lock.
     void resize(size_t new_capacity) {
         if (new_capacity <= capacity) return; // Only support growing
 
-        std::vector<char> new_buffer(new_capacity);
-
-        if (size > 0) {
-            if (head > tail) {
-                // Data is in a single contiguous block
-                std::memcpy(new_buffer.data(), buffer.data() + tail, size);
-            } else {
-                // Data is in two parts (wrapped)
-                size_t first_chunk = capacity - tail;
-                std::memcpy(new_buffer.data(), buffer.data() + tail, first_chunk);
-                std::memcpy(new_buffer.data() + first_chunk, buffer.data(), head);
-            }
+        if (new_capacity <= storage.size && contiguous()) {
+            head = tail + size;
+            capacity = new_capacity;
+            return;
         }
-
-        buffer = std::move(new_buffer);
+        RingArena::Block new_storage = RingArena::shared().acquire(new_capacity, storage.huge, storage.node);
+        unroll_into(new_storage.data);
+        RingArena::shared().release(storage);
+        storage = new_storage;
         capacity = new_capacity;
         head = size;
         tail = 0;
     }
 
+    // Shrinks to new_capacity and gives the memory past it back. An empty
+    // ring restarts at position 0; otherwise the contents must already lie
+    // below new_capacity, since moving them would invalidate positions.
+    // Returns false (and changes nothing) when that is not the case.
+    bool shrink(size_t new_capacity) {
+        if (new_capacity >= capacity) return false;
+        if (size == 0) {
+            head = tail = 0;
+        } else if (tail + size > new_capacity) {
+            return false;
+        }
+        size_t old_capacity = capacity;
+        capacity = new_capacity;
+        head = (tail + size) % capacity;
+        if (RingArena::can_decommit()) {
+            RingArena::shared().decommit(storage, new_capacity, old_capacity);
+        } else if (RingArena::class_size(new_capacity) < storage.size) {
+            RingArena::Block new_storage = RingArena::shared().acquire(new_capacity, storage.huge, storage.node);
+            std::memcpy(new_storage.data + tail, storage.data + tail, size);
+            RingArena::shared().release(storage);
+            storage = new_storage;
+        }
+        return true;
+    }
+
     size_t write(const char* data, size_t len) {
         if (len == 0) return 0;
         
@@ -50,10 +94,10 @@ struct RingBuffer { // Still needed for read buffer
         if (bytes_to_write == 0) return 0;
         
         size_t first_chunk_len = std::min(bytes_to_write, capacity - head);
-        std::memcpy(buffer.data() + head, data, first_chunk_len);
+        std::memcpy(storage.data + head, data, first_chunk_len);
 
         if (bytes_to_write > first_chunk_len) {
-            std::memcpy(buffer.data(), data + first_chunk_len, bytes_to_write - first_chunk_len);
+            std::memcpy(storage.data, data + first_chunk_len, bytes_to_write - first_chunk_len);
         }
         head = (head + bytes_to_write) % capacity;
         size += bytes_to_write;
@@ -68,9 +112,9 @@ struct RingBuffer { // Still needed for read buffer
         
         if (data != nullptr) {
             size_t first_chunk_len = std::min(bytes_to_read, capacity - tail);
-            std::memcpy(data, buffer.data() + tail, first_chunk_len);
+            std::memcpy(data, storage.data + tail, first_chunk_len);
             if (bytes_to_read > first_chunk_len) {
-                std::memcpy(data + first_chunk_len, buffer.data(), bytes_to_read - first_chunk_len);
+                std::memcpy(data + first_chunk_len, storage.data, bytes_to_read - first_chunk_len);
             }
         }
         
@@ -84,18 +128,64 @@ struct RingBuffer { // Still needed for read buffer
     size_t peek_at(size_t absolute_ring_pos, char* dest, size_t len) const {
         size_t offset = absolute_ring_pos % capacity;
         size_t first_chunk = std::min(len, capacity - offset);
-        std::memcpy(dest, buffer.data() + offset, first_chunk);
+        std::memcpy(dest, storage.data + offset, first_chunk);
         if (len > first_chunk) {
-            std::memcpy(dest + first_chunk, buffer.data(), len - first_chunk);
+            std::memcpy(dest + first_chunk, storage.data, len - first_chunk);
         }
         return len;
     }
 
+    // Describes 'len' bytes starting at absolute_ring_pos as at most two
+    // contiguous segments (two when the range wraps). Returns the count.
+    size_t segments_at(size_t absolute_ring_pos, size_t len, RingSegment out[2]) {
+        if (len == 0) return 0;
+        size_t offset = absolute_ring_pos % capacity;
+        size_t first_chunk = std::min(len, capacity - offset);
+        out[0] = {storage.data + offset, first_chunk};
+        if (len == first_chunk) return 1;
+        out[1] = {storage.data, len - first_chunk};
+        return 2;
+    }
+
+    // Counterpart of peek_at: copies 'len' bytes into the free region
+    // starting at absolute_ring_pos without touching head or size. The
+    // caller later makes them visible with commit().
+    void write_at(size_t absolute_ring_pos, const char* src, size_t len) {
+        size_t offset = absolute_ring_pos % capacity;
+        size_t first_chunk = std::min(len, capacity - offset);
+        std::memcpy(storage.data + offset, src, first_chunk);
+        if (len > first_chunk) {
+            std::memcpy(storage.data, src + first_chunk, len - first_chunk);
+        }
+    }
+
+    // Accounts for 'len' bytes already placed at 'head' by write_at().
+    void commit(size_t len) {
+        head = (head + len) % capacity;
+        size += len;
+    }
+
+    // Keeps only the oldest 'len' buffered bytes, dropping the rest.
+    void truncate(size_t len) {
+        if (len >= size) return;
+        head = (tail + len) % capacity;
+        size = len;
+    }
+
     void clear() { size = 0; head = 0; tail = 0; }
     bool empty() const { return size == 0; }
     bool full() const { return size == capacity; }
     size_t available_space() const { return capacity - size; }
     size_t available_data() const { return size; }
+
+private:
+    // Copies the contents, oldest first, to the start of 'dest'.
+    void unroll_into(char* dest) const {
+        if (size == 0) return;
+        size_t first_chunk = std::min(size, capacity - tail);
+        std::memcpy(dest, storage.data + tail, first_chunk);
+        if (size > first_chunk) std::memcpy(dest + first_chunk, storage.data, size - first_chunk);
+    }
 };
 
 } // namespace libconveyor
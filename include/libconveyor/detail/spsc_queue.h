@@ -0,0 +1,65 @@
+#ifndef LIBCONVEYOR_DETAIL_SPSC_QUEUE_H
+#define LIBCONVEYOR_DETAIL_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef> // For size_t
+#include <vector>
+
+namespace libconveyor {
+
+// Bounded single-producer/single-consumer queue. One thread may push and one
+// thread (or several, serialized by an external lock) may pop. The producer
+// and consumer indices live on separate cache lines, and each side caches the
+// other's index so the common case touches no shared line at all.
+template <typename T>
+struct SpscQueue {
+    std::vector<T> slots;
+    size_t mask = 0;
+
+    alignas(64) std::atomic<size_t> tail{0}; // Next slot to push (producer)
+    size_t cached_head = 0;                  // Producer's view of 'head'
+
+    alignas(64) std::atomic<size_t> head{0}; // Next slot to pop (consumer)
+    size_t cached_tail = 0;                  // Consumer's view of 'tail'
+
+    // Capacity is rounded up to a power of two.
+    SpscQueue(size_t cap) {
+        size_t n = 1;
+        while (n < cap) n <<= 1;
+        slots.resize(n);
+        mask = n - 1;
+    }
+
+    bool try_push(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head > mask) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head > mask) return false;
+        }
+        slots[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& out) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h == cached_tail) return false;
+        }
+        out = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Safe to call from either side; the answer may be stale by the time it
+    // is used.
+    bool empty() const {
+        return head.load(std::memory_order_acquire) ==
+               tail.load(std::memory_order_acquire);
+    }
+};
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_SPSC_QUEUE_H
@@ -0,0 +1,82 @@
+#ifndef LIBCONVEYOR_DETAIL_TRACE_LOG_H
+#define LIBCONVEYOR_DETAIL_TRACE_LOG_H
+
+#include "libconveyor/conveyor.h"
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint> // For uint64_t
+#include <mutex>
+#include <vector>
+
+namespace libconveyor {
+
+// Fixed-size log of the most recent trace records. Recording claims a slot
+// with one fetch_add and never blocks; once the log is full the oldest
+// records are overwritten. Each slot carries a sequence number that is odd
+// while a record is being written, so a reader skips records that are torn
+// or were overwritten while it copied them.
+// Thread-Safety: record() may be called from any thread; drain() is
+// serialized internally.
+class TraceLog {
+public:
+    explicit TraceLog(size_t capacity) : slots(capacity > 0 ? capacity : 1) {}
+
+    void record(const conveyor_trace_record_t& r) {
+        uint64_t i = head.fetch_add(1, std::memory_order_relaxed);
+        Slot& s = slots[i % slots.size()];
+        s.seq.store(2 * i + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.event.store(static_cast<int>(r.event), std::memory_order_relaxed);
+        s.timestamp_ns.store(r.timestamp_ns, std::memory_order_relaxed);
+        s.duration_ns.store(r.duration_ns, std::memory_order_relaxed);
+        s.offset.store(static_cast<int64_t>(r.offset), std::memory_order_relaxed);
+        s.bytes.store(r.bytes, std::memory_order_relaxed);
+        s.thread_id.store(r.thread_id, std::memory_order_relaxed);
+        s.seq.store(2 * i + 2, std::memory_order_release);
+    }
+
+    // Moves up to 'max' of the oldest records not yet drained into 'out',
+    // in the order they were claimed. Returns how many were copied.
+    size_t drain(conveyor_trace_record_t* out, size_t max) {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t end = head.load(std::memory_order_acquire);
+        if (end - tail > slots.size()) tail = end - slots.size(); // Overwritten
+        size_t n = 0;
+        while (tail < end && n < max) {
+            uint64_t i = tail++;
+            Slot& s = slots[i % slots.size()];
+            if (s.seq.load(std::memory_order_acquire) != 2 * i + 2) continue;
+            conveyor_trace_record_t r;
+            r.event = static_cast<conveyor_trace_event_t>(s.event.load(std::memory_order_relaxed));
+            r.timestamp_ns = s.timestamp_ns.load(std::memory_order_relaxed);
+            r.duration_ns = s.duration_ns.load(std::memory_order_relaxed);
+            r.offset = static_cast<off_t>(s.offset.load(std::memory_order_relaxed));
+            r.bytes = s.bytes.load(std::memory_order_relaxed);
+            r.thread_id = s.thread_id.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != 2 * i + 2) continue;
+            out[n++] = r;
+        }
+        return n;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<int> event{0};
+        std::atomic<unsigned long long> timestamp_ns{0};
+        std::atomic<unsigned long long> duration_ns{0};
+        std::atomic<int64_t> offset{0};
+        std::atomic<size_t> bytes{0};
+        std::atomic<unsigned long long> thread_id{0};
+    };
+
+    std::vector<Slot> slots;
+    std::atomic<uint64_t> head{0};
+    std::mutex mutex;
+    uint64_t tail = 0; // Guarded by mutex
+};
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_TRACE_LOG_H
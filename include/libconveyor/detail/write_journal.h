@@ -0,0 +1,374 @@
+#ifndef LIBCONVEYOR_DETAIL_WRITE_JOURNAL_H
+#define LIBCONVEYOR_DETAIL_WRITE_JOURNAL_H
+
+#include <cerrno>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <sys/types.h> // For off_t
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LIBCONVEYOR_JOURNAL_MMAP 1
+#endif
+
+namespace libconveyor {
+
+// Write-behind journal (conveyor_config_t::journal_path): a memory-mapped
+// file holding a copy of every write that has not reached storage yet, so
+// that writes lost with the process can be replayed by conveyor_recover.
+// Records are appended in queue order to a circular region behind a header
+// page and dropped from its tail as the writes retire; the header keeps
+// where the oldest live record is and the sequence number it carries. A
+// record only counts as live if it sits where the scan expects it, with the
+// next sequence number and a matching checksum, so stale and torn records
+// end the scan. A record survives the process as soon as it is copied into
+// the mapping; in sync mode append also msyncs it before returning, so it
+// survives the machine too. The header is only synced before space freed
+// since its last sync is reused: until then a crash leaves it on an older
+// tail whose records are still intact, and replaying them again is harmless.
+// The file is locked (flock) while open, so two conveyors cannot share it.
+// Thread-Safety: Not thread-safe; the conveyor calls it under write_mutex.
+class WriteJournal {
+public:
+    static constexpr size_t kHeaderSize = 4096;
+    static constexpr size_t kRecordHeader = 32;
+
+    WriteJournal() = default;
+    WriteJournal(const WriteJournal&) = delete;
+    WriteJournal& operator=(const WriteJournal&) = delete;
+    ~WriteJournal() { close(); }
+
+    // Opens (creating it if need be) the journal at 'path' with 'capacity'
+    // bytes of record space, msyncing each record as it is appended if
+    // 'sync'. Returns false with errno set: EEXIST when it still holds
+    // records conveyor_recover has not replayed, EBUSY when another conveyor
+    // has it open.
+    bool open(const char* path, size_t capacity, bool sync) {
+#ifdef LIBCONVEYOR_JOURNAL_MMAP
+        if (!attach(path, true)) return false;
+        if (!live.empty()) return fail(EEXIST);
+        unmap();
+        capacity = (capacity + 7) & ~size_t(7);
+        off_t size = static_cast<off_t>(kHeaderSize + capacity);
+        // Reserve the blocks up front: a store into a hole the filesystem
+        // cannot fill would raise SIGBUS instead of failing a write.
+#ifdef __linux__
+        int err = ::posix_fallocate(fd, 0, size);
+        if (err != 0 && err != EOPNOTSUPP && err != EINVAL) return fail(err);
+#endif
+        if (::ftruncate(fd, size) != 0 || !map(static_cast<size_t>(size))) return fail(errno);
+        cap = capacity;
+        head = tail = used = 0;
+        store_tail();
+        syncing = sync;
+        if (syncing && !sync_header()) return fail(errno);
+        return true;
+#else
+        (void)path;
+        (void)capacity;
+        (void)sync;
+        errno = ENOSYS;
+        return false;
+#endif
+    }
+
+    // Opens an existing journal to replay it. Returns false with errno set
+    // (ENOENT when there is none).
+    bool load(const char* path) {
+#ifdef LIBCONVEYOR_JOURNAL_MMAP
+        return attach(path, false);
+#else
+        (void)path;
+        errno = ENOSYS;
+        return false;
+#endif
+    }
+
+    bool is_open() const { return base != nullptr; }
+    size_t pending() const { return live.size(); }
+
+    // The largest write that can be appended right now.
+    size_t room() const {
+        size_t run;
+        if (used == 0) {
+            run = cap;
+        } else if (head > tail) {
+            run = cap - head > tail ? cap - head : tail; // Or wrap round
+        } else {
+            run = head < tail ? tail - head : 0;
+        }
+        return run < kRecordHeader ? 0 : (run - kRecordHeader) & ~size_t(7);
+    }
+
+    // Appends the write of 'a' then 'b' to 'offset'; the total must fit in
+    // room(). Returns false with errno set if the record could not be
+    // synced; it is in the journal all the same.
+    bool append(off_t offset, const char* a, size_t alen, const char* b, size_t blen) {
+        if (syncing && header_dirty && !sync_header()) return false;
+        size_t count = alen + blen;
+        size_t size = record_size(count);
+        size_t waste = 0;
+        size_t start = head;
+        if (used > 0 && head >= tail && cap - head < size) {
+            waste = cap - head;
+            if (waste >= kRecordHeader) {
+                Record wrap = {kWrapMagic, 0, next_seq, 0, 0};
+                wrap.checksum = checksum(wrap, nullptr);
+                std::memcpy(region() + head, &wrap, sizeof(wrap));
+            }
+            head = 0;
+        }
+        char* data = region() + head + kRecordHeader;
+        if (alen > 0) std::memcpy(data, a, alen);
+        if (blen > 0) std::memcpy(data + alen, b, blen);
+        Record r = {kRecordMagic, 0, next_seq, static_cast<int64_t>(offset), count};
+        r.checksum = checksum(r, data);
+        std::memcpy(region() + head, &r, sizeof(r));
+        live.push_back({next_seq, head, waste + size});
+        used += waste + size;
+        head += size;
+        next_seq++;
+        if (!syncing) return true;
+        if (waste > 0) // The wrap marker, then the record at the start
+            return (waste < kRecordHeader || sync_region(start, waste)) && sync_region(0, head);
+        return sync_region(start, size);
+    }
+
+    // Drops the oldest record, whose write has reached storage.
+    void retire() {
+        if (live.empty()) return;
+        Live front = live.front();
+        live.pop_front();
+        used -= front.bytes;
+        tail = front.pos + record_size(length_at(front.pos));
+        if (tail >= cap || used == 0) tail = 0;
+        if (used == 0) head = 0;
+        store_tail();
+    }
+
+    // Calls fn(offset, data, length) on each live record, oldest first,
+    // stopping at the first that returns false. Returns whether all passed.
+    template <typename Fn>
+    bool for_each(Fn&& fn) const {
+        for (const Live& l : live) {
+            Record r;
+            std::memcpy(&r, region() + l.pos, sizeof(r));
+            if (!fn(static_cast<off_t>(r.offset), region() + l.pos + kRecordHeader,
+                    static_cast<size_t>(r.length)))
+                return false;
+        }
+        return true;
+    }
+
+    // Forgets every live record (they have been replayed).
+    void clear() {
+        live.clear();
+        head = tail = used = 0;
+        if (is_open()) {
+            store_tail();
+            sync_header();
+        }
+    }
+
+    void close() {
+        unmap();
+#ifdef LIBCONVEYOR_JOURNAL_MMAP
+        if (fd >= 0) ::close(fd); // Drops the lock
+#endif
+        fd = -1;
+        live.clear();
+        cap = head = tail = used = 0;
+        syncing = header_dirty = false;
+    }
+
+private:
+    static constexpr uint64_t kMagic = 0x4c4e524a564e4f43ull; // "CONVJRNL"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kRecordMagic = 0x44524352; // "RCRD"
+    static constexpr uint32_t kWrapMagic = 0x50415257;   // "WRAP"
+
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t capacity;
+        uint64_t tail;     // Region offset of the oldest live record
+        uint64_t tail_seq; // Its sequence number (the next one when empty)
+    };
+
+    // A wrap marker has no data and the sequence number of the record
+    // after it, which is at the start of the region; so does a tail too
+    // close to the end for a marker.
+    struct Record {
+        uint32_t magic;
+        uint32_t checksum; // Over the rest of the record and its data
+        uint64_t seq;
+        int64_t offset;
+        uint64_t length;
+    };
+    static_assert(sizeof(Record) == kRecordHeader, "record header layout");
+
+    struct Live {
+        uint64_t seq;
+        size_t pos;
+        size_t bytes; // Its size, plus the end of the region skipped before it
+    };
+
+    static size_t record_size(size_t count) { return kRecordHeader + ((count + 7) & ~size_t(7)); }
+
+    static uint64_t mix(uint64_t h, uint64_t w) {
+        h ^= w * 0x87c37b91114253d5ull;
+        h = (h << 31) | (h >> 33);
+        return h * 0x4cf5ad432745937full;
+    }
+
+    static uint32_t checksum(const Record& r, const char* data) {
+        uint64_t h = mix(mix(mix(r.magic, r.seq), static_cast<uint64_t>(r.offset)), r.length);
+        size_t i = 0;
+        for (; i + 8 <= r.length; i += 8) {
+            uint64_t w;
+            std::memcpy(&w, data + i, 8);
+            h = mix(h, w);
+        }
+        uint64_t w = 0;
+        if (i < r.length) std::memcpy(&w, data + i, r.length - i);
+        h = mix(h, w);
+        return static_cast<uint32_t>(h ^ (h >> 32));
+    }
+
+    char* region() const { return base + kHeaderSize; }
+    Header* header() const { return reinterpret_cast<Header*>(base); }
+
+    size_t length_at(size_t pos) const {
+        Record r;
+        std::memcpy(&r, region() + pos, sizeof(r));
+        return static_cast<size_t>(r.length);
+    }
+
+    void store_tail() {
+        Header h = {kMagic, kVersion, 0, cap, tail, live.empty() ? next_seq : live.front().seq};
+        std::memcpy(base, &h, sizeof(h));
+        header_dirty = true;
+    }
+
+    // msyncs 'len' bytes of the mapping from 'pos' (widened to whole pages).
+    bool sync_range(size_t pos, size_t len) {
+#ifdef LIBCONVEYOR_JOURNAL_MMAP
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t start = pos & ~(page - 1);
+        return ::msync(base + start, pos + len - start, MS_SYNC) == 0;
+#else
+        (void)pos;
+        (void)len;
+        return true;
+#endif
+    }
+
+    bool sync_region(size_t pos, size_t len) { return sync_range(kHeaderSize + pos, len); }
+
+    bool sync_header() {
+        if (!sync_range(0, sizeof(Header))) return false;
+        header_dirty = false;
+        return true;
+    }
+
+    bool fail(int err) {
+        close();
+        errno = err;
+        return false;
+    }
+
+#ifdef LIBCONVEYOR_JOURNAL_MMAP
+    bool attach(const char* path, bool create) {
+        close();
+        fd = ::open(path, O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0), 0644);
+        if (fd < 0) return false;
+        if (::flock(fd, LOCK_EX | LOCK_NB) != 0) return fail(errno == EWOULDBLOCK ? EBUSY : errno);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) return fail(errno);
+        next_seq = 1;
+        if (static_cast<size_t>(st.st_size) > kHeaderSize) {
+            if (!map(static_cast<size_t>(st.st_size))) return fail(errno);
+            Header h;
+            std::memcpy(&h, base, sizeof(h));
+            if (h.magic == kMagic && h.version == kVersion &&
+                h.capacity <= static_cast<size_t>(st.st_size) - kHeaderSize && h.tail < h.capacity)
+                scan(h);
+        }
+        return true;
+    }
+
+    // Rebuilds the live records from the file, starting at the tail.
+    void scan(const Header& h) {
+        cap = static_cast<size_t>(h.capacity);
+        tail = head = static_cast<size_t>(h.tail);
+        next_seq = h.tail_seq;
+        size_t waste = 0;
+        while (used + waste < cap) {
+            if (cap - head < kRecordHeader) {
+                if (waste > 0) break; // Wrapped without finding a record
+                waste = cap - head;
+                head = 0;
+                continue;
+            }
+            Record r;
+            std::memcpy(&r, region() + head, sizeof(r));
+            if (r.seq != next_seq) break;
+            if (r.magic == kWrapMagic && waste == 0 && r.length == 0 &&
+                r.checksum == checksum(r, nullptr)) {
+                waste = cap - head;
+                head = 0;
+                continue;
+            }
+            if (r.magic != kRecordMagic || r.length > cap - head - kRecordHeader ||
+                r.checksum != checksum(r, region() + head + kRecordHeader))
+                break;
+            size_t size = record_size(static_cast<size_t>(r.length));
+            live.push_back({next_seq, head, waste + size});
+            used += waste + size;
+            head += size;
+            waste = 0;
+            next_seq++;
+        }
+        if (live.empty()) head = tail = used = 0;
+    }
+
+    bool map(size_t size) {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) return false;
+        base = static_cast<char*>(p);
+        mapped = size;
+        return true;
+    }
+#endif
+
+    void unmap() {
+#ifdef LIBCONVEYOR_JOURNAL_MMAP
+        if (base) ::munmap(base, mapped);
+#endif
+        base = nullptr;
+        mapped = 0;
+    }
+
+    int fd = -1;
+    char* base = nullptr;
+    size_t mapped = 0;
+    size_t cap = 0; // Bytes of record space
+    size_t head = 0; // Where the next record goes
+    size_t tail = 0; // The oldest live record
+    size_t used = 0; // Bytes held by live records
+    uint64_t next_seq = 1;
+    bool syncing = false;      // msync records as they are appended
+    bool header_dirty = false; // The tail moved since the header was synced
+    std::deque<Live> live;
+};
+
+} // namespace libconveyor
+
+#endif // LIBCONVEYOR_DETAIL_WRITE_JOURNAL_H
@@ -0,0 +1,33 @@
+#ifndef LIBCONVEYOR_IO_URING_BACKEND_H
+#define LIBCONVEYOR_IO_URING_BACKEND_H
+
+#include "libconveyor/conveyor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Built-in Linux backend that fronts a file descriptor with io_uring. The
+// handle owns one submission/completion ring per direction, so a conveyor
+// keeps its whole write_queue_depth / read_ahead_depth in flight from one
+// thread each, and everything queued between two reaps goes to the kernel
+// in a single io_uring_enter call.
+//
+// Opens a backend for 'fd' (which stays owned by the caller) with rings of
+// at least queue_depth entries. Returns NULL with errno set when io_uring is
+// unavailable (ENOSYS when built without it, or whatever the kernel says).
+storage_handle_t conveyor_uring_open(int fd, unsigned queue_depth);
+
+// Releases the rings. Destroy every conveyor using the handle first.
+void conveyor_uring_close(storage_handle_t handle);
+
+// Operations for a handle from conveyor_uring_open: plain pread/pwrite/
+// pwritev/lseek/fdatasync/ftruncate syscalls plus the asynchronous
+// submit/reap pair.
+storage_operations_t conveyor_uring_ops(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // LIBCONVEYOR_IO_URING_BACKEND_H
@@ -0,0 +1,35 @@
+#ifndef LIBCONVEYOR_MMAP_BACKEND_H
+#define LIBCONVEYOR_MMAP_BACKEND_H
+
+#include "libconveyor/conveyor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Built-in backend that maps a file descriptor read-only into memory. Writes
+// are plain pwrite/pwritev syscalls, so they still go through the write
+// buffer; reads are served from the page cache through storage_operations_t
+// ::map, with no read buffer or read workers, and read-ahead becomes
+// madvise(MADV_WILLNEED) over the window ahead of the reader.
+//
+// Opens a backend for 'fd' (which stays owned by the caller and must be
+// open for reading). 'max_size' bytes of address space are reserved up
+// front (0 = 1 TiB on 64-bit systems) so the mapping can follow the file
+// as it grows without moving; bytes past it fail to map with EFBIG. The
+// file must not be truncated while the handle is open. Returns NULL with
+// errno set (ENOSYS where mmap is unavailable).
+storage_handle_t conveyor_mmap_open(int fd, size_t max_size);
+
+// Unmaps the file. Destroy every conveyor using the handle first.
+void conveyor_mmap_close(storage_handle_t handle);
+
+// Operations for a handle from conveyor_mmap_open: pread/pwrite/pwritev/
+// lseek/fdatasync syscalls plus map and advise.
+storage_operations_t conveyor_mmap_ops(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // LIBCONVEYOR_MMAP_BACKEND_H
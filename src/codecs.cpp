@@ -0,0 +1,107 @@
+#include "libconveyor/codecs.h"
+
+#include <cerrno>
+#include <cstdint> // For intptr_t
+
+#ifdef LIBCONVEYOR_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef LIBCONVEYOR_HAVE_ZSTD
+#include <zstd.h>
+#include <zstd_errors.h> // For ZSTD_error_dstSize_tooSmall
+#endif
+
+namespace libconveyor {
+namespace {
+
+#ifdef LIBCONVEYOR_HAVE_LZ4
+
+ssize_t lz4_compress(void *, const void *src, size_t src_len, void *dst,
+                     size_t dst_cap) {
+  if (src_len > LZ4_MAX_INPUT_SIZE) {
+    errno = EINVAL;
+    return -1;
+  }
+  // 0 when the output would not fit in dst_cap, which is what we report.
+  return LZ4_compress_default(static_cast<const char *>(src),
+                              static_cast<char *>(dst), static_cast<int>(src_len),
+                              static_cast<int>(dst_cap));
+}
+
+ssize_t lz4_decompress(void *, const void *src, size_t src_len, void *dst,
+                       size_t dst_cap) {
+  int n = LZ4_decompress_safe(static_cast<const char *>(src),
+                              static_cast<char *>(dst), static_cast<int>(src_len),
+                              static_cast<int>(dst_cap));
+  if (n < 0) {
+    errno = EIO;
+    return -1;
+  }
+  return n;
+}
+
+#endif // LIBCONVEYOR_HAVE_LZ4
+
+#ifdef LIBCONVEYOR_HAVE_ZSTD
+
+// The level travels in the context pointer, so the codec needs no state.
+ssize_t zstd_compress(void *context, const void *src, size_t src_len,
+                      void *dst, size_t dst_cap) {
+  int level = static_cast<int>(reinterpret_cast<intptr_t>(context));
+  size_t n = ZSTD_compress(dst, dst_cap, src, src_len, level);
+  if (ZSTD_isError(n)) {
+    if (ZSTD_getErrorCode(n) == ZSTD_error_dstSize_tooSmall)
+      return 0;
+    errno = EIO;
+    return -1;
+  }
+  return static_cast<ssize_t>(n);
+}
+
+ssize_t zstd_decompress(void *, const void *src, size_t src_len, void *dst,
+                        size_t dst_cap) {
+  size_t n = ZSTD_decompress(dst, dst_cap, src, src_len);
+  if (ZSTD_isError(n)) {
+    errno = EIO;
+    return -1;
+  }
+  return static_cast<ssize_t>(n);
+}
+
+#endif // LIBCONVEYOR_HAVE_ZSTD
+
+} // namespace
+} // namespace libconveyor
+
+int conveyor_codec_lz4(conveyor_codec_t *codec) {
+  if (!codec) {
+    errno = EINVAL;
+    return -1;
+  }
+#ifdef LIBCONVEYOR_HAVE_LZ4
+  codec->compress = libconveyor::lz4_compress;
+  codec->decompress = libconveyor::lz4_decompress;
+  codec->context = nullptr;
+  return 0;
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+int conveyor_codec_zstd(int level, conveyor_codec_t *codec) {
+  if (!codec) {
+    errno = EINVAL;
+    return -1;
+  }
+#ifdef LIBCONVEYOR_HAVE_ZSTD
+  codec->compress = libconveyor::zstd_compress;
+  codec->decompress = libconveyor::zstd_decompress;
+  codec->context = reinterpret_cast<void *>(static_cast<intptr_t>(level));
+  return 0;
+#else
+  (void)level;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
@@ -1,29 +1,94 @@
 #include "libconveyor/conveyor.h"
+#include "libconveyor/detail/access_pattern.h"
+#include "libconveyor/detail/block_cache.h"
+#include "libconveyor/detail/block_codec.h"
+#include "libconveyor/detail/direct_io.h"
+#include "libconveyor/detail/latency_histogram.h"
+#include "libconveyor/detail/placement.h"
+#include "libconveyor/detail/rate_limiter.h"
 #include "libconveyor/detail/ring_buffer.h"
+#include "libconveyor/detail/spsc_queue.h"
+#include "libconveyor/detail/trace_log.h"
+#include "libconveyor/detail/write_journal.h"
 #include <algorithm>
 #include <atomic>
 #include <cerrno>
 #include <chrono>
 #include <condition_variable>
+#include <cstdio>
 #include <cstring> // For memcpy
 #include <deque>
+#include <limits> // For std::numeric_limits
+#include <map>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 
 #ifndef O_ACCMODE
 #define O_ACCMODE (O_RDONLY | O_WRONLY | O_RDWR)
 #endif
 
+// Trace points. BEGIN yields a timestamp to hand to the matching END, which
+// records the duration. Built with LIBCONVEYOR_NO_TRACING they compile to
+// nothing; otherwise an untraced conveyor pays one branch.
+#ifndef LIBCONVEYOR_NO_TRACING
+#define LIBCONVEYOR_TRACE_BEGIN(impl, ev, off, bytes)                          \
+  ((impl)->tracing ? (impl)->trace((ev), (off), (bytes), 0) : int64_t(0))
+#define LIBCONVEYOR_TRACE_END(impl, ev, off, bytes, begin_ns)                  \
+  ((impl)->tracing ? (void)(impl)->trace((ev), (off), (bytes), (begin_ns))     \
+                   : (void)0)
+#else
+#define LIBCONVEYOR_TRACE_BEGIN(impl, ev, off, bytes) int64_t(0)
+#define LIBCONVEYOR_TRACE_END(impl, ev, off, bytes, begin_ns)                  \
+  ((void)(bytes), (void)(begin_ns))
+#endif
+#define LIBCONVEYOR_TRACE(impl, ev, off, bytes)                                \
+  LIBCONVEYOR_TRACE_END(impl, ev, off, bytes, 0)
+
 namespace libconveyor {
 
+struct Executor;
+struct MemoryBudget;
+
 // --- OPTIMIZATION 1: Lightweight Metadata Struct ---
 // No longer owns a std::vector. Just points to the RingBuffer.
 struct WriteRequest {
   off_t file_offset;      // Where in the file to write
   size_t length;          // Length of data
   size_t ring_buffer_pos; // Starting index in the write_ring_buffer
+  uint64_t seq = 0;       // Enqueue order, used to locate it in write_queue
+  bool completed = false; // I/O done, waiting for FIFO retirement
+  bool absorbed = false;  // Superseded by a later write; never issued
+};
+
+// One read-ahead pread. Chunks are numbered in file order and committed into
+// read_buffer in that order, whichever finishes first. Prefetch chunks are
+// not part of that sequence and land in read_cache instead.
+struct ReadChunk {
+  uint64_t seq = 0;
+  uint64_t generation = 0;
+  bool prefetch = false;
+  uint64_t retired = 0; // write_batches_retired when a prefetch was planned
+  off_t offset = 0;
+  size_t length = 0;
+  ssize_t result = 0;
+  int error = 0;
+  ScratchBuffer data;
+};
+
+// A run of consecutive write_queue entries issued as one backend write.
+struct WriteBatch {
+  uint64_t first_seq = 0;
+  size_t count = 0;
+  off_t file_offset = 0;
+  size_t length = 0;
+  size_t ring_buffer_pos = 0;
+  off_t write_pos = 0; // Resolved storage offset (differs under O_APPEND)
 };
 
 struct ConveyorImpl {
@@ -34,13 +99,83 @@ struct ConveyorImpl {
   // --- ADAPTIVE CONFIG ---
   size_t max_write_capacity = 0;
   size_t max_read_capacity = 0;
+  size_t max_coalesce_size = 0; // 0 = one backend write per request
+  size_t write_queue_depth = 1;  // Backend writes allowed in flight
+  size_t read_chunk_size = 0;    // 0 = fetch all free space in one pread
+  size_t read_ahead_depth = 1;   // Read-ahead preads allowed in flight
+  bool write_absorb = false;     // Drop pending writes a newer one covers
 
   // Write Logic
   bool write_buffer_enabled = false;
   RingBuffer write_ring_buffer;         // <--- The Write Buffer
   std::deque<WriteRequest> write_queue; // Queue of metadata only
-
-  std::thread write_worker_thread;
+  // The first write_dispatched entries of write_queue have been handed to a
+  // worker. Entries are retired (and ring space freed) strictly from the
+  // front, once they and everything before them have completed.
+  size_t write_dispatched = 0;
+  uint64_t next_write_seq = 0;
+  std::vector<WriteBatch> write_inflight;
+
+  // Offset-ordered index over write_queue (file_offset -> seq) so the snoop
+  // in conveyor_read only visits requests that can overlap the read. No
+  // pending request is longer than write_index_max_len, which bounds how
+  // far left of the read a candidate can start. [pending_min_offset,
+  // pending_max_end) covers every pending byte and can be checked without
+  // the lock; it only widens until the queue drains.
+  std::multimap<off_t, uint64_t> write_index;
+  size_t write_index_max_len = 0;
+  std::atomic<off_t> pending_min_offset{0};
+  std::atomic<off_t> pending_max_end{0};
+  // Bumped each time a batch has reached storage; conveyor_pread uses it to
+  // notice that a write may have slipped past both its pread and its snoop.
+  std::atomic<uint64_t> write_batches_retired{0};
+
+  // --- JOURNAL ---
+  // Every request in write_queue has a record here, in the same order,
+  // appended when it is queued and retired when it is popped.
+  WriteJournal journal;
+  // Set once a request is popped with its record kept (after an error):
+  // the journal is then ahead of the queue for good, so the error cannot
+  // be cleared. Protected by write_mutex.
+  bool journal_kept = false;
+
+  // --- SINGLE PRODUCER MODE ---
+  // conveyor_write copies into the ring and publishes metadata through
+  // staged_writes without taking write_mutex; whoever next holds the lock
+  // moves staged entries into write_queue. The producer owns the fields in
+  // the first block, workers own write_bytes_retired, and the producer only
+  // takes the lock to wake a worker that has announced it is parked.
+  static constexpr size_t kStagedWriteSlots = 1024;
+  std::unique_ptr<SpscQueue<WriteRequest>> staged_writes; // null = disabled
+  alignas(64) size_t write_stage_pos = 0; // Ring index of the next byte
+  size_t write_bytes_staged = 0;          // Total bytes ever written
+  alignas(64) std::atomic<size_t> write_bytes_retired{0};
+  std::atomic<int> write_workers_parked{0};
+
+  // conveyor_write_reserve hands out [head, head + write_reserved_len) of
+  // the ring. Until it is committed no other write may touch the head.
+  std::atomic<bool> write_reservation_active{false};
+  size_t write_reserved_len = 0;
+
+  // conveyor_flush_async / conveyor_fsync_async barriers. A barrier is
+  // passed once every request with a lower seq has retired; it then moves
+  // from flush_barriers to barriers_ready, which one thread at a time
+  // (barrier_firing) empties, calling back with write_mutex dropped.
+  // Requests below absorb_floor are never absorbed, so a barrier can only
+  // pass once the bytes it covers have actually reached storage.
+  struct FlushBarrier {
+    uint64_t seq = 0;
+    bool durable = false;
+    conveyor_flush_fn callback = nullptr;
+    void *context = nullptr;
+    int64_t queued_ns = 0; // For the flush wait metric
+  };
+  std::deque<FlushBarrier> flush_barriers;
+  std::deque<FlushBarrier> barriers_ready;
+  bool barrier_firing = false;
+  uint64_t absorb_floor = 0;
+
+  std::vector<std::thread> write_worker_threads;
   std::mutex write_mutex;
   std::condition_variable write_cv_producer;
   std::condition_variable write_cv_consumer;
@@ -50,7 +185,14 @@ struct ConveyorImpl {
   // Read Logic
   bool read_buffer_enabled = false;
   RingBuffer read_buffer;
-  std::thread read_worker_thread;
+  // Read-ahead bookkeeping. read_head_in_storage is the next offset to
+  // fetch; read_reserved counts ring space promised to in-flight chunks.
+  size_t read_reserved = 0;
+  size_t read_inflight = 0;
+  uint64_t next_read_chunk_seq = 0;
+  uint64_t next_read_commit_seq = 0;
+  std::map<uint64_t, ReadChunk> read_completed; // Finished out of order
+  std::vector<std::thread> read_worker_threads;
   std::mutex read_mutex;
   std::condition_variable read_cv_producer;
   std::condition_variable read_cv_consumer;
@@ -60,6 +202,62 @@ struct ConveyorImpl {
 
   std::atomic<uint64_t> read_buffer_generation{0};
 
+  // Mapped storage (ops.map): there is no read buffer and no read worker,
+  // reads copy from the mapping, and read-ahead is an advise() over the
+  // read_advise_window bytes past the reader, repeated once it is halfway
+  // through [advised_start, advised_end). Guarded by read_mutex, as is
+  // mapped_view_copy, which backs a read view over pending writes.
+  bool read_mapped = false;
+  size_t read_advise_window = 0;
+  off_t advised_start = 0;
+  off_t advised_end = 0;
+  std::vector<char> mapped_view_copy;
+
+  // Random-access read cache (read_cache_block_size > 0). Everything taken
+  // out of read_buffer is kept here, conveyor_read at any offset is served
+  // from it first, and lseek only repositions. Blocks are dropped (and
+  // buffered read-ahead refetched) as overlapping writes reach storage.
+  // The cache and read_buffer are guarded by read_mutex, which
+  // retireWriteBatch takes under write_mutex; nothing takes write_mutex
+  // while holding read_mutex.
+  BlockCache read_cache;
+
+  // Strided and reverse streams are prefetched into read_cache: predicted
+  // ranges wait in read_prefetch and take the next free read-ahead slot
+  // ahead of ring read-ahead. Guarded by read_mutex.
+  static constexpr size_t kMaxPrefetchDepth = 64;
+  AccessPattern read_pattern;
+  std::deque<std::pair<off_t, size_t>> read_prefetch;
+
+  // --- SHARED EXECUTOR ---
+  // When set, no threads of our own are started: read and write work runs
+  // as jobs on the executor, at most one job per direction at a time. A
+  // *_job_scheduled flag is true from posting until the job has finished
+  // and found nothing more to do.
+  Executor *executor = nullptr;
+  std::atomic<bool> write_job_scheduled{false};
+  std::atomic<bool> read_job_scheduled{false};
+
+  // Zero-copy read view (conveyor_read_acquire). While one is out, the
+  // bytes it points at must not move: reads, seeks and resizes are refused.
+  // Guarded by read_mutex.
+  bool read_view_active = false;
+  size_t read_view_len = 0;
+
+  // --- MEMORY BUDGET ---
+  // Ring capacity is accounted in the process-wide MemoryBudget, which
+  // tracks memory_charged for us under its own lock. Capacity above the
+  // initial sizes can be given back: after idle_shrink without reads or
+  // writes, or when a warmer conveyor needs it. last_active_ns orders
+  // reclaim, coldest first.
+  size_t initial_write_capacity = 0;
+  size_t initial_read_capacity = 0;
+  int memory_priority = 0;
+  std::chrono::milliseconds idle_shrink{0};
+  std::atomic<int64_t> last_active_ns{0};
+  size_t memory_charged = 0;
+  bool memory_tracked = false; // Between join and leave
+
   std::atomic<off_t> logical_write_offset{0};
   std::atomic<off_t> read_head_in_storage{0};
   std::atomic<off_t> current_file_offset{0};
@@ -68,330 +266,3085 @@ struct ConveyorImpl {
   off_t last_read_end_offset = 0;
   size_t sequential_read_counter = 0;
 
+  // Cumulative since creation, never reset (conveyor_get_metrics).
+  // conveyor_get_stats reports how far they moved since its last call.
   struct Stats {
     std::atomic<size_t> bytes_written{0};
     std::atomic<size_t> bytes_read{0};
-    std::atomic<size_t> total_write_latency_ms{0};
+    std::atomic<uint64_t> total_write_latency_ns{0};
     std::atomic<size_t> write_ops_count{0};
-    std::atomic<size_t> total_read_latency_ms{0};
+    std::atomic<uint64_t> total_read_latency_ns{0};
     std::atomic<size_t> read_ops_count{0};
     std::atomic<size_t> write_buffer_full_events{0};
+    std::atomic<size_t> read_hits{0};
+    std::atomic<size_t> read_misses{0};
+    std::atomic<size_t> bytes_absorbed{0};
+    std::atomic<size_t> throttled_ops{0};
+    std::atomic<uint64_t> throttle_wait_ns{0};
+    std::atomic<uint64_t> read_hit_bytes{0};
+    std::atomic<uint64_t> read_miss_bytes{0};
+    std::atomic<uint64_t> snoop_patched_bytes{0};
+    std::atomic<uint64_t> read_invalidations{0};
+    std::atomic<uint64_t> write_resizes{0};
+    std::atomic<uint64_t> read_resizes{0};
+    std::atomic<uint64_t> flushes{0};
+    std::atomic<uint64_t> flush_wait_ns{0};
     std::atomic<int> last_error_code{0};
   } stats;
 
-  ConveyorImpl(size_t w_cap, size_t r_cap)
-      : write_ring_buffer(w_cap), read_buffer(r_cap), max_write_capacity(w_cap),
-        max_read_capacity(r_cap) {} // Default max = initial
-
-  void writeWorker() {
-    // Optimization: Reusable scratch buffer to handle ring-wrap-around
-    // avoids re-allocating memory inside the loop.
-    std::vector<char> scratch_buffer;
-    scratch_buffer.reserve(4096);
+  // Where the previous conveyor_get_stats window ended, per counter.
+  struct StatsWindow {
+    uint64_t bytes_written = 0;
+    uint64_t bytes_read = 0;
+    uint64_t total_write_latency_ns = 0;
+    uint64_t write_ops_count = 0;
+    uint64_t total_read_latency_ns = 0;
+    uint64_t read_ops_count = 0;
+    uint64_t write_buffer_full_events = 0;
+    uint64_t read_hits = 0;
+    uint64_t read_misses = 0;
+    uint64_t bytes_absorbed = 0;
+    uint64_t throttled_ops = 0;
+    uint64_t throttle_wait_ns = 0;
+  } stats_window;
+  std::mutex stats_window_mutex;
+
+  void recordFlushWait(int64_t since_ns) {
+    stats.flushes.fetch_add(1, std::memory_order_relaxed);
+    stats.flush_wait_ns.fetch_add(static_cast<uint64_t>(nowNs() - since_ns),
+                                  std::memory_order_relaxed);
+  }
 
-    while (true) {
-      std::unique_lock<std::mutex> lock(write_mutex);
-      write_cv_consumer.wait(lock, [&] {
-        return !write_queue.empty() || write_buffer_needs_flush ||
-               write_worker_stop_flag;
-      });
-      if (write_worker_stop_flag && write_queue.empty())
-        break;
+  // Latency distributions for the same window: each backend operation, and
+  // each conveyor_write/conveyor_read (or positional variant) as the caller
+  // saw it, measured from entry to return.
+  struct Latency {
+    LatencyHistogram backend_write;
+    LatencyHistogram backend_read;
+    LatencyHistogram write_call;
+    LatencyHistogram read_call;
+  } latency;
+
+  // --- BACKPRESSURE ---
+  // How a write that does not fit is handled, and who hears when it would.
+  // A refused or short write arms writable_armed; the next time ring space
+  // is freed (or an error makes waiting pointless) it is disarmed and the
+  // callback and eventfd fire once.
+  int write_backpressure = CONVEYOR_BACKPRESSURE_BLOCK;
+  std::chrono::milliseconds write_timeout{30000};
+  conveyor_writable_fn writable_callback = nullptr;
+  void *writable_context = nullptr;
+  std::atomic<bool> writable_armed{false};
+  std::atomic<int> writable_fd{-1}; // Created on first conveyor_writable_fd
+
+  // --- RATE LIMITS AND QOS ---
+  // This conveyor's own limit; the process limit is RateLimiter::shared().
+  // Throttled operations wait with no conveyor lock held, rechecking at
+  // least every kThrottleRecheck so a lifted limit takes effect promptly.
+  static constexpr std::chrono::milliseconds kThrottleRecheck{50};
+  RateLimiter rate_limiter;
+  bool background_qos = false; // CONVEYOR_QOS_BACKGROUND
+
+  // Whether backend I/O that the application may be waiting on (when
+  // 'waited_on') runs as foreground.
+  bool foreground(bool waited_on) const { return waited_on && !background_qos; }
+
+  // Time until both limits would admit an operation; zero when unthrottled.
+  RateLimiter::Clock::duration throttleDelay(bool foreground) {
+    RateLimiter &global = RateLimiter::shared();
+    if (!rate_limiter.enabled() && !global.enabled())
+      return RateLimiter::Clock::duration::zero();
+    return std::max(rate_limiter.delay(foreground), global.delay(foreground));
+  }
 
-      if (write_queue.empty()) {
-        write_buffer_needs_flush = false;
-        write_cv_producer.notify_all();
-        continue;
-      }
+  // Charges one admitted operation of 'count' bytes to both limits.
+  void chargeThrottle(size_t count) {
+    rate_limiter.consume(count);
+    RateLimiter::shared().consume(count);
+  }
 
-      // Grab the next request metadata
-      WriteRequest req = write_queue.front();
-      write_queue.pop_front();
+  void recordThrottleWait(RateLimiter::Clock::duration waited) {
+    stats.throttle_wait_ns.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count(),
+        std::memory_order_relaxed);
+  }
 
-      // --- CRITICAL SECTION: Copy data out of RingBuffer ---
-      if (scratch_buffer.capacity() < req.length) {
-        scratch_buffer.reserve(req.length);
+  // Waits until the limits admit an operation of 'count' bytes, then
+  // charges it. Gives up waiting (but still charges) once 'cancel' is set.
+  // Thread-Safety: Must be called with no conveyor lock held.
+  void throttle(size_t count, bool foreground,
+                const std::atomic<bool> *cancel = nullptr) {
+    RateLimiter &global = RateLimiter::shared();
+    if (!rate_limiter.enabled() && !global.enabled())
+      return;
+    auto wait = throttleDelay(foreground);
+    if (wait > RateLimiter::Clock::duration::zero()) {
+      if (foreground) {
+        rate_limiter.begin_foreground_wait();
+        global.begin_foreground_wait();
+      }
+      auto start = RateLimiter::Clock::now();
+      while (wait > RateLimiter::Clock::duration::zero() &&
+             !(cancel && cancel->load())) {
+        std::this_thread::sleep_for(
+            std::min<RateLimiter::Clock::duration>(wait, kThrottleRecheck));
+        wait = throttleDelay(foreground);
       }
-      scratch_buffer.resize(req.length);
+      if (foreground) {
+        rate_limiter.end_foreground_wait();
+        global.end_foreground_wait();
+      }
+      stats.throttled_ops++;
+      recordThrottleWait(RateLimiter::Clock::now() - start);
+    }
+    chargeThrottle(count);
+  }
 
-      // Peek at the data from the ring buffer into our scratch space.
-      // We don't advance the tail yet.
-      write_ring_buffer.peek_at(req.ring_buffer_pos, scratch_buffer.data(),
-                                req.length);
+  // --- TRACING ---
+  // Set once at creation; trace points test 'tracing' and nothing else.
+  bool tracing = false;
+  conveyor_trace_fn trace_callback = nullptr;
+  void *trace_context = nullptr;
+  std::unique_ptr<TraceLog> trace_log;
+
+  // --- COMPRESSION ---
+  // With a codec, 'handle' and 'ops' point at this adaptor, which packs
+  // each block on its way to the caller's backend.
+  std::unique_ptr<BlockCodecStorage> codec_storage;
+  // Aligns backend I/O for O_DIRECT handles (direct_io_block_size > 0);
+  // wraps the backend underneath codec_storage.
+  std::unique_ptr<DirectIoStorage> direct_storage;
+  size_t direct_io_block = 0;
+  // CPUs the worker threads are pinned to, and the node the rings live on.
+  Placement placement;
+
+  // Each ring reserves storage for its maximum size up front, so growing
+  // never has to move it. Only the pages actually used are backed.
+  ConveyorImpl(size_t w_cap, size_t r_cap, size_t w_max, size_t r_max,
+               bool huge_pages, const Placement &where)
+      : write_ring_buffer(w_cap, w_max, huge_pages, where.node),
+        read_buffer(r_cap, r_max, huge_pages, where.node),
+        max_write_capacity(w_max), max_read_capacity(r_max),
+        placement(where) {}
+
+  ~ConveyorImpl() {
+#ifdef __linux__
+    if (writable_fd.load() >= 0)
+      ::close(writable_fd.load());
+#endif
+  }
 
-      // --- IO SECTION STARTS ---
-      lock.unlock();
+  // Fires the writable notification if a refused write armed it. Called
+  // from workers and from application calls alike (see
+  // conveyor_writable_fn), usually under write_mutex.
+  void notifyWritable() {
+    if (!writable_armed.load(std::memory_order_relaxed) ||
+        !writable_armed.exchange(false))
+      return;
+    if (writable_callback)
+      writable_callback(writable_context);
+#ifdef __linux__
+    int fd = writable_fd.load();
+    if (fd >= 0) {
+      uint64_t one = 1;
+      ssize_t r = ::write(fd, &one, sizeof(one));
+      (void)r; // Only fails once the counter saturates; it is readable then
+    }
+#endif
+  }
 
-      off_t write_pos;
-      if (flags & O_APPEND) {
-        write_pos = logical_write_offset.load();
-      } else {
-        write_pos = req.file_offset;
-      }
-
-      auto start = std::chrono::steady_clock::now();
-      size_t total_written = 0;
-      bool write_error = false;
-      while (total_written < req.length) {
-        ssize_t written_now =
-            ops.pwrite(handle, scratch_buffer.data() + total_written,
-                       req.length - total_written, write_pos + total_written);
-        if (written_now < 0) {
-          if (stats.last_error_code.load() == 0) {
-            stats.last_error_code = errno;
+  // Refuses a write under a non-blocking policy (or when a blocking one
+  // times out) and arms the writable notification. Always returns false.
+  // Thread-Safety: Must be called under write_mutex.
+  bool refuseWrite(int err) {
+    writable_armed = true;
+    if (stats.last_error_code.load() != 0)
+      notifyWritable(); // Nothing will free space; let the caller see why
+    errno = err;
+    return false;
+  }
+
+  // --- ADAPTIVE WRITE: Grow on Pressure ---
+  // Makes room for 'count' bytes at the head of the write ring: waits out
+  // another caller's reservation, grows the ring while it is below
+  // max_write_capacity, then applies backpressure as write_backpressure
+  // says. Blocking gives up with ETIMEDOUT after write_timeout; the other
+  // policies never wait and fail with EAGAIN instead, except that
+  // CONVEYOR_BACKPRESSURE_PARTIAL first lowers 'count' to whatever fits.
+  // Returns false on failure.
+  // Thread-Safety: 'lock' must hold write_mutex.
+  bool acquireWriteSpace(std::unique_lock<std::mutex> &lock, size_t &count) {
+    bool blocking = write_backpressure == CONVEYOR_BACKPRESSURE_BLOCK;
+    auto deadline = std::chrono::steady_clock::now() + write_timeout;
+    auto unreserved = [&] {
+      return !write_reservation_active.load() || write_worker_stop_flag;
+    };
+    if (blocking ? !write_cv_producer.wait_until(lock, deadline, unreserved)
+                 : !unreserved())
+      return refuseWrite(blocking ? ETIMEDOUT : EAGAIN);
+    // A staged write may have slipped in while we waited.
+    drainStagedWrites();
+
+    if (write_ring_buffer.available_space() < count) {
+      if (write_ring_buffer.capacity < max_write_capacity) {
+        size_t needed = write_ring_buffer.size + count;
+        size_t new_cap = write_ring_buffer.capacity * 2;
+        if (new_cap < needed)
+          new_cap = needed;
+        if (new_cap > max_write_capacity)
+          new_cap = max_write_capacity;
+
+        // Over budget, grow only as far as a write larger than the ring
+        // needs; otherwise stay put and let backpressure do its job.
+        if (new_cap < needed) {
+          new_cap = 0;
+        } else if (!chargeMemory(new_cap - write_ring_buffer.capacity, false)) {
+          new_cap = 0;
+          if (count > write_ring_buffer.capacity) {
+            new_cap = needed;
+            chargeMemory(new_cap - write_ring_buffer.capacity, true);
           }
-          write_error = true;
-          break;
         }
-        if (written_now == 0) {
-          if (stats.last_error_code.load() == 0) {
-            stats.last_error_code = EIO;
-          }
-          write_error = true;
-          break;
+
+        // Growing in place keeps every queued ring position valid, so it
+        // only waits for the bytes wrapped round the end of the ring to
+        // retire. Moving to new storage renumbers the ring, so that waits
+        // for the whole queue to drain (FLUSH LOGIC).
+        bool in_place = new_cap <= write_ring_buffer.reserved();
+        size_t charged = (new_cap > 0) ? new_cap - write_ring_buffer.capacity : 0;
+        auto ready = [&] {
+          return (in_place ? write_ring_buffer.contiguous()
+                           : write_queue.empty()) ||
+                 write_worker_stop_flag;
+        };
+        if (new_cap > 0 && !ready() && blocking) {
+          int64_t waited = LIBCONVEYOR_TRACE_BEGIN(
+              this, CONVEYOR_TRACE_GROW_WAIT_BEGIN, 0, new_cap);
+          write_buffer_needs_flush = true;
+          wakeWriteWorkers();
+          write_cv_producer.wait_until(lock, deadline, ready);
+          LIBCONVEYOR_TRACE_END(this, CONVEYOR_TRACE_GROW_WAIT_END, 0, new_cap,
+                                waited);
+        } else if (new_cap > 0 && !ready()) {
+          wakeWriteWorkers(); // Drain toward the growth; the caller retries
+        }
+        write_buffer_needs_flush = false;
+
+        // Others may have grown or reclaimed the ring while we waited, so
+        // settle the charge against what actually changed. Without a wait
+        // (or after timing out) the ring may not be ready to grow yet; the
+        // next write tries again.
+        size_t grown = 0;
+        if (new_cap > 0 && ready() && new_cap > write_ring_buffer.capacity &&
+            new_cap >= write_ring_buffer.size + count &&
+            !write_worker_stop_flag) {
+          grown = new_cap - write_ring_buffer.capacity;
+          write_ring_buffer.resize(new_cap);
+          stats.write_resizes++;
+          LIBCONVEYOR_TRACE(this, CONVEYOR_TRACE_WRITE_RESIZE, 0, new_cap);
+          if (staged_writes)
+            write_stage_pos = write_ring_buffer.head;
         }
-        total_written += written_now;
+        if (grown > charged)
+          chargeMemory(grown - charged, true);
+        else if (charged > grown)
+          releaseMemory(charged - grown);
       }
-      auto end = std::chrono::steady_clock::now();
+    }
 
-      // --- IO SECTION ENDS ---
-      lock.lock();
+    if (writableSpace() < count) {
+      stats.write_buffer_full_events++;
+      if (!blocking) {
+        size_t fits = writableSpace();
+        if (write_backpressure != CONVEYOR_BACKPRESSURE_PARTIAL || fits == 0)
+          return refuseWrite(EAGAIN);
+        count = fits;
+        writable_armed = true; // Short, so the caller will want to know
+        return !write_worker_stop_flag;
+      }
+      int64_t waited = LIBCONVEYOR_TRACE_BEGIN(
+          this, CONVEYOR_TRACE_BACKPRESSURE_BEGIN, 0, count);
+      bool ok = write_cv_producer.wait_until(lock, deadline, [&] {
+        return (writableSpace() >= count) || write_worker_stop_flag;
+      });
+      LIBCONVEYOR_TRACE_END(this, CONVEYOR_TRACE_BACKPRESSURE_END, 0, count,
+                            waited);
+      if (!ok)
+        return refuseWrite(ETIMEDOUT);
+    }
+
+    return !write_worker_stop_flag;
+  }
+
+  // Bytes a write can take right now: free ring space and, in journal mode,
+  // no more than the journal can record.
+  // Thread-Safety: Must be called under write_mutex.
+  size_t writableSpace() const {
+    size_t space = write_ring_buffer.available_space();
+    return journal.is_open() ? std::min(space, journal.room()) : space;
+  }
+
+  // Queues 'count' bytes already placed at the head of the write ring as a
+  // write to 'offset'.
+  // Thread-Safety: Must be called under write_mutex.
+  void queueHeadWrite(off_t offset, size_t count) {
+    commitHeadWrite(offset, count);
+    wakeWriteWorkers();
+  }
+
+  // queueHeadWrite without waking anyone, for callers queueing several.
+  // Thread-Safety: Must be called under write_mutex.
+  void commitHeadWrite(off_t offset, size_t count) {
+    WriteRequest req;
+    req.file_offset = offset;
+    req.length = count;
+    req.ring_buffer_pos = write_ring_buffer.head;
+    if (journal.is_open()) {
+      RingSegment segs[2];
+      size_t nsegs = write_ring_buffer.segments_at(req.ring_buffer_pos, count, segs);
+      // A record that could not be synced is still queued; the sticky
+      // error fails the calls after this one.
+      if (!journal.append(offset, segs[0].data, segs[0].len,
+                          nsegs > 1 ? segs[1].data : nullptr, nsegs > 1 ? segs[1].len : 0))
+        recordError(errno);
+    }
+    write_ring_buffer.commit(count);
+
+    enqueueWrite(req);
+    if (staged_writes) {
+      // Keep the producer's lock-free cursor in step with the locked path.
+      write_stage_pos = write_ring_buffer.head;
+      write_bytes_staged += count;
+    }
+
+    stats.bytes_written += count;
+  }
+
+  void scheduleWriteJob();
+  void scheduleReadJob();
+  // Reposts the running job (whose *_job_scheduled flag stays set) to run
+  // again after 'delay'.
+  void deferJob(bool write, bool foreground, RateLimiter::Clock::duration delay);
+
+  static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // Returns the time stamped, for callers that also time the call.
+  int64_t markActive() {
+    int64_t now = nowNs();
+    last_active_ns.store(now, std::memory_order_relaxed);
+    return now;
+  }
+
+  static void recordSince(LatencyHistogram &h, int64_t start_ns) {
+    h.record(static_cast<uint64_t>(nowNs() - start_ns));
+  }
+
+  // Emits one trace record; for an *_END event 'begin_ns' is what the
+  // matching LIBCONVEYOR_TRACE_BEGIN returned. Returns the timestamp.
+  int64_t trace(conveyor_trace_event_t event, off_t offset, size_t bytes,
+                int64_t begin_ns) {
+    static std::atomic<unsigned long long> next_thread_id{1};
+    thread_local unsigned long long thread_id = next_thread_id.fetch_add(1);
+    conveyor_trace_record_t r;
+    int64_t now = nowNs();
+    r.event = event;
+    r.timestamp_ns = static_cast<unsigned long long>(now);
+    r.duration_ns =
+        begin_ns ? static_cast<unsigned long long>(now - begin_ns) : 0;
+    r.offset = offset;
+    r.bytes = bytes;
+    r.thread_id = thread_id;
+    if (trace_callback)
+      trace_callback(trace_context, &r);
+    if (trace_log)
+      trace_log->record(r);
+    return now;
+  }
+
+  void recordBackendWrite(std::chrono::steady_clock::duration d) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    stats.total_write_latency_ns += ns;
+    stats.write_ops_count++;
+    latency.backend_write.record(static_cast<uint64_t>(ns));
+  }
+
+  void recordBackendRead(std::chrono::steady_clock::duration d) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    stats.total_read_latency_ns += ns;
+    stats.read_ops_count++;
+    latency.backend_read.record(static_cast<uint64_t>(ns));
+  }
+
+  bool idleFor(std::chrono::milliseconds d) const {
+    return nowNs() - last_active_ns.load(std::memory_order_relaxed) >=
+           std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+  }
+
+  // Shrinks the write ring back to its initial size when nothing is queued
+  // or reserved. Returns the bytes given up. The single-producer fast path
+  // reads the ring's capacity without the lock, so in that mode the write
+  // ring keeps its size.
+  // Thread-Safety: Must be called under write_mutex.
+  size_t shrinkWriteRing() {
+    size_t cap = write_ring_buffer.capacity;
+    if (!write_buffer_enabled || staged_writes ||
+        cap <= initial_write_capacity || !write_queue.empty() ||
+        write_reservation_active.load() ||
+        !write_ring_buffer.shrink(initial_write_capacity))
+      return 0;
+    stats.write_resizes++;
+    LIBCONVEYOR_TRACE(this, CONVEYOR_TRACE_WRITE_RESIZE, 0,
+                      initial_write_capacity);
+    return cap - initial_write_capacity;
+  }
+
+  // Drops buffered read-ahead and shrinks the read ring back to its
+  // initial size; read-ahead restarts at the same offset. Returns the bytes
+  // given up.
+  // Thread-Safety: Must be called under read_mutex.
+  size_t shrinkReadRing() {
+    size_t cap = read_buffer.capacity;
+    if (!read_buffer_enabled || cap <= initial_read_capacity ||
+        read_view_active)
+      return 0;
+    off_t pos = readBufferOffset();
+    read_buffer.clear();
+    read_eof_flag = false;
+    restartReadAhead(pos);
+    read_buffer.shrink(initial_read_capacity);
+    stats.read_resizes++;
+    LIBCONVEYOR_TRACE(this, CONVEYOR_TRACE_READ_RESIZE, 0,
+                      initial_read_capacity);
+    wakeReadWorkers();
+    return cap - initial_read_capacity;
+  }
+
+  // Gives capacity above the initial sizes back for another conveyor's
+  // growth. MemoryBudget calls this with its lock held, so it only
+  // try-locks: a conveyor whose locks are taken is busy, not cold.
+  // Returns the bytes given up; the caller accounts for them.
+  size_t reclaimMemory() {
+    size_t freed = 0;
+    std::unique_lock<std::mutex> write_lock(write_mutex, std::try_to_lock);
+    if (write_lock.owns_lock())
+      freed += shrinkWriteRing();
+    std::unique_lock<std::mutex> read_lock(read_mutex, std::try_to_lock);
+    if (read_lock.owns_lock())
+      freed += shrinkReadRing();
+    return freed;
+  }
+
+  bool chargeMemory(size_t bytes, bool force);
+  void releaseMemory(size_t bytes);
+
+  // cv.wait(lock), except that once buffers have grown past their initial
+  // size and idle_shrink is set, it wakes after idle_shrink and, if the
+  // conveyor has seen no reads or writes for that long, shrinks the
+  // write (or read) ring. Callers re-check their condition in a loop.
+  void waitOrShrink(std::unique_lock<std::mutex> &lock,
+                    std::condition_variable &cv, bool write) {
+    size_t cap = write ? write_ring_buffer.capacity : read_buffer.capacity;
+    size_t initial = write ? initial_write_capacity : initial_read_capacity;
+    if (idle_shrink.count() == 0 || cap <= initial ||
+        (write && staged_writes)) {
+      cv.wait(lock);
+      return;
+    }
+    if (cv.wait_for(lock, idle_shrink) == std::cv_status::timeout &&
+        idleFor(idle_shrink)) {
+      size_t freed = write ? shrinkWriteRing() : shrinkReadRing();
+      if (freed > 0)
+        releaseMemory(freed);
+    }
+  }
+
+  // Hands new write work to whoever services this conveyor.
+  void wakeWriteWorkers() {
+    if (executor)
+      scheduleWriteJob();
+    else
+      write_cv_consumer.notify_one();
+  }
+
+  // Tells read-ahead that ring space or a new position is available.
+  void wakeReadWorkers() {
+    if (executor)
+      scheduleReadJob();
+    else
+      read_cv_producer.notify_all();
+  }
 
-      // Now that IO is complete, we can advance the tail of the ring buffer
-      // by "reading" into a null buffer.
-      write_ring_buffer.read(nullptr, req.length);
+  // Single-producer fast path: places the write in the ring and hands its
+  // metadata to the workers without locking. Returns false when the ring or
+  // the staging queue is full (or the conveyor is stopping); the caller then
+  // falls back to the locked path, which waits, grows or reports errors.
+  bool tryStageWrite(const conveyor_iovec_t *iov, int iovcnt, size_t count,
+                     off_t offset) {
+    if (write_worker_stop_flag.load(std::memory_order_relaxed) ||
+        write_reservation_active.load(std::memory_order_relaxed))
+      return false;
+    size_t in_use = write_bytes_staged -
+                    write_bytes_retired.load(std::memory_order_acquire);
+    if (write_ring_buffer.capacity - in_use < count)
+      return false;
+
+    WriteRequest req;
+    req.file_offset = offset;
+    req.length = count;
+    req.ring_buffer_pos = write_stage_pos;
+    gatherIntoRing(write_stage_pos, iov, iovcnt, count);
+    if (!staged_writes->try_push(req))
+      return false; // The copied bytes are simply never committed.
+    write_stage_pos = (write_stage_pos + count) % write_ring_buffer.capacity;
+    write_bytes_staged += count;
+
+    // Pairs with the fences in waitForWriteWork and runWriteJob: either we
+    // see the parked worker (or idle job), or it sees our entry.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (executor) {
+      scheduleWriteJob();
+    } else if (write_workers_parked.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(write_mutex);
+      write_cv_consumer.notify_one();
+    }
+    return true;
+  }
+
+  // Copies the first 'count' bytes of a gather list into the write ring at
+  // 'pos' without committing them.
+  void gatherIntoRing(size_t pos, const conveyor_iovec_t *iov, int iovcnt,
+                      size_t count) {
+    for (int i = 0; i < iovcnt && count > 0; ++i) {
+      size_t len = std::min(iov[i].iov_len, count);
+      write_ring_buffer.write_at(pos, static_cast<const char *>(iov[i].iov_base),
+                                 len);
+      pos += len;
+      count -= len;
+    }
+  }
+
+  bool hasStagedWrites() const {
+    return staged_writes && !staged_writes->empty();
+  }
+
+  // Moves everything the producer has staged into write_queue.
+  // Thread-Safety: Must be called under write_mutex.
+  void drainStagedWrites() {
+    if (!staged_writes)
+      return;
+    WriteRequest req;
+    while (staged_writes->try_pop(req)) {
+      write_ring_buffer.commit(req.length);
+      enqueueWrite(req);
+    }
+  }
+
+  // Appends a request to write_queue and the offset index.
+  // Thread-Safety: Must be called under write_mutex.
+  void enqueueWrite(WriteRequest req) {
+    if (write_absorb)
+      absorbCoveredWrites(req.file_offset, req.length);
+    req.seq = next_write_seq++;
+    LIBCONVEYOR_TRACE(this, CONVEYOR_TRACE_ENQUEUE, req.file_offset,
+                      req.length);
+    off_t end = req.file_offset + (off_t)req.length;
+    if (write_index.empty()) {
+      pending_min_offset = req.file_offset;
+      pending_max_end = end;
+    } else {
+      if (req.file_offset < pending_min_offset.load())
+        pending_min_offset = req.file_offset;
+      if (end > pending_max_end.load())
+        pending_max_end = end;
+    }
+    write_index.emplace(req.file_offset, req.seq);
+    write_index_max_len = std::max(write_index_max_len, req.length);
+    write_queue.push_back(req);
+  }
+
+  // --- ABSORB: A new write to [start, start + count) makes every pending
+  // request lying entirely inside that range redundant. Those not yet
+  // handed to a worker are dropped from the offset index and marked done,
+  // so they never reach storage and the snoop only sees the newer bytes;
+  // their ring space is retired in FIFO order like any other. Dispatched
+  // requests may already be on the wire and are left alone.
+  // Thread-Safety: Must be called under write_mutex.
+  void absorbCoveredWrites(off_t start, size_t count) {
+    if (count == 0 || write_dispatched >= write_queue.size())
+      return;
+    uint64_t front_seq = write_queue.front().seq;
+    uint64_t first_undispatched = write_queue[write_dispatched].seq;
+    off_t end = start + (off_t)count;
+    for (auto it = write_index.lower_bound(start);
+         it != write_index.end() && it->first < end;) {
+      WriteRequest &req = write_queue[static_cast<size_t>(it->second - front_seq)];
+      if (it->second >= first_undispatched && it->second >= absorb_floor &&
+          req.file_offset + (off_t)req.length <= end) {
+        req.absorbed = true;
+        req.completed = true;
+        stats.bytes_absorbed += req.length;
+        it = write_index.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    skipAbsorbedWrites();
+  }
 
-      // Notify producers that space is now officially free.
+  // Steps write_dispatched over absorbed requests, so the entry a worker
+  // plans from next is always a live one, and frees whatever that leaves
+  // done at the front of the queue.
+  // Thread-Safety: Must be called under write_mutex.
+  void skipAbsorbedWrites() {
+    while (write_dispatched < write_queue.size() &&
+           write_queue[write_dispatched].absorbed)
+      write_dispatched++;
+    if (retireCompletedWrites())
       write_cv_producer.notify_all();
+  }
+
+  // Pops every completed request off the front of the queue, freeing its
+  // ring space. Returns whether anything was popped.
+  // Thread-Safety: Must be called under write_mutex.
+  bool retireCompletedWrites() {
+    bool popped = false;
+    while (!write_queue.empty() && write_queue.front().completed) {
+      // Advance the tail of the ring buffer by "reading" into a null buffer.
+      write_ring_buffer.read(nullptr, write_queue.front().length);
+      if (staged_writes)
+        write_bytes_retired.fetch_add(write_queue.front().length,
+                                      std::memory_order_release);
+      popFrontWrite();
+      // After an error a retired request may never have been written; its
+      // record stays for conveyor_recover.
+      if (journal.is_open()) {
+        if (stats.last_error_code.load() == 0)
+          journal.retire();
+        else
+          journal_kept = true;
+      }
+      write_dispatched--;
+      popped = true;
+    }
+    if (popped) {
+      notifyWritable();
+      collectPassedBarriers();
+    }
+    return popped;
+  }
+
+  // Moves every barrier the retired writes have passed to barriers_ready.
+  // Thread-Safety: Must be called under write_mutex.
+  void collectPassedBarriers() {
+    uint64_t retired =
+        write_queue.empty() ? next_write_seq : write_queue.front().seq;
+    while (!flush_barriers.empty() && flush_barriers.front().seq <= retired) {
+      barriers_ready.push_back(flush_barriers.front());
+      flush_barriers.pop_front();
+    }
+  }
 
-      if (!write_error) {
-        stats.total_write_latency_ms +=
-            std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
-                .count();
-        stats.write_ops_count++;
+  // Queues a barrier behind every write enqueued so far and, if those have
+  // all retired already, fires it (and anything before it) right here.
+  // Thread-Safety: 'lock' must hold write_mutex; it may be dropped.
+  void queueBarrier(std::unique_lock<std::mutex> &lock,
+                    const FlushBarrier &barrier) {
+    drainStagedWrites();
+    flush_barriers.push_back(barrier);
+    flush_barriers.back().seq = next_write_seq;
+    absorb_floor = next_write_seq;
+    collectPassedBarriers();
+    if (!flush_barriers.empty())
+      wakeWriteWorkers();
+    fireBarriers(lock);
+  }
 
-        if (flags & O_APPEND) {
-          logical_write_offset += total_written;
+  // Calls back every ready barrier, in order. Durable barriers that are
+  // ready together share a single ops.fsync (group commit); the barriers
+  // before the first durable one do not wait for it. Returns whether this
+  // thread did the firing, in which case the lock was dropped meanwhile.
+  // Thread-Safety: 'lock' must hold write_mutex.
+  bool fireBarriers(std::unique_lock<std::mutex> &lock) {
+    if (barriers_ready.empty() || barrier_firing)
+      return false;
+    barrier_firing = true;
+    while (!barriers_ready.empty()) {
+      std::deque<FlushBarrier> round;
+      round.swap(barriers_ready);
+      lock.unlock();
+      int err = stats.last_error_code.load();
+      bool synced = false;
+      for (const FlushBarrier &b : round) {
+        if (b.durable && !synced) {
+          synced = true;
+          if (err == 0 && ops.fsync)
+            err = syncStorage(round.size());
         }
+        recordFlushWait(b.queued_ns);
+        b.callback(b.context, err);
       }
+      lock.lock();
     }
+    barrier_firing = false;
+    write_cv_producer.notify_all(); // conveyor_destroy waits for the firing
+    return true;
   }
 
-  void readWorker() {
-    std::vector<char> temp_buffer;
-    while (true) {
-      std::unique_lock<std::mutex> lock(read_mutex);
-      read_cv_producer.wait(lock, [&] {
-        return read_buffer.available_space() > 0 ||
-               read_worker_stop_flag.load() || read_worker_needs_fill.load();
-      });
-      if (read_worker_stop_flag.load())
+  // One ops.fsync covering 'barriers' of them. Returns 0 or the errno,
+  // which is also recorded as sticky: data might not be durable.
+  int syncStorage(size_t barriers) {
+    int64_t traced = LIBCONVEYOR_TRACE_BEGIN(this, CONVEYOR_TRACE_FSYNC_BEGIN,
+                                             0, barriers);
+    int err = 0;
+    errno = 0;
+    if (ops.fsync(handle) != 0) {
+      err = errno ? errno : EIO;
+      recordError(err);
+    }
+    LIBCONVEYOR_TRACE_END(this, CONVEYOR_TRACE_FSYNC_END, 0, barriers, traced);
+    return err;
+  }
+
+  // Removes the front request from write_queue and the offset index.
+  // Thread-Safety: Must be called under write_mutex.
+  void popFrontWrite() {
+    const WriteRequest &front = write_queue.front();
+    auto range = write_index.equal_range(front.file_offset);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == front.seq) {
+        write_index.erase(it);
         break;
+      }
+    }
+    write_queue.pop_front();
+    if (write_index.empty()) {
+      write_index_max_len = 0;
+      pending_min_offset = 0;
+      pending_max_end = 0;
+    } else {
+      pending_min_offset = write_index.begin()->first;
+    }
+  }
+
+  // Cheap, lock-free test for whether [start, start + count) may overlap a
+  // pending write. False negatives are impossible for writes that were
+  // enqueued before the call.
+  bool mayOverlapPending(off_t start, size_t count) const {
+    off_t lo = pending_min_offset.load();
+    off_t hi = pending_max_end.load();
+    return lo < hi && start < hi && lo < start + (off_t)count;
+  }
 
-      if (read_buffer.available_space() > 0 && !read_worker_stop_flag.load()) {
-        uint64_t my_gen = read_buffer_generation.load();
+  // --- SNOOP: Patches pending (unflushed) writes overlapping
+  // [start, start + count) into 'dest', oldest first so the newest bytes
+  // win. Returns how far into 'dest' the patched data reaches.
+  // Thread-Safety: Must be called under write_mutex.
+  size_t snoopPendingWrites(off_t start, size_t count, char *dest) {
+    if (write_index.empty())
+      return 0;
+    off_t end = start + (off_t)count;
+    off_t lo = start - (off_t)write_index_max_len + 1;
+    std::vector<uint64_t> hits;
+    for (auto it = write_index.lower_bound(lo);
+         it != write_index.end() && it->first < end; ++it) {
+      hits.push_back(it->second);
+    }
+    if (hits.empty())
+      return 0;
+    std::sort(hits.begin(), hits.end());
+
+    uint64_t front_seq = write_queue.front().seq;
+    size_t covered = 0;
+    for (uint64_t seq : hits) {
+      const WriteRequest &req = write_queue[static_cast<size_t>(seq - front_seq)];
+      off_t write_start = req.file_offset;
+      off_t write_end = req.file_offset + (off_t)req.length;
+      off_t overlap_start = std::max(start, write_start);
+      off_t overlap_end = std::min(end, write_end);
+      if (overlap_start < overlap_end) {
+        size_t len = static_cast<size_t>(overlap_end - overlap_start);
+        size_t dest_idx = static_cast<size_t>(overlap_start - start);
+        size_t offset_in_req = static_cast<size_t>(overlap_start - write_start);
+        size_t ring_abs_pos = req.ring_buffer_pos + offset_in_req;
+        write_ring_buffer.peek_at(ring_abs_pos, dest + dest_idx, len);
+        stats.snoop_patched_bytes.fetch_add(len, std::memory_order_relaxed);
+        covered = std::max(covered, dest_idx + len);
+      }
+    }
+    return covered;
+  }
 
-        off_t read_pos = current_file_offset + read_buffer.available_data();
+  // Records the first asynchronous error; later errors never overwrite it.
+  void recordError(int err) {
+    int expected = 0;
+    if (stats.last_error_code.compare_exchange_strong(expected, err))
+      notifyWritable();
+  }
 
-        // --- CRITICAL: Read full available space (which might have grown!) ---
-        size_t n = read_buffer.available_space();
-        if (temp_buffer.capacity() < n)
-          temp_buffer.reserve(n); // Grow scratch if needed
-        temp_buffer.resize(n);
+  // Writes 'length' bytes described by 'segs' to storage at 'pos', retrying
+  // short writes. Records the sticky error and returns false on failure.
+  bool writeSegments(const RingSegment *segs, size_t nsegs, off_t pos,
+                     size_t length, size_t &total_written) {
+    size_t seg_idx = 0;
+    size_t seg_off = 0;
+    while (total_written < length) {
+      ssize_t written_now;
+      if (ops.pwritev) {
+        conveyor_iovec_t iov[2];
+        int iovcnt = 0;
+        for (size_t i = seg_idx; i < nsegs; ++i) {
+          size_t skip = (i == seg_idx) ? seg_off : 0;
+          iov[iovcnt].iov_base = segs[i].data + skip;
+          iov[iovcnt].iov_len = segs[i].len - skip;
+          iovcnt++;
+        }
+        written_now = ops.pwritev(handle, iov, iovcnt, pos + total_written);
+      } else {
+        written_now =
+            ops.pwrite(handle, segs[seg_idx].data + seg_off,
+                       segs[seg_idx].len - seg_off, pos + total_written);
+      }
+      if (written_now < 0) {
+        recordError(errno);
+        return false;
+      }
+      if (written_now == 0) {
+        recordError(EIO);
+        return false;
+      }
+      total_written += written_now;
+      // Step over the segments the backend consumed.
+      size_t advance = static_cast<size_t>(written_now);
+      while (advance > 0 && seg_idx < nsegs) {
+        size_t left = segs[seg_idx].len - seg_off;
+        if (advance < left) {
+          seg_off += advance;
+          advance = 0;
+        } else {
+          advance -= left;
+          seg_idx++;
+          seg_off = 0;
+        }
+      }
+    }
+    return true;
+  }
 
-        lock.unlock();
+  // --- COALESCE: Describe the run of file-contiguous requests starting at
+  // the first undispatched entry. Requests are laid out back-to-back in the
+  // ring in queue order, so a run that is contiguous in the file is also
+  // contiguous in the ring (modulo one wrap). Returns false when there is
+  // nothing to issue, or when the run would overlap a write that is still
+  // in flight (issuing it could reorder the two on the backend).
+  // Thread-Safety: Must be called under write_mutex.
+  bool planWriteBatch(WriteBatch &batch) const {
+    if (write_dispatched >= write_queue.size())
+      return false;
+    const WriteRequest &first = write_queue[write_dispatched];
+    batch.first_seq = first.seq;
+    batch.file_offset = first.file_offset;
+    batch.length = first.length;
+    batch.ring_buffer_pos = first.ring_buffer_pos;
+    batch.count = 1;
+    while (write_dispatched + batch.count < write_queue.size()) {
+      const WriteRequest &next = write_queue[write_dispatched + batch.count];
+      if (next.absorbed ||
+          next.file_offset != batch.file_offset + (off_t)batch.length)
+        break;
+      if (batch.length + next.length > max_coalesce_size)
+        break;
+      batch.length += next.length;
+      batch.count++;
+    }
+    if (!(flags & O_APPEND)) {
+      off_t batch_end = batch.file_offset + (off_t)batch.length;
+      for (const auto &other : write_inflight) {
+        if (batch.file_offset < other.write_pos + (off_t)other.length &&
+            other.write_pos < batch_end) {
+          batch.count = 0;
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Marks a planned batch as in flight and resolves its storage offset.
+  // Thread-Safety: Must be called under write_mutex.
+  void dispatchWriteBatch(WriteBatch &batch) {
+    if (flags & O_APPEND) {
+      // Reserve the append range up front so concurrent workers land their
+      // batches back-to-back in queue order.
+      batch.write_pos = logical_write_offset.fetch_add(batch.length);
+    } else {
+      batch.write_pos = batch.file_offset;
+    }
+    write_dispatched += batch.count;
+    write_inflight.push_back(batch);
+    LIBCONVEYOR_TRACE(this, CONVEYOR_TRACE_DEQUEUE, batch.write_pos,
+                      batch.length);
+    skipAbsorbedWrites();
+  }
+
+  // Issues the backend I/O for a dispatched batch. Called with 'lock' held;
+  // drops it for the duration of the I/O and reacquires it before returning.
+  // The bytes stay put in the ring while we are unlocked: the tail only
+  // moves when the batch is retired, and resizing waits for an empty queue.
+  bool issueWriteBatch(std::unique_lock<std::mutex> &lock,
+                       const WriteBatch &batch,
+                       ScratchBuffer &scratch_buffer) {
+    RingSegment segs[2];
+    size_t nsegs;
+    if (ops.pwritev) {
+      // Zero-copy: hand the ring segments directly to the backend.
+      nsegs = write_ring_buffer.segments_at(batch.ring_buffer_pos,
+                                            batch.length, segs);
+    } else {
+      // --- CRITICAL SECTION: Copy data out of RingBuffer ---
+      if (scratch_buffer.capacity() < batch.length) {
+        scratch_buffer.reserve(batch.length);
+      }
+      scratch_buffer.resize(batch.length);
+
+      // Peek at the data from the ring buffer into our scratch space.
+      // We don't advance the tail yet.
+      write_ring_buffer.peek_at(batch.ring_buffer_pos, scratch_buffer.data(),
+                                batch.length);
+      segs[0] = {scratch_buffer.data(), batch.length};
+      nsegs = 1;
+    }
+    lock.unlock();
+
+    throttle(batch.length, false);
+    int64_t traced = LIBCONVEYOR_TRACE_BEGIN(
+        this, CONVEYOR_TRACE_BACKEND_WRITE_BEGIN, batch.write_pos, batch.length);
+    auto start = std::chrono::steady_clock::now();
+    size_t total_written = 0;
+    bool ok = writeSegments(segs, nsegs, batch.write_pos, batch.length,
+                            total_written);
+    auto end = std::chrono::steady_clock::now();
+    LIBCONVEYOR_TRACE_END(this, CONVEYOR_TRACE_BACKEND_WRITE_END,
+                          batch.write_pos, total_written, traced);
+
+    if (ok)
+      recordBackendWrite(end - start);
+    lock.lock();
+    return ok;
+  }
+
+  // Marks a batch complete and retires every completed request at the
+  // front of the queue, in FIFO order, freeing its ring space. Batches may
+  // finish out of order; their space is only reclaimed once all earlier
+  // requests are done, so ring positions seen by the snoop stay valid.
+  // Thread-Safety: Must be called under write_mutex.
+  void retireWriteBatch(const WriteBatch &batch) {
+    size_t index = static_cast<size_t>(batch.first_seq - write_queue.front().seq);
+    for (size_t i = 0; i < batch.count; ++i)
+      write_queue[index + i].completed = true;
+    // Bumped before invalidating, so readAt never caches bytes fetched
+    // before the write that an invalidation has already passed over, and
+    // under the same read_mutex hold, so a reader that copied from the read
+    // buffer either saw the invalidation or sees the count move.
+    if (read_buffer_enabled) {
+      // The requests stay snoopable until popped below, so readers cannot
+      // miss the new bytes between here and the refetch.
+      std::lock_guard<std::mutex> read_lock(read_mutex);
+      write_batches_retired.fetch_add(1, std::memory_order_acq_rel);
+      invalidateReadRange(batch.write_pos, batch.length);
+    } else {
+      write_batches_retired.fetch_add(1, std::memory_order_acq_rel);
+    }
+    for (auto it = write_inflight.begin(); it != write_inflight.end(); ++it) {
+      if (it->first_seq == batch.first_seq) {
+        write_inflight.erase(it);
+        break;
+      }
+    }
+    retireCompletedWrites();
+
+    // Notify producers that space is now officially free, and other workers
+    // that an overlapping batch may no longer block them.
+    write_cv_producer.notify_all();
+    write_cv_consumer.notify_all();
+  }
+
+  // Thread-Safety: Must be called under write_mutex.
+  bool writeWorkReady(WriteBatch &batch) {
+    drainStagedWrites();
+    return planWriteBatch(batch) || write_worker_stop_flag ||
+           (write_buffer_needs_flush && write_queue.empty()) ||
+           (!barriers_ready.empty() && !barrier_firing);
+  }
+
+  // Sleeps until there is a batch to issue, a stop, or a flush to ack. In
+  // single-producer mode the producer never takes the lock to hand over
+  // work, so the worker announces itself as parked and re-checks the
+  // staging queue before it actually waits.
+  void waitForWriteWork(std::unique_lock<std::mutex> &lock, WriteBatch &batch) {
+    while (!writeWorkReady(batch)) {
+      if (staged_writes) {
+        write_workers_parked.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (staged_writes->empty())
+          write_cv_consumer.wait(lock);
+        write_workers_parked.fetch_sub(1, std::memory_order_relaxed);
+      } else {
+        waitOrShrink(lock, write_cv_consumer, true);
+      }
+    }
+  }
+
+  void writeWorker() {
+    // Optimization: Reusable scratch buffer to handle ring-wrap-around
+    // avoids re-allocating memory inside the loop.
+    ScratchBuffer scratch_buffer;
+    scratch_buffer.reserve(4096);
 
-        auto start = std::chrono::steady_clock::now();
-        ssize_t bytes_read = ops.pread(handle, temp_buffer.data(), n, read_pos);
-        auto end = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(write_mutex);
+    while (true) {
+      WriteBatch batch;
+      waitForWriteWork(lock, batch);
+      if (fireBarriers(lock))
+        continue; // The lock was dropped; plan again
+
+      if (batch.count == 0) {
+        if (write_dispatched >= write_queue.size()) {
+          if (write_worker_stop_flag)
+            break;
+          write_buffer_needs_flush = false;
+          write_cv_producer.notify_all();
+        } else {
+          // Stopping, but the next batch overlaps one still in flight;
+          // wait for that one to retire.
+          write_cv_consumer.wait(lock);
+        }
+        continue;
+      }
 
-        lock.lock();
+      dispatchWriteBatch(batch);
+      issueWriteBatch(lock, batch, scratch_buffer);
+      retireWriteBatch(batch);
+    }
+  }
+
+  bool asyncOps() const { return ops.submit && ops.reap; }
+
+  // A write batch submitted to an asynchronous backend.
+  struct AsyncWrite {
+    WriteBatch batch;
+    size_t written = 0; // Progress so far (short writes are resubmitted)
+    conveyor_iovec_t iov[2];
+    std::chrono::steady_clock::time_point start;
+    int64_t traced = 0;
+  };
+
+  // Queues the unwritten rest of 'w' on the backend, straight out of the
+  // ring. Returns false (with the sticky error recorded) on failure.
+  // Thread-Safety: Must be called under write_mutex.
+  bool submitAsyncWrite(AsyncWrite &w, size_t slot) {
+    RingSegment segs[2];
+    size_t nsegs = write_ring_buffer.segments_at(
+        w.batch.ring_buffer_pos + w.written, w.batch.length - w.written, segs);
+    for (size_t i = 0; i < nsegs; ++i) {
+      w.iov[i].iov_base = segs[i].data;
+      w.iov[i].iov_len = segs[i].len;
+    }
+    if (ops.submit(handle, CONVEYOR_QUEUE_WRITE, CONVEYOR_OP_WRITE, w.iov,
+                   static_cast<int>(nsegs), w.batch.write_pos + w.written,
+                   slot) != 0) {
+      recordError(errno);
+      return false;
+    }
+    return true;
+  }
 
-        if (my_gen != read_buffer_generation.load()) {
+  // Write-behind over an asynchronous backend: a single thread keeps up to
+  // write_queue_depth batches in flight, hands them to the backend in one
+  // go, and retires each as its completion arrives.
+  void asyncWriteWorker() {
+    std::vector<AsyncWrite> slots(write_queue_depth);
+    std::vector<size_t> free_slots;
+    for (size_t i = write_queue_depth; i > 0; --i)
+      free_slots.push_back(i - 1);
+    std::vector<conveyor_completion_t> done(write_queue_depth);
+
+    std::unique_lock<std::mutex> lock(write_mutex);
+    bool waited = false; // The next batch submitted was throttled
+    auto reap_backoff = std::chrono::milliseconds(0);
+    while (true) {
+      WriteBatch batch;
+      fireBarriers(lock);
+      drainStagedWrites();
+      auto throttled = RateLimiter::Clock::duration::zero();
+      while (!free_slots.empty() &&
+             (throttled = throttleDelay(false)) ==
+                 RateLimiter::Clock::duration::zero() &&
+             planWriteBatch(batch)) {
+        size_t slot = free_slots.back();
+        free_slots.pop_back();
+        dispatchWriteBatch(batch);
+        slots[slot].batch = batch;
+        slots[slot].written = 0;
+        slots[slot].start = std::chrono::steady_clock::now();
+        slots[slot].traced = LIBCONVEYOR_TRACE_BEGIN(
+            this, CONVEYOR_TRACE_BACKEND_WRITE_BEGIN, batch.write_pos,
+            batch.length);
+        if (!submitAsyncWrite(slots[slot], slot)) {
+          retireWriteBatch(batch);
+          free_slots.push_back(slot);
           continue;
         }
+        chargeThrottle(batch.length);
+        if (waited)
+          stats.throttled_ops++;
+        waited = false;
+      }
 
-        stats.total_read_latency_ms +=
-            std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
-                .count();
-        stats.read_ops_count++;
-
-        if (bytes_read > 0) {
-          read_buffer.write(temp_buffer.data(), bytes_read);
-        } else if (bytes_read == 0) {
-          read_eof_flag = true;
-        } else if (stats.last_error_code.load() == 0) {
-          stats.last_error_code = errno;
+      size_t inflight = write_queue_depth - free_slots.size();
+      if (inflight == 0) {
+        if (throttled > RateLimiter::Clock::duration::zero() &&
+            planWriteBatch(batch)) {
+          auto start = RateLimiter::Clock::now();
+          write_cv_consumer.wait_for(lock, throttled);
+          recordThrottleWait(RateLimiter::Clock::now() - start);
+          waited = true;
+          continue;
+        }
+        waitForWriteWork(lock, batch);
+        if (batch.count == 0 && write_dispatched >= write_queue.size()) {
+          if (write_worker_stop_flag)
+            break;
+          write_buffer_needs_flush = false;
+          write_cv_producer.notify_all();
         }
+        continue;
+      }
+
+      lock.unlock();
+      int n = ops.reap(handle, CONVEYOR_QUEUE_WRITE, done.data(),
+                       static_cast<int>(done.size()), 1);
+      int reap_error = (n < 0) ? errno : 0;
+      lock.lock();
+
+      if (n < 0) {
+        // The kernel may still be reading the ring bytes of every batch in
+        // flight, so none is retired (which would free its space) until
+        // its completion is reaped. The sticky error stops new writes and
+        // ends flushes; reaping is retried, backing off, until they drain.
+        recordError(reap_error);
+        write_cv_producer.notify_all();
+        reap_backoff =
+            std::min(std::max(2 * reap_backoff, std::chrono::milliseconds(1)),
+                     std::chrono::milliseconds(100));
+        write_cv_consumer.wait_for(lock, reap_backoff);
+        continue;
+      }
+      reap_backoff = std::chrono::milliseconds(0);
+
+      for (int i = 0; i < n; ++i) {
+        size_t slot = static_cast<size_t>(done[i].user_data);
+        AsyncWrite &w = slots[slot];
+        ssize_t res = done[i].result;
+        if (res > 0) {
+          w.written += static_cast<size_t>(res);
+          if (w.written < w.batch.length && submitAsyncWrite(w, slot))
+            continue; // Short write: the rest is back in flight.
+          LIBCONVEYOR_TRACE_END(this, CONVEYOR_TRACE_BACKEND_WRITE_END,
+                                w.batch.write_pos, w.written, w.traced);
+          if (w.written == w.batch.length)
+            recordBackendWrite(std::chrono::steady_clock::now() - w.start);
+        } else {
+          recordError(res < 0 ? static_cast<int>(-res) : EIO);
+        }
+        retireWriteBatch(w.batch);
+        free_slots.push_back(slot);
       }
-      if (read_worker_needs_fill.load())
-        read_worker_needs_fill = false;
-      read_cv_consumer.notify_all();
     }
   }
-};
-} // namespace libconveyor
 
-conveyor_t *conveyor_create(const conveyor_config_t *cfg) {
-  if (!cfg) {
-    errno = EINVAL;
-    return nullptr;
+  // One turn of write work on the shared executor: issue at most one
+  // batch, then requeue behind other conveyors if more is waiting.
+  void runWriteJob() {
+    static thread_local ScratchBuffer scratch_buffer;
+    std::unique_lock<std::mutex> lock(write_mutex);
+    WriteBatch batch;
+    drainStagedWrites();
+    if (planWriteBatch(batch)) {
+      auto wait = throttleDelay(false);
+      if (wait > RateLimiter::Clock::duration::zero()) {
+        // Come back when the limit allows, without holding a pool thread.
+        lock.unlock();
+        deferJob(true, false, wait);
+        return;
+      }
+      dispatchWriteBatch(batch);
+      issueWriteBatch(lock, batch, scratch_buffer);
+      retireWriteBatch(batch);
+    }
+    fireBarriers(lock);
+
+    // Clear the flag before looking again, so that anything queued after
+    // the look posts a fresh job instead of being missed.
+    write_job_scheduled = false;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    drainStagedWrites();
+    if (planWriteBatch(batch))
+      scheduleWriteJob();
+    write_cv_producer.notify_all(); // conveyor_destroy waits for idle
   }
-  auto *impl = new libconveyor::ConveyorImpl(cfg->initial_write_size,
-                                             cfg->initial_read_size);
-  impl->handle = cfg->handle;
-  impl->flags = cfg->flags;
-  impl->ops = cfg->ops;
-  impl->max_write_capacity =
-      (cfg->max_write_size > 0) ? cfg->max_write_size : cfg->initial_write_size;
-  impl->max_read_capacity =
-      (cfg->max_read_size > 0) ? cfg->max_read_size : cfg->initial_read_size;
 
-  int mode = cfg->flags & O_ACCMODE;
-  impl->read_buffer_enabled =
-      (mode == O_RDONLY || mode == O_RDWR) && (cfg->initial_read_size > 0);
-  impl->write_buffer_enabled =
-      (mode == O_WRONLY || mode == O_RDWR) && (cfg->initial_write_size > 0);
+  // Drops everything read-ahead has fetched or has in flight and restarts
+  // fetching at 'offset'. In-flight chunks carry the old generation and are
+  // discarded when they complete.
+  // Thread-Safety: Must be called under read_mutex.
+  void restartReadAhead(off_t offset) {
+    read_buffer_generation++;
+    stats.read_invalidations++;
+    LIBCONVEYOR_TRACE(this, CONVEYOR_TRACE_INVALIDATE, offset, 0);
+    read_head_in_storage = offset;
+    read_reserved = 0;
+    read_completed.clear();
+    next_read_commit_seq = next_read_chunk_seq;
+  }
 
-  if (impl->read_buffer_enabled) {
-    impl->read_worker_thread =
-        std::thread(&libconveyor::ConveyorImpl::readWorker, impl);
-    std::unique_lock<std::mutex> lock(impl->read_mutex);
-    impl->read_worker_needs_fill = true;
-    impl->read_cv_producer.notify_one();
+  // File offset of the first byte in read_buffer. Chunks are committed in
+  // file order, so the ring always ends where uncommitted fetches begin.
+  // Thread-Safety: Must be called under read_mutex.
+  off_t readBufferOffset() const {
+    return read_head_in_storage.load() - static_cast<off_t>(read_reserved) -
+           static_cast<off_t>(read_buffer.available_data());
   }
-  if (impl->write_buffer_enabled) {
-    if (impl->flags & O_APPEND) {
-      off_t sz = impl->ops.lseek(impl->handle, 0, SEEK_END);
-      if (sz == LIBCONVEYOR_ERROR) {
-        conveyor_destroy(reinterpret_cast<conveyor_t *>(impl));
-        return nullptr;
+
+  // Takes n (<= available) bytes from the front of read_buffer into dest,
+  // or drops them when dest is null, keeping a copy in read_cache.
+  // Thread-Safety: Must be called under read_mutex.
+  size_t consumeReadBuffer(char *dest, size_t n) {
+    if (read_cache.enabled()) {
+      off_t pos = readBufferOffset();
+      RingSegment segs[2];
+      size_t nsegs = read_buffer.segments_at(read_buffer.tail, n, segs);
+      for (size_t i = 0; i < nsegs; ++i) {
+        read_cache.insert(pos, segs[i].data, segs[i].len);
+        pos += segs[i].len;
       }
-      impl->logical_write_offset = sz;
-      impl->current_file_offset = sz;
     }
-    impl->write_worker_thread =
-        std::thread(&libconveyor::ConveyorImpl::writeWorker, impl);
+    return read_buffer.read(dest, n);
   }
-  return reinterpret_cast<conveyor_t *>(impl);
+
+  // Makes read_buffer start at 'pos': skips forward when pos is inside the
+  // buffered data, otherwise restarts read-ahead there.
+  // Thread-Safety: Must be called under read_mutex, with no read view out.
+  void alignReadBuffer(off_t pos) {
+    off_t ring_off = readBufferOffset();
+    if (pos == ring_off)
+      return;
+    if (pos > ring_off &&
+        pos <= ring_off + static_cast<off_t>(read_buffer.available_data())) {
+      consumeReadBuffer(nullptr, static_cast<size_t>(pos - ring_off));
+      wakeReadWorkers();
+      return;
+    }
+    read_buffer.clear();
+    read_eof_flag = false;
+    restartReadAhead(pos);
+    wakeReadWorkers();
+  }
+
+  // Called once [offset, offset + len) has been written to storage: drops
+  // cached copies and refetches any read-ahead that covers the range. The
+  // front of the ring up to the write (or a read view) is kept.
+  // Thread-Safety: Must be called under read_mutex.
+  void invalidateReadRange(off_t offset, size_t len) {
+    read_cache.invalidate(offset, len);
+    off_t ring_off = readBufferOffset();
+    if (offset + static_cast<off_t>(len) <= ring_off ||
+        offset >= read_head_in_storage.load())
+      return;
+    size_t keep = (offset > ring_off) ? static_cast<size_t>(offset - ring_off) : 0;
+    keep = std::max(keep, read_view_len);
+    keep = std::min(keep, read_buffer.available_data());
+    read_buffer.truncate(keep);
+    read_eof_flag = false;
+    restartReadAhead(ring_off + static_cast<off_t>(keep));
+    wakeReadWorkers();
+  }
+
+  // conveyor_read with read_cache enabled: serves [offset, offset + count)
+  // from the cache where it can and from read_buffer, realigned to the
+  // first missing byte, where it cannot. 'hit' is cleared if it had to
+  // wait for storage.
+  // Thread-Safety: 'lock' must hold read_mutex.
+  size_t readCached(std::unique_lock<std::mutex> &lock, off_t offset,
+                    char *dest, size_t count, bool &hit) {
+    size_t total = 0;
+    while (total < count && !read_worker_stop_flag.load()) {
+      total += read_cache.read(offset + static_cast<off_t>(total),
+                               dest + total, count - total);
+      if (total == count)
+        break;
+      alignReadBuffer(offset + static_cast<off_t>(total));
+      if (read_buffer.empty()) {
+        if (!read_eof_flag.load())
+          hit = false;
+        if (!waitForReadData(lock))
+          break;
+        continue; // The ring may have moved while we waited
+      }
+      size_t n = std::min(count - total, read_buffer.available_data());
+      total += consumeReadBuffer(dest + total, n);
+      wakeReadWorkers();
+    }
+    return total;
+  }
+
+  // conveyor_pread: copies whatever read_cache and read_buffer already hold
+  // of [offset, offset + count), up to the first byte neither has. Nothing
+  // is consumed.
+  // Thread-Safety: Must be called under read_mutex.
+  size_t peekBuffered(off_t offset, char *dest, size_t count) {
+    size_t total = 0;
+    while (total < count) {
+      total += read_cache.read(offset + static_cast<off_t>(total),
+                               dest + total, count - total);
+      off_t pos = offset + static_cast<off_t>(total);
+      off_t ring_off = readBufferOffset();
+      off_t ring_end =
+          ring_off + static_cast<off_t>(read_buffer.available_data());
+      if (total == count || pos < ring_off || pos >= ring_end)
+        break;
+      size_t n = std::min(count - total, static_cast<size_t>(ring_end - pos));
+      read_buffer.peek_at(read_buffer.tail + static_cast<size_t>(pos - ring_off),
+                          dest + total, n);
+      read_cache.insert(pos, dest + total, n);
+      total += n;
+    }
+    return total;
+  }
+
+  // Reads [offset, offset + count) from storage (or the mapping), bypassing
+  // the buffers; short only at the end of the file. Returns the bytes read,
+  // or LIBCONVEYOR_ERROR with errno set.
+  // Thread-Safety: Must not hold read_mutex.
+  ssize_t readStorage(off_t offset, char *dest, size_t count) {
+    if (!read_mapped)
+      throttle(count, foreground(true));
+    int64_t traced = LIBCONVEYOR_TRACE_BEGIN(
+        this, CONVEYOR_TRACE_BACKEND_READ_BEGIN, offset, count);
+    auto start = std::chrono::steady_clock::now();
+    size_t total = 0;
+    while (total < count) {
+      off_t at = offset + static_cast<off_t>(total);
+      ssize_t n = read_mapped ? copyMapped(dest + total, count - total, at)
+                              : ops.pread(handle, dest + total,
+                                          count - total, at);
+      if (n < 0 && total == 0)
+        return LIBCONVEYOR_ERROR;
+      if (n <= 0)
+        break;
+      total += n;
+    }
+    recordBackendRead(std::chrono::steady_clock::now() - start);
+    LIBCONVEYOR_TRACE_END(this, CONVEYOR_TRACE_BACKEND_READ_END, offset, total,
+                          traced);
+    return static_cast<ssize_t>(total);
+  }
+
+  // conveyor_pread without the snoop: buffered bytes first, then storage.
+  // Fetched bytes are cached unless a batch was retired since 'retired' was
+  // sampled. Returns the bytes read, or LIBCONVEYOR_ERROR with errno set;
+  // 'hit' says whether storage was left alone.
+  // Thread-Safety: Must not hold read_mutex.
+  ssize_t readAt(off_t offset, char *dest, size_t count, uint64_t retired,
+                 bool &hit) {
+    size_t total = 0;
+    if (read_buffer_enabled) {
+      std::lock_guard<std::mutex> lock(read_mutex);
+      total = peekBuffered(offset, dest, count);
+    }
+    size_t buffered = total;
+    hit = (total == count);
+    if (total < count) {
+      ssize_t n = readStorage(offset + static_cast<off_t>(total), dest + total,
+                              count - total);
+      if (n == LIBCONVEYOR_ERROR)
+        return LIBCONVEYOR_ERROR;
+      total += static_cast<size_t>(n);
+    }
+    if (read_cache.enabled() && total > buffered) {
+      std::lock_guard<std::mutex> lock(read_mutex);
+      if (write_batches_retired.load(std::memory_order_acquire) == retired)
+        read_cache.insert(offset + static_cast<off_t>(buffered),
+                          dest + buffered, total - buffered);
+    }
+    return static_cast<ssize_t>(total);
+  }
+
+  // pread from the mapping: one copy, short at the end of what is mapped.
+  ssize_t copyMapped(char *dest, size_t count, off_t offset) {
+    const void *data = nullptr;
+    ssize_t n = ops.map(handle, offset, count, &data);
+    if (n > 0)
+      std::memcpy(dest, data, static_cast<size_t>(n));
+    return n;
+  }
+
+  // Read-ahead for mapped storage: a sequential read of 'count' bytes at
+  // 'offset' re-advises the window past it once it is halfway through the
+  // last one, or has left it. Advice is only a hint, so failures are not
+  // sticky.
+  // Thread-Safety: Must be called under read_mutex.
+  void adviseReadAhead(off_t offset, size_t count) {
+    if (!ops.advise || read_advise_window == 0)
+      return;
+    off_t end = offset + static_cast<off_t>(count);
+    off_t half = static_cast<off_t>(read_advise_window / 2);
+    if (offset >= advised_start && end <= advised_end - half)
+      return;
+    advised_start = offset;
+    advised_end = end + static_cast<off_t>(read_advise_window);
+    ops.advise(handle, end, read_advise_window);
+  }
+
+  // Thread-Safety: Must be called under read_mutex.
+  bool readChunkAvailable() const {
+    if (stats.last_error_code.load() != 0)
+      return false;
+    if (read_inflight >= read_ahead_depth)
+      return false;
+    if (!read_prefetch.empty())
+      return true;
+    if (read_eof_flag.load())
+      return false;
+    return read_buffer.available_space() > read_reserved &&
+           nextReadChunkLength() > 0;
+  }
+
+  // Length of the next read-ahead chunk: the unpromised ring space, capped
+  // at read_chunk_size. Under direct I/O it is trimmed to end on a block
+  // boundary (0 until that much space is free), so chunks after the first
+  // are block multiples at block offsets.
+  // Thread-Safety: Must be called under read_mutex.
+  size_t nextReadChunkLength() const {
+    size_t n = read_buffer.available_space() - read_reserved;
+    if (read_chunk_size > 0 && n > read_chunk_size)
+      n = read_chunk_size;
+    if (direct_io_block > 0) {
+      off_t head = read_head_in_storage.load();
+      off_t bs = static_cast<off_t>(direct_io_block);
+      off_t end = (head + static_cast<off_t>(n)) / bs * bs;
+      n = end > head ? static_cast<size_t>(end - head) : 0;
+    }
+    return n;
+  }
+
+  // Claims the next read-ahead chunk, if there is ring space that is not
+  // already promised to another chunk and the in-flight limit allows it.
+  // Thread-Safety: Must be called under read_mutex.
+  bool planReadChunk(ReadChunk &chunk) {
+    if (!readChunkAvailable())
+      return false;
+    if (!read_prefetch.empty()) {
+      chunk.prefetch = true;
+      chunk.offset = read_prefetch.front().first;
+      chunk.length = read_prefetch.front().second;
+      chunk.retired = write_batches_retired.load(std::memory_order_acquire);
+      read_prefetch.pop_front();
+      read_inflight++;
+      return true;
+    }
+    size_t n = nextReadChunkLength();
+
+    chunk.seq = next_read_chunk_seq++;
+    chunk.generation = read_buffer_generation.load();
+    chunk.offset = read_head_in_storage.load();
+    chunk.length = n;
+    read_head_in_storage += n;
+    read_reserved += n;
+    read_inflight++;
+    return true;
+  }
+
+  // Caches what a prefetch chunk fetched, unless a write has reached
+  // storage since it was planned (the bytes may predate it). Prefetch
+  // errors are not sticky; a real read will report them.
+  // Thread-Safety: Must be called under read_mutex.
+  void completePrefetch(const ReadChunk &chunk, const char *data) {
+    if (chunk.result > 0 &&
+        write_batches_retired.load(std::memory_order_acquire) == chunk.retired)
+      read_cache.insert(chunk.offset, data, static_cast<size_t>(chunk.result));
+  }
+
+  // Counts a read as a hit (served from buffered data) or a miss, feeds it
+  // to the pattern detector, and queues the predicted records of a
+  // strided or reverse stream for prefetch, block-aligned so they cache
+  // cleanly.
+  // Thread-Safety: Must be called under read_mutex.
+  void observeRead(off_t offset, size_t count, bool hit) {
+    (hit ? stats.read_hits : stats.read_misses)++;
+    (hit ? stats.read_hit_bytes : stats.read_miss_bytes)
+        .fetch_add(count, std::memory_order_relaxed);
+    if (!read_cache.enabled() || count == 0)
+      return;
+    AccessPattern::Kind kind = read_pattern.observe(offset, count);
+    if (kind != AccessPattern::kStrided && kind != AccessPattern::kReverse) {
+      read_prefetch.clear();
+      return;
+    }
+
+    off_t bs = static_cast<off_t>(read_cache.block_size);
+    size_t footprint = (count + 2 * read_cache.block_size - 1) /
+                       read_cache.block_size * read_cache.block_size;
+    size_t max_depth = std::min(kMaxPrefetchDepth,
+                                read_cache.capacity() / (2 * footprint));
+    if (!hit)
+      read_pattern.grow(max_depth);
+
+    for (size_t i = read_pattern.prefetched + 1; i <= read_pattern.depth; ++i) {
+      off_t start = read_pattern.predict(i);
+      if (start < 0)
+        break;
+      off_t first = start / bs * bs;
+      off_t end = (start + static_cast<off_t>(count) + bs - 1) / bs * bs;
+      if (!read_cache.contains(first, static_cast<size_t>(end - first)))
+        read_prefetch.emplace_back(first, static_cast<size_t>(end - first));
+    }
+    read_pattern.prefetched = read_pattern.depth;
+    // Workers that fell behind: the nearest predictions are being read on
+    // demand by now.
+    while (read_prefetch.size() > read_pattern.depth)
+      read_prefetch.pop_front();
+    if (!read_prefetch.empty())
+      wakeReadWorkers();
+  }
+
+  // Commits finished chunks into read_buffer in file order.
+  // Thread-Safety: Must be called under read_mutex.
+  void commitReadChunks() {
+    auto it = read_completed.find(next_read_commit_seq);
+    while (it != read_completed.end()) {
+      ReadChunk &c = it->second;
+      read_reserved -= c.length;
+      next_read_commit_seq++;
+
+      if (c.result > 0) {
+        read_buffer.write(c.data.data(), c.result);
+      }
+      if (c.result < 0) {
+        recordError(c.error);
+      } else if (c.result == 0) {
+        read_eof_flag = true;
+      }
+      if (c.result < (ssize_t)c.length) {
+        // Short read, EOF or error: every later chunk was fetched from the
+        // wrong place, so restart right after the bytes we actually got.
+        restartReadAhead(c.offset + (c.result > 0 ? c.result : 0));
+        return;
+      }
+      read_completed.erase(it);
+      it = read_completed.find(next_read_commit_seq);
+    }
+  }
+
+  // --- ADAPTIVE READ: Heuristic Logic ---
+  // Grows read_buffer for oversized or sequential-exhausting reads.
+  // Thread-Safety: Must be called under read_mutex, with no read view out.
+  void adaptReadBuffer(off_t start_offset, size_t count) {
+    bool grow = false;
+
+    // Trigger 1: Request larger than buffer
+    if (count > read_buffer.capacity)
+      grow = true;
+
+    // Trigger 2: Sequential exhaustion (Buffer empty + Sequential Read)
+    if (read_buffer.empty() && start_offset == last_read_end_offset) {
+      sequential_read_counter++;
+      // If we hit empty buffer sequentially 3 times, assume bandwidth mismatch
+      // -> Grow
+      if (sequential_read_counter > 2)
+        grow = true;
+    } else {
+      sequential_read_counter = 0; // Reset on random seek
+    }
+
+    if (grow && read_buffer.capacity < max_read_capacity) {
+      size_t new_cap = read_buffer.capacity * 2;
+      if (new_cap < count)
+        new_cap = count; // Ensure we fit the specific request
+      if (new_cap > max_read_capacity)
+        new_cap = max_read_capacity;
+
+      // Resize immediately. readWorker will see new capacity on next loop.
+      // Over budget the ring stays as it is; reads larger than it are
+      // still served, one fill at a time.
+      if (chargeMemory(new_cap - read_buffer.capacity, false)) {
+        read_buffer.resize(new_cap);
+        stats.read_resizes++;
+        LIBCONVEYOR_TRACE(this, CONVEYOR_TRACE_READ_RESIZE, 0, new_cap);
+      }
+    }
+    last_read_end_offset = start_offset + count;
+  }
+
+  // Blocks until read_buffer holds data. Returns false at EOF, on a sticky
+  // error, or when stopping.
+  // Thread-Safety: 'lock' must hold read_mutex.
+  bool waitForReadData(std::unique_lock<std::mutex> &lock) {
+    if (!read_buffer.empty())
+      return true;
+    // FIXED EOF LOGIC: If buffer is empty and EOF flag is set, we are done.
+    if (read_eof_flag.load())
+      return false;
+
+    read_worker_needs_fill = true;
+    wakeReadWorkers();
+    read_cv_consumer.wait(lock, [&] {
+      return read_buffer.available_data() > 0 || read_eof_flag.load() ||
+             stats.last_error_code.load() != 0 ||
+             read_worker_stop_flag.load();
+    });
+    return read_buffer.available_data() > 0;
+  }
+
+  // Issues the pread for a claimed chunk and commits the result. Called
+  // with 'lock' held; drops it for the duration of the I/O.
+  void fetchReadChunk(std::unique_lock<std::mutex> &lock, ReadChunk &chunk,
+                      ScratchBuffer &temp_buffer) {
+    temp_buffer.resize(chunk.length);
+    lock.unlock();
+
+    throttle(chunk.length,
+             !chunk.prefetch && foreground(read_worker_needs_fill.load()),
+             &read_worker_stop_flag);
+    int64_t traced = LIBCONVEYOR_TRACE_BEGIN(
+        this, CONVEYOR_TRACE_BACKEND_READ_BEGIN, chunk.offset, chunk.length);
+    auto start = std::chrono::steady_clock::now();
+    chunk.result =
+        ops.pread(handle, temp_buffer.data(), chunk.length, chunk.offset);
+    chunk.error = (chunk.result < 0) ? errno : 0;
+    auto end = std::chrono::steady_clock::now();
+    LIBCONVEYOR_TRACE_END(
+        this, CONVEYOR_TRACE_BACKEND_READ_END, chunk.offset,
+        chunk.result > 0 ? static_cast<size_t>(chunk.result) : 0, traced);
+
+    lock.lock();
+    read_inflight--;
+
+    if (chunk.prefetch) {
+      completePrefetch(chunk, temp_buffer.data());
+      return;
+    }
+    if (chunk.generation != read_buffer_generation.load()) {
+      // Invalidated by lseek (or an earlier short read) while in flight.
+      return;
+    }
+
+    recordBackendRead(end - start);
+
+    chunk.data.swap(temp_buffer);
+    read_completed.emplace(chunk.seq, std::move(chunk));
+    commitReadChunks();
+
+    if (read_worker_needs_fill.load())
+      read_worker_needs_fill = false;
+    read_cv_consumer.notify_all();
+  }
+
+  void readWorker() {
+    ScratchBuffer temp_buffer;
+    std::unique_lock<std::mutex> lock(read_mutex);
+    while (true) {
+      ReadChunk chunk;
+      while (!read_worker_stop_flag.load() && !planReadChunk(chunk))
+        waitOrShrink(lock, read_cv_producer, false);
+      if (read_worker_stop_flag.load()) {
+        if (chunk.length > 0)
+          read_inflight--;
+        break;
+      }
+
+      fetchReadChunk(lock, chunk, temp_buffer);
+      read_cv_producer.notify_all();
+    }
+  }
+
+  // Read-ahead over an asynchronous backend: a single thread keeps up to
+  // read_ahead_depth chunks in flight and commits them as they complete.
+  // Outstanding reads target per-slot buffers, so the thread only exits
+  // once all of them have been reaped.
+  void asyncReadWorker() {
+    struct Slot {
+      ReadChunk chunk;
+      ScratchBuffer buffer;
+      conveyor_iovec_t iov;
+      std::chrono::steady_clock::time_point start;
+      int64_t traced;
+    };
+    std::vector<Slot> slots(read_ahead_depth);
+    std::vector<size_t> free_slots;
+    for (size_t i = read_ahead_depth; i > 0; --i)
+      free_slots.push_back(i - 1);
+    std::vector<conveyor_completion_t> done(read_ahead_depth);
+
+    std::unique_lock<std::mutex> lock(read_mutex);
+    bool waited = false; // The next chunk submitted was throttled
+    auto reap_backoff = std::chrono::milliseconds(0);
+    while (true) {
+      ReadChunk chunk;
+      auto throttled = RateLimiter::Clock::duration::zero();
+      while (!read_worker_stop_flag.load() && !free_slots.empty() &&
+             (throttled = throttleDelay(
+                  foreground(read_worker_needs_fill.load()))) ==
+                 RateLimiter::Clock::duration::zero() &&
+             planReadChunk(chunk)) {
+        size_t slot = free_slots.back();
+        free_slots.pop_back();
+        Slot &sl = slots[slot];
+        sl.buffer.resize(chunk.length);
+        sl.iov.iov_base = sl.buffer.data();
+        sl.iov.iov_len = chunk.length;
+        sl.chunk = std::move(chunk);
+        sl.start = std::chrono::steady_clock::now();
+        sl.traced = LIBCONVEYOR_TRACE_BEGIN(
+            this, CONVEYOR_TRACE_BACKEND_READ_BEGIN, sl.chunk.offset,
+            sl.chunk.length);
+        if (ops.submit(handle, CONVEYOR_QUEUE_READ, CONVEYOR_OP_READ, &sl.iov,
+                       1, sl.chunk.offset, slot) != 0) {
+          read_inflight--;
+          free_slots.push_back(slot);
+          if (sl.chunk.prefetch) {
+            chunk = ReadChunk();
+            continue; // Speculative; just drop it.
+          }
+          // Commit it as a failed read so the usual error path runs.
+          sl.chunk.result = LIBCONVEYOR_ERROR;
+          sl.chunk.error = errno;
+          uint64_t seq = sl.chunk.seq;
+          read_completed.emplace(seq, std::move(sl.chunk));
+          commitReadChunks();
+          read_cv_consumer.notify_all();
+        } else {
+          chargeThrottle(sl.chunk.length);
+          if (waited)
+            stats.throttled_ops++;
+          waited = false;
+        }
+        chunk = ReadChunk();
+      }
+
+      size_t inflight = read_ahead_depth - free_slots.size();
+      if (inflight == 0) {
+        if (read_worker_stop_flag.load())
+          break;
+        if (throttled > RateLimiter::Clock::duration::zero() &&
+            readChunkAvailable()) {
+          auto start = RateLimiter::Clock::now();
+          read_cv_producer.wait_for(lock, throttled);
+          recordThrottleWait(RateLimiter::Clock::now() - start);
+          waited = true;
+          continue;
+        }
+        while (!read_worker_stop_flag.load() && !readChunkAvailable())
+          waitOrShrink(lock, read_cv_producer, false);
+        continue;
+      }
+
+      lock.unlock();
+      int n = ops.reap(handle, CONVEYOR_QUEUE_READ, done.data(),
+                       static_cast<int>(done.size()), 1);
+      int reap_error = (n < 0) ? errno : 0;
+      lock.lock();
+
+      if (n < 0) {
+        // As for writes: the kernel may still be filling the slot buffers,
+        // so the chunks stay in flight and reaping is retried, backing
+        // off, until they complete. The sticky error stops further
+        // read-ahead and wakes the readers.
+        recordError(reap_error);
+        read_cv_consumer.notify_all();
+        reap_backoff =
+            std::min(std::max(2 * reap_backoff, std::chrono::milliseconds(1)),
+                     std::chrono::milliseconds(100));
+        read_cv_producer.wait_for(lock, reap_backoff);
+        continue;
+      }
+      reap_backoff = std::chrono::milliseconds(0);
+
+      for (int i = 0; i < n; ++i) {
+        size_t slot = static_cast<size_t>(done[i].user_data);
+        Slot &sl = slots[slot];
+        free_slots.push_back(slot);
+        read_inflight--;
+        ssize_t res = done[i].result;
+        LIBCONVEYOR_TRACE_END(this, CONVEYOR_TRACE_BACKEND_READ_END,
+                              sl.chunk.offset,
+                              res > 0 ? static_cast<size_t>(res) : 0,
+                              sl.traced);
+        if (sl.chunk.prefetch) {
+          sl.chunk.result = res;
+          completePrefetch(sl.chunk, sl.buffer.data());
+          continue;
+        }
+        if (sl.chunk.generation != read_buffer_generation.load())
+          continue; // Invalidated by lseek while in flight.
+
+        sl.chunk.result = (res < 0) ? LIBCONVEYOR_ERROR : res;
+        sl.chunk.error = (res < 0) ? static_cast<int>(-res) : 0;
+        recordBackendRead(std::chrono::steady_clock::now() - sl.start);
+
+        sl.chunk.data.swap(sl.buffer);
+        uint64_t seq = sl.chunk.seq;
+        read_completed.emplace(seq, std::move(sl.chunk));
+        sl.chunk = ReadChunk();
+      }
+      commitReadChunks();
+      if (read_worker_needs_fill.load())
+        read_worker_needs_fill = false;
+      read_cv_consumer.notify_all();
+    }
+  }
+
+  // One turn of read-ahead on the shared executor: fetch at most one
+  // chunk, then requeue behind other conveyors if more can be fetched.
+  void runReadJob() {
+    static thread_local ScratchBuffer temp_buffer;
+    std::unique_lock<std::mutex> lock(read_mutex);
+    ReadChunk chunk;
+    if (!read_worker_stop_flag.load() && readChunkAvailable()) {
+      bool fg = foreground(read_worker_needs_fill.load());
+      auto wait = throttleDelay(fg);
+      if (wait > RateLimiter::Clock::duration::zero()) {
+        lock.unlock();
+        deferJob(false, fg, wait);
+        return;
+      }
+    }
+    if (!read_worker_stop_flag.load() && planReadChunk(chunk))
+      fetchReadChunk(lock, chunk, temp_buffer);
+
+    read_job_scheduled = false;
+    if (!read_worker_stop_flag.load() && readChunkAvailable())
+      scheduleReadJob();
+    read_cv_consumer.notify_all(); // conveyor_destroy waits for idle
+  }
+};
+
+// --- SHARED EXECUTOR ---
+// A fixed pool of threads servicing many conveyors. Each queued job is one
+// turn (one batch or one chunk) of one conveyor's write or read work; a
+// conveyor with more to do goes back to the end of the queue, so busy
+// instances take turns rather than starving idle-but-woken ones.
+// Foreground jobs (reads a caller is waiting on) have a queue of their own
+// and go first, though after kForegroundRun of them in a row a waiting
+// background job gets its turn. Jobs held back by a rate limit wait in
+// 'delayed' until they may run, without occupying a thread.
+struct Executor {
+  struct Job {
+    ConveyorImpl *impl;
+    bool write;
+    bool foreground;
+  };
+  using Clock = std::chrono::steady_clock;
+  static constexpr int kForegroundRun = 8;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<Job> queues[2]; // [foreground]
+  std::multimap<Clock::time_point, Job> delayed;
+  int foreground_run = 0;
+  bool stop = false;
+  std::vector<std::thread> threads;
+
+  Executor(size_t num_threads, const Placement &placement = Placement()) {
+    for (size_t i = 0; i < num_threads; ++i) {
+      threads.emplace_back(&Executor::run, this);
+      placement.pin(threads.back());
+    }
+  }
+
+  ~Executor() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv.notify_all();
+    for (auto &t : threads) {
+      if (t.joinable())
+        t.join();
+    }
+  }
+
+  void post(ConveyorImpl *impl, bool write, bool foreground) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queues[foreground].push_back({impl, write, foreground});
+    }
+    cv.notify_one();
+  }
+
+  // Queues the job once 'delay' has passed.
+  void postAfter(ConveyorImpl *impl, bool write, bool foreground,
+                 Clock::duration delay) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      delayed.emplace(Clock::now() + delay, Job{impl, write, foreground});
+    }
+    cv.notify_one();
+  }
+
+  // Thread-Safety: Must be called under mutex.
+  bool takeJob(Job &job) {
+    auto now = Clock::now();
+    while (!delayed.empty() && delayed.begin()->first <= now) {
+      const Job &due = delayed.begin()->second;
+      queues[due.foreground].push_back(due);
+      delayed.erase(delayed.begin());
+    }
+    bool foreground = !queues[true].empty() &&
+                      (queues[false].empty() || foreground_run < kForegroundRun);
+    std::deque<Job> &queue = queues[foreground];
+    if (queue.empty())
+      return false;
+    foreground_run = foreground ? foreground_run + 1 : 0;
+    job = queue.front();
+    queue.pop_front();
+    return true;
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      Job job;
+      if (!takeJob(job)) {
+        if (stop && delayed.empty())
+          break; // stop, and nothing left to run
+        if (delayed.empty())
+          cv.wait(lock);
+        else
+          cv.wait_until(lock, delayed.begin()->first);
+        continue;
+      }
+      lock.unlock();
+      if (job.write)
+        job.impl->runWriteJob();
+      else
+        job.impl->runReadJob();
+      lock.lock();
+    }
+  }
+};
+
+void ConveyorImpl::scheduleWriteJob() {
+  if (!write_job_scheduled.exchange(true))
+    executor->post(this, true, false);
+}
+
+void ConveyorImpl::scheduleReadJob() {
+  if (!read_job_scheduled.exchange(true))
+    executor->post(this, false, foreground(read_worker_needs_fill.load()));
+}
+
+void ConveyorImpl::deferJob(bool write, bool foreground,
+                            RateLimiter::Clock::duration delay) {
+  executor->postAfter(this, write, foreground, delay);
+}
+
+// --- MEMORY BUDGET ---
+// Process-wide account of the ring capacity held by all conveyors. Initial
+// capacities are always granted; growth beyond them is charged here and,
+// once a limit is set, has to fit under it. Growth that does not fit first
+// reclaims capacity from colder conveyors: lowest memory_priority first,
+// then least recently active, never from one with a higher priority than
+// the conveyor asking.
+// Thread-Safety: Guarded by 'mutex'. Conveyors call in with their own locks
+// held; reclaim only try-locks them, so it never waits while holding this.
+struct MemoryBudget {
+  std::mutex mutex;
+  size_t limit = 0; // 0 = unlimited
+  size_t used = 0;
+  std::vector<ConveyorImpl *> members;
+
+  // Intentionally never destroyed: conveyors may outlive static destructors.
+  static MemoryBudget &shared() {
+    static MemoryBudget *budget = new MemoryBudget();
+    return *budget;
+  }
+
+  void join(ConveyorImpl *impl, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    members.push_back(impl);
+    impl->memory_tracked = true;
+    impl->memory_charged = bytes;
+    used += bytes;
+  }
+
+  void leave(ConveyorImpl *impl) {
+    std::lock_guard<std::mutex> lock(mutex);
+    members.erase(std::remove(members.begin(), members.end(), impl),
+                  members.end());
+    used -= impl->memory_charged;
+    impl->memory_charged = 0;
+    impl->memory_tracked = false;
+  }
+
+  // Charges 'bytes' of growth to 'self'. With 'force' it is charged even if
+  // reclaim could not make room. Returns whether it was charged.
+  bool charge(ConveyorImpl *self, size_t bytes, bool force) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!self->memory_tracked)
+      return true; // Shutting down
+    if (limit > 0 && used + bytes > limit)
+      reclaim(self, used + bytes - limit);
+    if (limit > 0 && used + bytes > limit && !force)
+      return false;
+    self->memory_charged += bytes;
+    used += bytes;
+    return true;
+  }
+
+  void release(ConveyorImpl *self, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!self->memory_tracked)
+      return;
+    self->memory_charged -= bytes;
+    used -= bytes;
+  }
+
+  void setLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    limit = bytes;
+    if (limit > 0 && used > limit)
+      reclaim(nullptr, used - limit);
+  }
+
+private:
+  // Takes up to 'want' bytes back from conveyors other than 'self' (any
+  // conveyor when self is null), coldest first.
+  // Thread-Safety: Must be called under mutex.
+  void reclaim(ConveyorImpl *self, size_t want) {
+    std::vector<ConveyorImpl *> victims;
+    for (ConveyorImpl *m : members) {
+      if (m != self && (!self || m->memory_priority <= self->memory_priority))
+        victims.push_back(m);
+    }
+    std::sort(victims.begin(), victims.end(),
+              [](const ConveyorImpl *a, const ConveyorImpl *b) {
+                if (a->memory_priority != b->memory_priority)
+                  return a->memory_priority < b->memory_priority;
+                return a->last_active_ns.load(std::memory_order_relaxed) <
+                       b->last_active_ns.load(std::memory_order_relaxed);
+              });
+    size_t freed = 0;
+    for (ConveyorImpl *v : victims) {
+      if (freed >= want)
+        break;
+      size_t n = v->reclaimMemory();
+      v->memory_charged -= n;
+      freed += n;
+    }
+    used -= freed;
+  }
+};
+
+bool ConveyorImpl::chargeMemory(size_t bytes, bool force) {
+  return MemoryBudget::shared().charge(this, bytes, force);
+}
+
+void ConveyorImpl::releaseMemory(size_t bytes) {
+  MemoryBudget::shared().release(this, bytes);
+}
+} // namespace libconveyor
+
+conveyor_executor_t *conveyor_executor_create(size_t num_threads) {
+  if (num_threads == 0) {
+    errno = EINVAL;
+    return nullptr;
+  }
+  return reinterpret_cast<conveyor_executor_t *>(
+      new libconveyor::Executor(num_threads));
+}
+
+conveyor_executor_t *
+conveyor_executor_create_placed(size_t num_threads,
+                                const conveyor_placement_t *placement) {
+  libconveyor::Placement where;
+  if (num_threads == 0) {
+    errno = EINVAL;
+    return nullptr;
+  }
+  if (!where.resolve(placement))
+    return nullptr;
+  return reinterpret_cast<conveyor_executor_t *>(
+      new libconveyor::Executor(num_threads, where));
+}
+
+void conveyor_executor_destroy(conveyor_executor_t *executor) {
+  delete reinterpret_cast<libconveyor::Executor *>(executor);
+}
+
+void conveyor_set_memory_budget(size_t bytes) {
+  libconveyor::MemoryBudget::shared().setLimit(bytes);
+}
+
+void conveyor_set_rate_limit(const conveyor_rate_limit_t *limit) {
+  libconveyor::RateLimiter::shared().set(limit);
+}
+
+size_t conveyor_memory_in_use(void) {
+  auto &budget = libconveyor::MemoryBudget::shared();
+  std::lock_guard<std::mutex> lock(budget.mutex);
+  return budget.used;
+}
+
+conveyor_executor_t *conveyor_executor_default(void) {
+  // Intentionally never destroyed: conveyors may outlive static destructors.
+  static libconveyor::Executor *shared = [] {
+    size_t n = std::thread::hardware_concurrency();
+    return new libconveyor::Executor(n > 0 ? n : 4);
+  }();
+  return reinterpret_cast<conveyor_executor_t *>(shared);
+}
+
+conveyor_t *conveyor_create(const conveyor_config_t *cfg) {
+  if (!cfg) {
+    errno = EINVAL;
+    return nullptr;
+  }
+  if (!cfg->codec.compress != !cfg->codec.decompress) {
+    errno = EINVAL;
+    return nullptr;
+  }
+  size_t direct = cfg->direct_io_block_size;
+  if (direct > 0 && !libconveyor::DirectIoStorage::valid_block_size(direct)) {
+    errno = EINVAL;
+    return nullptr;
+  }
+  // Under direct I/O, rings of whole blocks keep ring positions congruent
+  // to file offsets across wrap-around, so aligned streams stay aligned.
+  auto whole_blocks = [direct](size_t n) {
+    return direct > 0 ? (n + direct - 1) / direct * direct : n;
+  };
+  size_t initial_write = whole_blocks(cfg->initial_write_size);
+  size_t initial_read = whole_blocks(cfg->initial_read_size);
+  size_t max_write = whole_blocks(
+      (cfg->max_write_size > 0) ? cfg->max_write_size : cfg->initial_write_size);
+  size_t max_read = whole_blocks(
+      (cfg->max_read_size > 0) ? cfg->max_read_size : cfg->initial_read_size);
+  int mode = cfg->flags & O_ACCMODE;
+  bool read_mapped = cfg->ops.map && !cfg->codec.compress && direct == 0 &&
+                     (mode == O_RDONLY || mode == O_RDWR) &&
+                     (cfg->initial_read_size > 0);
+  libconveyor::Placement where;
+  if (!where.resolve(&cfg->placement))
+    return nullptr;
+  auto *impl = new libconveyor::ConveyorImpl(
+      initial_write, read_mapped ? 0 : initial_read, max_write,
+      read_mapped ? 0 : max_read, cfg->huge_pages != 0, where);
+  impl->read_mapped = read_mapped;
+  impl->read_advise_window = read_mapped ? max_read : 0;
+  impl->handle = cfg->handle;
+  impl->flags = cfg->flags;
+  impl->ops = cfg->ops;
+  if (direct > 0) {
+    impl->direct_storage.reset(
+        new libconveyor::DirectIoStorage(impl->handle, impl->ops, direct));
+    if (!impl->direct_storage->open()) {
+      int err = errno;
+      delete impl;
+      errno = err;
+      return nullptr;
+    }
+    impl->handle = impl->direct_storage.get();
+    impl->ops = impl->direct_storage->ops();
+    impl->direct_io_block = direct;
+  }
+  if (cfg->codec.compress) {
+    impl->codec_storage.reset(new libconveyor::BlockCodecStorage(
+        impl->handle, impl->ops, cfg->codec, cfg->codec_block_size));
+    if (!impl->codec_storage->open()) {
+      int err = errno;
+      delete impl;
+      errno = err;
+      return nullptr;
+    }
+    impl->handle = impl->codec_storage.get();
+    impl->ops = impl->codec_storage->ops();
+  }
+  impl->max_coalesce_size = cfg->max_coalesce_size;
+  impl->write_queue_depth =
+      (cfg->write_queue_depth > 0) ? cfg->write_queue_depth : 1;
+  impl->read_chunk_size = whole_blocks(cfg->read_chunk_size);
+  impl->read_ahead_depth =
+      (cfg->read_ahead_depth > 0) ? cfg->read_ahead_depth : 1;
+  // Under O_APPEND a request's offset is only resolved when it is issued,
+  // so a later write never covers an earlier one.
+  impl->write_absorb = cfg->write_absorb && !(cfg->flags & O_APPEND);
+  impl->executor = reinterpret_cast<libconveyor::Executor *>(cfg->executor);
+  impl->memory_priority = cfg->memory_priority;
+  impl->rate_limiter.set(&cfg->rate_limit);
+  impl->background_qos = cfg->qos_class == CONVEYOR_QOS_BACKGROUND;
+  impl->idle_shrink = std::chrono::milliseconds(cfg->idle_shrink_ms);
+  impl->write_backpressure = cfg->write_backpressure;
+  if (cfg->write_timeout_ms > 0)
+    impl->write_timeout = std::chrono::milliseconds(cfg->write_timeout_ms);
+  impl->writable_callback = cfg->writable_callback;
+  impl->writable_context = cfg->writable_context;
+#ifndef LIBCONVEYOR_NO_TRACING
+  impl->trace_callback = cfg->trace_callback;
+  impl->trace_context = cfg->trace_context;
+  if (cfg->trace_log_events > 0)
+    impl->trace_log.reset(new libconveyor::TraceLog(cfg->trace_log_events));
+  impl->tracing = impl->trace_callback || impl->trace_log;
+#endif
+  impl->markActive();
+  if (cfg->single_producer && !cfg->journal_path) {
+    impl->staged_writes.reset(
+        new libconveyor::SpscQueue<libconveyor::WriteRequest>(
+            libconveyor::ConveyorImpl::kStagedWriteSlots));
+  }
+
+  impl->read_buffer_enabled = (mode == O_RDONLY || mode == O_RDWR) &&
+                              (cfg->initial_read_size > 0) && !read_mapped;
+  impl->write_buffer_enabled =
+      (mode == O_WRONLY || mode == O_RDWR) && (cfg->initial_write_size > 0);
+  if (cfg->journal_path) {
+    // An append only gets its offset when it is issued, and replaying one
+    // at the end of the file would not be idempotent, so O_APPEND is out.
+    size_t size = cfg->journal_size > 0 ? cfg->journal_size : 2 * max_write;
+    if (!impl->write_buffer_enabled || (cfg->flags & O_APPEND) ||
+        size < max_write + libconveyor::WriteJournal::kRecordHeader) {
+      delete impl;
+      errno = EINVAL;
+      return nullptr;
+    }
+    if (!impl->journal.open(cfg->journal_path, size, !cfg->journal_no_sync)) {
+      int err = errno;
+      delete impl;
+      errno = err;
+      return nullptr;
+    }
+  }
+  impl->initial_write_capacity = impl->write_ring_buffer.capacity;
+  impl->initial_read_capacity = impl->read_buffer.capacity;
+  libconveyor::MemoryBudget::shared().join(
+      impl, (impl->write_buffer_enabled ? impl->initial_write_capacity : 0) +
+                (impl->read_buffer_enabled ? impl->initial_read_capacity : 0));
+
+  if (impl->write_buffer_enabled) {
+    if (impl->flags & O_APPEND) {
+      off_t sz = impl->ops.lseek(impl->handle, 0, SEEK_END);
+      if (sz == LIBCONVEYOR_ERROR) {
+        conveyor_destroy(reinterpret_cast<conveyor_t *>(impl));
+        return nullptr;
+      }
+      impl->logical_write_offset = sz;
+      impl->current_file_offset = sz;
+    }
+    if (impl->executor) {
+      // Jobs are posted on demand.
+    } else if (impl->asyncOps()) {
+      impl->write_worker_threads.emplace_back(
+          &libconveyor::ConveyorImpl::asyncWriteWorker, impl);
+    } else {
+      for (size_t i = 0; i < impl->write_queue_depth; ++i) {
+        impl->write_worker_threads.emplace_back(
+            &libconveyor::ConveyorImpl::writeWorker, impl);
+      }
+    }
+  }
+  if (impl->read_buffer_enabled) {
+    impl->read_head_in_storage = impl->current_file_offset.load();
+    if (cfg->read_cache_block_size > 0) {
+      impl->read_cache = libconveyor::BlockCache(cfg->read_cache_block_size,
+                                                 impl->max_read_capacity);
+    }
+    if (impl->executor) {
+      // Jobs are posted on demand.
+    } else if (impl->asyncOps()) {
+      impl->read_worker_threads.emplace_back(
+          &libconveyor::ConveyorImpl::asyncReadWorker, impl);
+    } else {
+      for (size_t i = 0; i < impl->read_ahead_depth; ++i) {
+        impl->read_worker_threads.emplace_back(
+            &libconveyor::ConveyorImpl::readWorker, impl);
+      }
+    }
+    std::unique_lock<std::mutex> lock(impl->read_mutex);
+    impl->read_worker_needs_fill = true;
+    impl->wakeReadWorkers();
+  }
+  for (auto &t : impl->write_worker_threads)
+    impl->placement.pin(t);
+  for (auto &t : impl->read_worker_threads)
+    impl->placement.pin(t);
+  return reinterpret_cast<conveyor_t *>(impl);
+}
+
+ssize_t conveyor_recover(const conveyor_config_t *cfg) {
+  // Journal mode excludes O_APPEND, so every record has a real offset.
+  if (!cfg || !cfg->journal_path || (cfg->flags & O_APPEND)) {
+    errno = EINVAL;
+    return LIBCONVEYOR_ERROR;
+  }
+  libconveyor::WriteJournal journal;
+  if (!journal.load(cfg->journal_path))
+    return errno == ENOENT ? 0 : LIBCONVEYOR_ERROR;
+  size_t pending = journal.pending();
+  if (pending == 0)
+    return 0;
+
+  conveyor_config_t replay = *cfg;
+  replay.journal_path = nullptr;
+  replay.flags = (cfg->flags & ~O_ACCMODE) | O_WRONLY;
+  conveyor_t *conv = conveyor_create(&replay);
+  if (!conv)
+    return LIBCONVEYOR_ERROR;
+  bool ok = journal.for_each([&](off_t offset, const char *data, size_t len) {
+    return conveyor_pwrite(conv, data, len, offset) == static_cast<ssize_t>(len);
+  });
+  if (ok)
+    ok = (cfg->ops.fsync ? conveyor_fsync(conv) : conveyor_flush(conv)) == 0;
+  int err = errno;
+  conveyor_destroy(conv);
+  if (!ok) {
+    errno = err;
+    return LIBCONVEYOR_ERROR;
+  }
+  journal.clear();
+  return static_cast<ssize_t>(pending);
 }
 
 void conveyor_destroy(conveyor_t *conv) {
   if (!conv)
     return;
   auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  // First, so reclaim never reaches a conveyor that is shutting down.
+  libconveyor::MemoryBudget::shared().leave(impl);
   if (impl->write_buffer_enabled)
     conveyor_flush(conv);
   if (impl->read_buffer_enabled) {
     impl->read_worker_stop_flag = true;
     impl->read_cv_producer.notify_all();
     impl->read_cv_consumer.notify_all();
-    if (impl->read_worker_thread.joinable())
-      impl->read_worker_thread.join();
+    for (auto &t : impl->read_worker_threads) {
+      if (t.joinable())
+        t.join();
+    }
+    if (impl->executor) {
+      std::unique_lock<std::mutex> lock(impl->read_mutex);
+      impl->read_cv_consumer.wait(
+          lock, [&] { return !impl->read_job_scheduled.load(); });
+    }
   }
   if (impl->write_buffer_enabled) {
     impl->write_worker_stop_flag = true;
     impl->write_cv_producer.notify_all();
     impl->write_cv_consumer.notify_all();
-    if (impl->write_worker_thread.joinable())
-      impl->write_worker_thread.join();
+    for (auto &t : impl->write_worker_threads) {
+      if (t.joinable())
+        t.join();
+    }
+    if (impl->executor) {
+      std::unique_lock<std::mutex> lock(impl->write_mutex);
+      impl->write_cv_producer.wait(
+          lock, [&] { return !impl->write_job_scheduled.load(); });
+    }
+  }
+  {
+    // Every barrier has passed by now; make sure each was called back.
+    std::unique_lock<std::mutex> lock(impl->write_mutex);
+    impl->write_cv_producer.wait(lock, [&] { return !impl->barrier_firing; });
+    impl->collectPassedBarriers();
+    impl->fireBarriers(lock);
+  }
+  delete impl;
+}
+
+namespace {
+
+// Writes a gather list straight to storage (no write buffer), stopping at
+// the first short write.
+ssize_t writeDirect(libconveyor::ConveyorImpl *impl, const conveyor_iovec_t *iov,
+                    int iovcnt, off_t offset) {
+  if (impl->ops.pwritev)
+    return impl->ops.pwritev(impl->handle, iov, iovcnt, offset);
+  size_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    ssize_t n = impl->ops.pwrite(impl->handle, iov[i].iov_base, iov[i].iov_len,
+                                 offset + static_cast<off_t>(total));
+    if (n < 0)
+      return total > 0 ? static_cast<ssize_t>(total) : n;
+    total += static_cast<size_t>(n);
+    if (static_cast<size_t>(n) < iov[i].iov_len)
+      break;
+  }
+  return static_cast<ssize_t>(total);
+}
+
+// Shared by conveyor_write, conveyor_pwrite and conveyor_writev: 'count'
+// bytes gathered from 'iov' become one request. A positional write goes to
+// 'offset' and leaves the file position alone; otherwise it goes to the
+// current position and advances it.
+ssize_t writeAt(libconveyor::ConveyorImpl *impl, const conveyor_iovec_t *iov,
+                int iovcnt, size_t count, bool positional, off_t offset) {
+  int mode = impl->flags & O_ACCMODE;
+  if (mode != O_WRONLY && mode != O_RDWR) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+
+  if (count > impl->max_write_capacity) {
+    if (impl->write_backpressure != CONVEYOR_BACKPRESSURE_PARTIAL ||
+        !impl->write_buffer_enabled) {
+      errno = EMSGSIZE;
+      return LIBCONVEYOR_ERROR;
+    }
+    count = impl->max_write_capacity; // The rest is for the next call
+  }
+  int64_t started = impl->markActive();
+
+  if (!impl->write_buffer_enabled) {
+    impl->throttle(count, impl->foreground(true));
+    ssize_t n = writeDirect(impl, iov, iovcnt,
+                            positional ? offset
+                                       : impl->current_file_offset.load());
+    if (n >= 0)
+      impl->recordSince(impl->latency.write_call, started);
+    return n;
+  }
+
+  if (impl->stats.last_error_code.load() != 0) {
+    errno = impl->stats.last_error_code.load();
+    return LIBCONVEYOR_ERROR;
+  }
+
+  if (impl->staged_writes &&
+      impl->tryStageWrite(iov, iovcnt, count,
+                          positional ? offset
+                                     : impl->current_file_offset.load(
+                                           std::memory_order_relaxed))) {
+    if (!positional)
+      impl->current_file_offset.fetch_add(count, std::memory_order_relaxed);
+    impl->stats.bytes_written.fetch_add(count, std::memory_order_relaxed);
+    impl->recordSince(impl->latency.write_call, started);
+    return count;
+  }
+
+  std::unique_lock<std::mutex> lock(impl->write_mutex);
+  if (!impl->acquireWriteSpace(lock, count))
+    return LIBCONVEYOR_ERROR;
+
+  impl->gatherIntoRing(impl->write_ring_buffer.head, iov, iovcnt, count);
+  impl->queueHeadWrite(
+      positional ? offset : impl->current_file_offset.fetch_add(count), count);
+  lock.unlock();
+  impl->recordSince(impl->latency.write_call, started);
+  return count;
+}
+
+} // namespace
+
+ssize_t conveyor_write(conveyor_t *conv, const void *buf, size_t count) {
+  if (!conv) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  conveyor_iovec_t iov = {const_cast<void *>(buf), count};
+  return writeAt(reinterpret_cast<libconveyor::ConveyorImpl *>(conv), &iov, 1,
+                 count, false, 0);
+}
+
+ssize_t conveyor_pwrite(conveyor_t *conv, const void *buf, size_t count,
+                        off_t offset) {
+  if (!conv) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  if (offset < 0) {
+    errno = EINVAL;
+    return LIBCONVEYOR_ERROR;
+  }
+  conveyor_iovec_t iov = {const_cast<void *>(buf), count};
+  return writeAt(reinterpret_cast<libconveyor::ConveyorImpl *>(conv), &iov, 1,
+                 count, true, offset);
+}
+
+namespace {
+
+// Validates a gather/scatter list and totals it. Returns false (EINVAL) on
+// a negative count, a missing array or a total that overflows ssize_t.
+bool totalIovec(const conveyor_iovec_t *iov, int iovcnt, size_t &total) {
+  total = 0;
+  if (iovcnt < 0 || (iovcnt > 0 && !iov)) {
+    errno = EINVAL;
+    return false;
+  }
+  for (int i = 0; i < iovcnt; ++i) {
+    if (iov[i].iov_len > static_cast<size_t>(std::numeric_limits<ssize_t>::max()) - total) {
+      errno = EINVAL;
+      return false;
+    }
+    total += iov[i].iov_len;
+  }
+  return true;
+}
+
+} // namespace
+
+ssize_t conveyor_writev(conveyor_t *conv, const conveyor_iovec_t *iov,
+                        int iovcnt) {
+  if (!conv) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  size_t count;
+  if (!totalIovec(iov, iovcnt, count))
+    return LIBCONVEYOR_ERROR;
+  return writeAt(reinterpret_cast<libconveyor::ConveyorImpl *>(conv), iov,
+                 iovcnt, count, false, 0);
+}
+
+namespace {
+
+// The order conveyor_submit_batch queues its entries in: by offset when no
+// two overlap, so neighbours coalesce, and as given otherwise, so a later
+// entry still wins. Under O_APPEND offsets do not matter and neither does
+// sorting.
+std::vector<size_t> batchOrder(const conveyor_io_t *ios, size_t n,
+                               bool append) {
+  std::vector<size_t> order(n);
+  for (size_t i = 0; i < n; ++i)
+    order[i] = i;
+  if (append)
+    return order;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return ios[a].offset < ios[b].offset;
+  });
+  off_t end = 0;
+  for (size_t i : order) {
+    if (ios[i].len == 0)
+      continue;
+    if (ios[i].offset < end) {
+      for (size_t j = 0; j < n; ++j)
+        order[j] = j;
+      return order;
+    }
+    end = ios[i].offset + static_cast<off_t>(ios[i].len);
+  }
+  return order;
+}
+
+// Validates one batch entry and marks it as not yet queued. Returns false
+// (with the entry failed) for one conveyor_pwrite would refuse outright.
+bool checkBatchEntry(libconveyor::ConveyorImpl *impl, conveyor_io_t &io) {
+  io.result = LIBCONVEYOR_ERROR;
+  io.error = 0;
+  if (io.offset < 0 || (io.len > 0 && !io.buf))
+    io.error = EINVAL;
+  else if (io.len > impl->max_write_capacity)
+    io.error = EMSGSIZE;
+  return io.error == 0;
+}
+
+// Writes a batch straight to storage when there is no write buffer.
+size_t submitBatchDirect(libconveyor::ConveyorImpl *impl, conveyor_io_t *ios,
+                         const std::vector<size_t> &order, int &error) {
+  size_t queued = 0;
+  for (size_t i : order) {
+    conveyor_io_t &io = ios[i];
+    if (io.error != 0)
+      continue;
+    impl->throttle(io.len, impl->foreground(true));
+    conveyor_iovec_t iov = {const_cast<void *>(io.buf), io.len};
+    ssize_t n = writeDirect(impl, &iov, 1, io.offset);
+    if (n == static_cast<ssize_t>(io.len)) {
+      io.result = n;
+      queued++;
+    } else {
+      io.error = (n < 0) ? errno : EIO;
+      if (error == 0)
+        error = io.error;
+    }
+  }
+  return queued;
+}
+
+// Queues a batch into the write ring: as many entries at a time as the
+// ring can take, each group behind one acquireWriteSpace. The workers are
+// woken once the whole group is in, so they plan over all of it. The
+// first failure fails every entry not yet queued.
+size_t submitBatchBuffered(libconveyor::ConveyorImpl *impl, conveyor_io_t *ios,
+                           const std::vector<size_t> &order, int &error) {
+  size_t queued = 0;
+  std::unique_lock<std::mutex> lock(impl->write_mutex);
+  size_t next = 0;
+  while (next < order.size() && error == 0) {
+    size_t total = 0, end = next;
+    for (; end < order.size(); ++end) {
+      const conveyor_io_t &io = ios[order[end]];
+      if (io.error != 0)
+        continue;
+      if (total + io.len > impl->max_write_capacity ||
+          (impl->journal.is_open() && end > next))
+        break; // The journal's room is only known one record at a time
+      total += io.len;
+    }
+    size_t room = total;
+    errno = 0;
+    if (total > 0 && !impl->acquireWriteSpace(lock, room)) {
+      error = errno ? errno : EBADF;
+      break;
+    }
+    // CONVEYOR_BACKPRESSURE_PARTIAL may leave room for only some of them.
+    for (; next < end; ++next) {
+      conveyor_io_t &io = ios[order[next]];
+      if (io.error != 0)
+        continue;
+      if (io.len > room) {
+        error = EAGAIN;
+        break;
+      }
+      conveyor_iovec_t iov = {const_cast<void *>(io.buf), io.len};
+      impl->gatherIntoRing(impl->write_ring_buffer.head, &iov, 1, io.len);
+      if (io.len > 0)
+        impl->commitHeadWrite(io.offset, io.len);
+      room -= io.len;
+      io.result = static_cast<ssize_t>(io.len);
+      queued++;
+    }
+    impl->wakeWriteWorkers();
+  }
+  for (; next < order.size(); ++next) {
+    conveyor_io_t &io = ios[order[next]];
+    if (io.error == 0 && io.result == LIBCONVEYOR_ERROR)
+      io.error = error;
+  }
+  return queued;
+}
+
+} // namespace
+
+ssize_t conveyor_submit_batch(conveyor_t *conv, conveyor_io_t *ios, size_t n) {
+  if (!conv) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  if (n > 0 && !ios) {
+    errno = EINVAL;
+    return LIBCONVEYOR_ERROR;
+  }
+  auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  int mode = impl->flags & O_ACCMODE;
+  int refused = 0;
+  if (mode != O_WRONLY && mode != O_RDWR)
+    refused = EBADF;
+  else if (impl->write_buffer_enabled)
+    refused = impl->stats.last_error_code.load();
+  int error = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (!checkBatchEntry(impl, ios[i]) && error == 0)
+      error = ios[i].error;
+    if (refused != 0)
+      ios[i].error = refused;
+  }
+  if (refused != 0) {
+    errno = refused;
+    return LIBCONVEYOR_ERROR;
+  }
+  int64_t started = impl->markActive();
+
+  std::vector<size_t> order = batchOrder(ios, n, impl->flags & O_APPEND);
+  int failed = 0;
+  size_t queued = impl->write_buffer_enabled
+                      ? submitBatchBuffered(impl, ios, order, failed)
+                      : submitBatchDirect(impl, ios, order, failed);
+  impl->recordSince(impl->latency.write_call, started);
+  if (queued < n) {
+    errno = failed ? failed : error;
+    if (queued == 0)
+      return LIBCONVEYOR_ERROR;
+  }
+  return static_cast<ssize_t>(queued);
+}
+
+ssize_t conveyor_write_reserve(conveyor_t *conv, size_t count,
+                               conveyor_iovec_t segs[2], int *nsegs) {
+  if (!conv) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  if (!segs || !nsegs || count == 0) {
+    errno = EINVAL;
+    return LIBCONVEYOR_ERROR;
+  }
+  auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  if (!impl->write_buffer_enabled) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  if (count > impl->max_write_capacity) {
+    errno = EMSGSIZE;
+    return LIBCONVEYOR_ERROR;
+  }
+  if (impl->stats.last_error_code.load() != 0) {
+    errno = impl->stats.last_error_code.load();
+    return LIBCONVEYOR_ERROR;
+  }
+  impl->markActive();
+
+  std::unique_lock<std::mutex> lock(impl->write_mutex);
+  if (!impl->acquireWriteSpace(lock, count))
+    return LIBCONVEYOR_ERROR;
+
+  libconveyor::RingSegment ring_segs[2];
+  size_t n = impl->write_ring_buffer.segments_at(impl->write_ring_buffer.head,
+                                                 count, ring_segs);
+  for (size_t i = 0; i < n; ++i) {
+    segs[i].iov_base = ring_segs[i].data;
+    segs[i].iov_len = ring_segs[i].len;
   }
-  delete impl;
+  *nsegs = static_cast<int>(n);
+  impl->write_reserved_len = count;
+  impl->write_reservation_active = true;
+  return count;
 }
 
-ssize_t conveyor_write(conveyor_t *conv, const void *buf, size_t count) {
+ssize_t conveyor_write_commit(conveyor_t *conv, size_t count) {
   if (!conv) {
     errno = EBADF;
     return LIBCONVEYOR_ERROR;
   }
   auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
-  int mode = impl->flags & O_ACCMODE;
-  if (mode != O_WRONLY && mode != O_RDWR) {
-    errno = EBADF;
+  std::unique_lock<std::mutex> lock(impl->write_mutex);
+  if (!impl->write_reservation_active.load() ||
+      count > impl->write_reserved_len) {
+    errno = EINVAL;
     return LIBCONVEYOR_ERROR;
   }
+  impl->write_reservation_active = false;
+  impl->write_reserved_len = 0;
+  impl->write_cv_producer.notify_all();
+  impl->notifyWritable();
 
-  if (count > impl->max_write_capacity) {
-    errno = EMSGSIZE;
+  if (impl->stats.last_error_code.load() != 0) {
+    errno = impl->stats.last_error_code.load();
     return LIBCONVEYOR_ERROR;
   }
+  if (count > 0)
+    impl->queueHeadWrite(impl->current_file_offset.fetch_add(count), count);
+  return count;
+}
 
-  if (!impl->write_buffer_enabled) {
-    return impl->ops.pwrite(impl->handle, buf, count,
-                            impl->current_file_offset.load());
+namespace {
+
+// Shared by conveyor_read and conveyor_readv: fills 'iov' in order from the
+// current position under one read_mutex acquisition, stopping at the first
+// segment that comes up short, then patches in pending writes.
+// Reads [offset, offset + count) from the buffers or storage with pending
+// writes applied, consistently with writes that retire meanwhile.
+ssize_t readConsistent(libconveyor::ConveyorImpl *impl, off_t offset,
+                       char *ptr, size_t count, bool &hit) {
+  uint64_t retired =
+      impl->write_batches_retired.load(std::memory_order_acquire);
+  ssize_t total_read = impl->readAt(offset, ptr, count, retired, hit);
+  if (total_read == LIBCONVEYOR_ERROR)
+    return LIBCONVEYOR_ERROR;
+
+  // Entries pending when we started are either still pending (and within
+  // the pending range) or have been counted as retired.
+  if (impl->write_buffer_enabled &&
+      (impl->hasStagedWrites() || impl->mayOverlapPending(offset, count) ||
+       impl->write_batches_retired.load(std::memory_order_acquire) !=
+           retired)) {
+    std::unique_lock<std::mutex> write_lock(impl->write_mutex);
+    impl->drainStagedWrites();
+    if (impl->write_batches_retired.load(std::memory_order_acquire) !=
+        retired) {
+      // A write reached storage after we started, possibly after our read
+      // of that range and before its entry could be snooped below. Nothing
+      // retires while we hold write_mutex, so a second read is consistent.
+      total_read = impl->readAt(offset, ptr, count,
+                                impl->write_batches_retired.load(), hit);
+      if (total_read == LIBCONVEYOR_ERROR)
+        return LIBCONVEYOR_ERROR;
+    }
+    size_t bytes_covered = impl->snoopPendingWrites(offset, count, ptr);
+    if (bytes_covered > static_cast<size_t>(total_read))
+      total_read = bytes_covered;
+  }
+  return total_read;
+}
+
+// conveyor_read for mapped storage: each segment is copied from the mapping
+// as conveyor_pread would copy it. read_mutex is only held to check for a
+// view and advise, since readConsistent may take write_mutex.
+ssize_t readMapped(libconveyor::ConveyorImpl *impl, const conveyor_iovec_t *iov,
+                   int iovcnt, size_t count) {
+  int64_t started = impl->markActive();
+  off_t start_offset = impl->current_file_offset.load();
+  {
+    std::lock_guard<std::mutex> read_lock(impl->read_mutex);
+    if (impl->read_view_active) {
+      errno = EBUSY;
+      return LIBCONVEYOR_ERROR;
+    }
+    impl->adviseReadAhead(start_offset, count);
   }
 
+  size_t total_read = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    bool hit = true;
+    ssize_t n = readConsistent(
+        impl, start_offset + static_cast<off_t>(total_read),
+        static_cast<char *>(iov[i].iov_base), iov[i].iov_len, hit);
+    if (n == LIBCONVEYOR_ERROR) {
+      if (total_read == 0)
+        return LIBCONVEYOR_ERROR;
+      break;
+    }
+    total_read += static_cast<size_t>(n);
+    if (static_cast<size_t>(n) < iov[i].iov_len)
+      break;
+  }
+
+  impl->current_file_offset = start_offset + static_cast<off_t>(total_read);
+  impl->stats.bytes_read += total_read;
+  impl->recordSince(impl->latency.read_call, started);
+  return static_cast<ssize_t>(total_read);
+}
+
+ssize_t readSegments(libconveyor::ConveyorImpl *impl,
+                     const conveyor_iovec_t *iov, int iovcnt, size_t count) {
+  if (!impl->read_buffer_enabled && !impl->read_mapped) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
   if (impl->stats.last_error_code.load() != 0) {
     errno = impl->stats.last_error_code.load();
     return LIBCONVEYOR_ERROR;
   }
+  if (impl->read_mapped)
+    return readMapped(impl, iov, iovcnt, count);
 
-  std::unique_lock<std::mutex> lock(impl->write_mutex);
+  int64_t started = impl->markActive();
 
-  // --- ADAPTIVE WRITE: Grow on Pressure ---
-  if (impl->write_ring_buffer.available_space() < count) {
-    if (impl->write_ring_buffer.capacity < impl->max_write_capacity) {
-      // FLUSH LOGIC
-      if (!impl->write_queue.empty()) {
-        impl->write_buffer_needs_flush = true;
-        impl->write_cv_consumer.notify_one();
-        impl->write_cv_producer.wait(lock, [&] {
-          return impl->write_queue.empty() || impl->write_worker_stop_flag;
-        });
-      }
-      impl->write_buffer_needs_flush = false;
+  off_t start_offset = impl->current_file_offset.load();
+  ssize_t total_read = 0;
+  uint64_t retired =
+      impl->write_batches_retired.load(std::memory_order_acquire);
+
+  {
+    std::unique_lock<std::mutex> read_lock(impl->read_mutex);
+    if (impl->read_view_active) {
+      errno = EBUSY;
+      return LIBCONVEYOR_ERROR;
+    }
+
+    impl->adaptReadBuffer(start_offset, count);
 
-      size_t needed = impl->write_ring_buffer.size + count;
-      size_t new_cap = impl->write_ring_buffer.capacity * 2;
-      if (new_cap < needed)
-        new_cap = needed;
-      if (new_cap > impl->max_write_capacity)
-        new_cap = impl->max_write_capacity;
+    bool hit = true;
+    for (int i = 0; i < iovcnt; ++i) {
+      char *ptr = static_cast<char *>(iov[i].iov_base);
+      size_t want = iov[i].iov_len;
+      size_t got = 0;
+      if (impl->read_cache.enabled()) {
+        got = impl->readCached(read_lock, start_offset + total_read, ptr, want,
+                               hit);
+      } else {
+        while (got < want && !impl->read_worker_stop_flag.load()) {
+          if (impl->read_buffer.empty() && !impl->read_eof_flag.load())
+            hit = false;
+          if (!impl->waitForReadData(read_lock))
+            break;
+          got += impl->read_buffer.read(ptr + got, want - got);
+          impl->wakeReadWorkers();
+        }
+      }
+      total_read += got;
+      if (got < want)
+        break;
+    }
+    impl->observeRead(start_offset, count, hit);
+    if (total_read == 0 && impl->stats.last_error_code.load() != 0) {
+      errno = impl->stats.last_error_code.load();
+      return LIBCONVEYOR_ERROR;
+    }
+  }
 
-      if (new_cap >= needed)
-        impl->write_ring_buffer.resize(new_cap);
+  if (impl->write_buffer_enabled &&
+      (impl->hasStagedWrites() ||
+       impl->mayOverlapPending(start_offset, count) ||
+       impl->write_batches_retired.load(std::memory_order_acquire) !=
+           retired)) {
+    std::unique_lock<std::mutex> write_lock(impl->write_mutex);
+    impl->drainStagedWrites();
+    if (impl->write_batches_retired.load(std::memory_order_acquire) !=
+        retired) {
+      // As in readConsistent: a write may have reached storage after we
+      // copied its range out of the read buffer and before we could snoop
+      // it. Nothing retires while we hold write_mutex, so storage has it.
+      size_t seg_start = 0;
+      for (int i = 0; i < iovcnt && seg_start < static_cast<size_t>(total_read);
+           ++i) {
+        size_t len = std::min(iov[i].iov_len,
+                              static_cast<size_t>(total_read) - seg_start);
+        if (impl->readStorage(start_offset + static_cast<off_t>(seg_start),
+                              static_cast<char *>(iov[i].iov_base),
+                              len) == LIBCONVEYOR_ERROR) {
+          // The bytes are consumed from the read buffer already.
+          int err = errno;
+          impl->recordError(err);
+          impl->current_file_offset = start_offset + total_read;
+          errno = err;
+          return LIBCONVEYOR_ERROR;
+        }
+        seg_start += iov[i].iov_len;
+      }
+    }
+    size_t seg_start = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+      size_t covered = impl->snoopPendingWrites(
+          start_offset + static_cast<off_t>(seg_start), iov[i].iov_len,
+          static_cast<char *>(iov[i].iov_base));
+      if (seg_start + covered > static_cast<size_t>(total_read))
+        total_read = seg_start + covered;
+      seg_start += iov[i].iov_len;
     }
   }
-  // ----------------------------------------
 
-  if (impl->write_ring_buffer.available_space() < count)
-    impl->stats.write_buffer_full_events++;
+  impl->current_file_offset = start_offset + total_read;
+  impl->stats.bytes_read += total_read;
+  impl->recordSince(impl->latency.read_call, started);
+  return total_read;
+}
 
-  if (!impl->write_cv_producer.wait_for(lock, std::chrono::seconds(30), [&] {
-        return (impl->write_ring_buffer.available_space() >= count) ||
-               impl->write_worker_stop_flag;
-      })) {
-    errno = ETIMEDOUT;
+// conveyor_read_acquire for mapped storage. Bytes with writes still pending
+// (which may lie past the end of the mapping) cannot be patched in place, so
+// those are lent from a private copy of at most read_advise_window bytes.
+ssize_t acquireMapped(libconveyor::ConveyorImpl *impl, size_t max_len,
+                      conveyor_iovec_t segs[2], int *nsegs) {
+  off_t start_offset = impl->current_file_offset.load();
+  std::unique_lock<std::mutex> read_lock(impl->read_mutex);
+  if (impl->read_view_active) {
+    errno = EBUSY;
+    return LIBCONVEYOR_ERROR;
+  }
+  impl->adviseReadAhead(start_offset, max_len);
+  const void *data = nullptr;
+  ssize_t len = impl->ops.map(impl->handle, start_offset, max_len, &data);
+  if (len == LIBCONVEYOR_ERROR)
     return LIBCONVEYOR_ERROR;
+  bool pending = impl->write_buffer_enabled &&
+                 (impl->hasStagedWrites() ||
+                  impl->mayOverlapPending(start_offset, max_len));
+  if (len == 0 && !pending)
+    return 0;
+  impl->read_view_active = true;
+  impl->read_view_len = static_cast<size_t>(len);
+  read_lock.unlock();
+
+  // Nobody else touches mapped_view_copy while the view is out.
+  if (pending) {
+    size_t want = std::max(static_cast<size_t>(len),
+                           std::min(max_len, impl->read_advise_window));
+    impl->mapped_view_copy.resize(want);
+    bool hit = true;
+    ssize_t n = readConsistent(impl, start_offset,
+                               impl->mapped_view_copy.data(), want, hit);
+    if (n <= 0) {
+      read_lock.lock();
+      impl->read_view_active = false;
+      impl->read_view_len = 0;
+      return n;
+    }
+    data = impl->mapped_view_copy.data();
+    len = n;
+    read_lock.lock();
+    impl->read_view_len = static_cast<size_t>(len);
   }
+  segs[0].iov_base = const_cast<void *>(data);
+  segs[0].iov_len = static_cast<size_t>(len);
+  *nsegs = 1;
+  return len;
+}
 
-  if (impl->write_worker_stop_flag)
+} // namespace
+
+ssize_t conveyor_read(conveyor_t *conv, void *buf, size_t count) {
+  if (!conv) {
+    errno = EBADF;
     return LIBCONVEYOR_ERROR;
+  }
+  conveyor_iovec_t iov = {buf, count};
+  return readSegments(reinterpret_cast<libconveyor::ConveyorImpl *>(conv), &iov,
+                      1, count);
+}
 
-  size_t ring_pos_start = impl->write_ring_buffer.head;
-  impl->write_ring_buffer.write(static_cast<const char *>(buf), count);
+ssize_t conveyor_readv(conveyor_t *conv, const conveyor_iovec_t *iov,
+                       int iovcnt) {
+  if (!conv) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  size_t count;
+  if (!totalIovec(iov, iovcnt, count))
+    return LIBCONVEYOR_ERROR;
+  return readSegments(reinterpret_cast<libconveyor::ConveyorImpl *>(conv), iov,
+                      iovcnt, count);
+}
 
-  libconveyor::WriteRequest req;
-  req.file_offset = impl->current_file_offset.load();
-  req.length = count;
-  req.ring_buffer_pos = ring_pos_start;
+ssize_t conveyor_pread(conveyor_t *conv, void *buf, size_t count,
+                       off_t offset) {
+  if (!conv) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  if ((impl->flags & O_ACCMODE) == O_WRONLY) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  if (offset < 0) {
+    errno = EINVAL;
+    return LIBCONVEYOR_ERROR;
+  }
+  if (impl->stats.last_error_code.load() != 0) {
+    errno = impl->stats.last_error_code.load();
+    return LIBCONVEYOR_ERROR;
+  }
 
-  impl->write_queue.push_back(req);
+  int64_t started = impl->markActive();
 
-  impl->current_file_offset += count;
-  impl->stats.bytes_written += count;
+  char *ptr = static_cast<char *>(buf);
+  bool hit = true;
+  ssize_t total_read = readConsistent(impl, offset, ptr, count, hit);
+  if (total_read == LIBCONVEYOR_ERROR)
+    return LIBCONVEYOR_ERROR;
 
-  impl->write_cv_consumer.notify_one();
-  return count;
+  if (impl->read_buffer_enabled) {
+    std::lock_guard<std::mutex> read_lock(impl->read_mutex);
+    impl->observeRead(offset, count, hit);
+  }
+  impl->stats.bytes_read += total_read;
+  impl->recordSince(impl->latency.read_call, started);
+  return total_read;
 }
 
-ssize_t conveyor_read(conveyor_t *conv, void *buf, size_t count) {
+ssize_t conveyor_read_acquire(conveyor_t *conv, size_t max_len,
+                              conveyor_iovec_t segs[2], int *nsegs) {
   if (!conv) {
     errno = EBADF;
     return LIBCONVEYOR_ERROR;
   }
+  if (!segs || !nsegs) {
+    errno = EINVAL;
+    return LIBCONVEYOR_ERROR;
+  }
   auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
-  if (!impl->read_buffer_enabled) {
+  if (!impl->read_buffer_enabled && !impl->read_mapped) {
     errno = EBADF;
     return LIBCONVEYOR_ERROR;
   }
@@ -399,94 +3352,103 @@ ssize_t conveyor_read(conveyor_t *conv, void *buf, size_t count) {
     errno = impl->stats.last_error_code.load();
     return LIBCONVEYOR_ERROR;
   }
+  *nsegs = 0;
+  if (max_len == 0)
+    return 0;
+  if (impl->read_mapped)
+    return acquireMapped(impl, max_len, segs, nsegs);
 
-  char *ptr = static_cast<char *>(buf);
   off_t start_offset = impl->current_file_offset.load();
-  ssize_t total_read = 0;
-
+  libconveyor::RingSegment view[2];
+  size_t nview = 0;
+  size_t len = 0;
+  uint64_t retired =
+      impl->write_batches_retired.load(std::memory_order_acquire);
   {
     std::unique_lock<std::mutex> read_lock(impl->read_mutex);
-
-    // --- ADAPTIVE READ: Heuristic Logic ---
-    bool grow = false;
-
-    // Trigger 1: Request larger than buffer
-    if (count > impl->read_buffer.capacity)
-      grow = true;
-
-    // Trigger 2: Sequential exhaustion (Buffer empty + Sequential Read)
-    if (impl->read_buffer.empty() &&
-        start_offset == impl->last_read_end_offset) {
-      impl->sequential_read_counter++;
-      // If we hit empty buffer sequentially 3 times, assume bandwidth mismatch
-      // -> Grow
-      if (impl->sequential_read_counter > 2)
-        grow = true;
-    } else {
-      impl->sequential_read_counter = 0; // Reset on random seek
-    }
-
-    if (grow && impl->read_buffer.capacity < impl->max_read_capacity) {
-      size_t new_cap = impl->read_buffer.capacity * 2;
-      if (new_cap < count)
-        new_cap = count; // Ensure we fit the specific request
-      if (new_cap > impl->max_read_capacity)
-        new_cap = impl->max_read_capacity;
-
-      // Resize immediately. readWorker will see new capacity on next loop.
-      impl->read_buffer.resize(new_cap);
+    if (impl->read_view_active) {
+      errno = EBUSY;
+      return LIBCONVEYOR_ERROR;
     }
-    impl->last_read_end_offset = start_offset + count;
-    // ----------------------------------------
-
-    off_t current_read_pos = start_offset;
-    while (total_read < count && !impl->read_worker_stop_flag.load()) {
-      if (impl->read_buffer.empty()) {
-        // FIXED EOF LOGIC: If buffer is empty and EOF flag is set, we are done.
-        if (impl->read_eof_flag.load())
-          break;
-
-        impl->read_worker_needs_fill = true;
-        impl->read_cv_producer.notify_one();
-        impl->read_cv_consumer.wait(read_lock, [&] {
-          return impl->read_buffer.available_data() > 0 ||
-                 impl->read_worker_stop_flag.load();
-        });
-        if (impl->read_buffer.available_data() == 0)
-          break;
+    impl->adaptReadBuffer(start_offset, max_len);
+    if (impl->read_cache.enabled())
+      impl->alignReadBuffer(start_offset);
+
+    if (!impl->waitForReadData(read_lock)) {
+      if (impl->stats.last_error_code.load() != 0) {
+        errno = impl->stats.last_error_code.load();
+        return LIBCONVEYOR_ERROR;
       }
-      size_t read_now =
-          impl->read_buffer.read(ptr + total_read, count - total_read);
-      total_read += read_now;
-      current_read_pos += read_now;
-      impl->read_cv_producer.notify_one();
+      return 0; // EOF (or stopping)
     }
+    len = std::min(max_len, impl->read_buffer.available_data());
+    nview = impl->read_buffer.segments_at(impl->read_buffer.tail, len, view);
+    impl->read_view_active = true;
+    impl->read_view_len = len;
   }
 
-  if (impl->write_buffer_enabled) {
+  // Pending writes are patched into the ring in place, so the view has the
+  // same read-after-write guarantee as conveyor_read. Nobody else touches
+  // these bytes while the view is out; an invalidation keeps them, so a
+  // write that retired since we sampled is fetched into them again.
+  if (impl->write_buffer_enabled &&
+      (impl->hasStagedWrites() || impl->mayOverlapPending(start_offset, len) ||
+       impl->write_batches_retired.load(std::memory_order_acquire) !=
+           retired)) {
     std::unique_lock<std::mutex> write_lock(impl->write_mutex);
-    off_t requested_read_end = start_offset + count;
-    for (const auto &req : impl->write_queue) {
-      off_t write_start = req.file_offset;
-      off_t write_end = req.file_offset + req.length;
-      off_t overlap_start = std::max(start_offset, write_start);
-      off_t overlap_end = std::min(requested_read_end, write_end);
-      if (overlap_start < overlap_end) {
-        size_t len = static_cast<size_t>(overlap_end - overlap_start);
-        size_t dest_idx = static_cast<size_t>(overlap_start - start_offset);
-        size_t offset_in_req = static_cast<size_t>(overlap_start - write_start);
-        size_t ring_abs_pos = req.ring_buffer_pos + offset_in_req;
-        impl->write_ring_buffer.peek_at(ring_abs_pos, ptr + dest_idx, len);
-        size_t bytes_covered = dest_idx + len;
-        if (bytes_covered > total_read)
-          total_read = bytes_covered;
+    impl->drainStagedWrites();
+    if (impl->write_batches_retired.load(std::memory_order_acquire) !=
+        retired) {
+      off_t seg_offset = start_offset;
+      for (size_t i = 0; i < nview; ++i) {
+        if (impl->readStorage(seg_offset, view[i].data, view[i].len) ==
+            LIBCONVEYOR_ERROR) {
+          int err = errno;
+          write_lock.unlock();
+          std::lock_guard<std::mutex> read_lock(impl->read_mutex);
+          impl->read_view_active = false;
+          impl->read_view_len = 0;
+          errno = err;
+          return LIBCONVEYOR_ERROR;
+        }
+        seg_offset += view[i].len;
       }
     }
+    off_t seg_offset = start_offset;
+    for (size_t i = 0; i < nview; ++i) {
+      impl->snoopPendingWrites(seg_offset, view[i].len, view[i].data);
+      seg_offset += view[i].len;
+    }
   }
 
-  impl->current_file_offset = start_offset + total_read;
-  impl->stats.bytes_read += total_read;
-  return total_read;
+  for (size_t i = 0; i < nview; ++i) {
+    segs[i].iov_base = view[i].data;
+    segs[i].iov_len = view[i].len;
+  }
+  *nsegs = static_cast<int>(nview);
+  return static_cast<ssize_t>(len);
+}
+
+int conveyor_read_release(conveyor_t *conv, size_t consumed) {
+  if (!conv) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  std::unique_lock<std::mutex> read_lock(impl->read_mutex);
+  if (!impl->read_view_active || consumed > impl->read_view_len) {
+    errno = EINVAL;
+    return LIBCONVEYOR_ERROR;
+  }
+  impl->read_view_active = false;
+  impl->read_view_len = 0;
+  impl->current_file_offset += consumed;
+  impl->stats.bytes_read += consumed;
+  if (!impl->read_mapped) {
+    impl->consumeReadBuffer(nullptr, consumed);
+    impl->wakeReadWorkers();
+  }
+  return 0;
 }
 
 off_t conveyor_lseek(conveyor_t *conv, off_t offset, int whence) {
@@ -506,18 +3468,24 @@ off_t conveyor_lseek(conveyor_t *conv, off_t offset, int whence) {
   std::unique_lock<std::mutex> write_lock(impl->write_mutex, std::defer_lock);
   std::lock(read_lock, write_lock);
 
+  if (impl->read_view_active) {
+    errno = EBUSY;
+    return LIBCONVEYOR_ERROR;
+  }
+
   off_t new_pos = impl->ops.lseek(impl->handle, offset, whence);
 
   if (new_pos != LIBCONVEYOR_ERROR) {
-    if (impl->read_buffer_enabled) {
+    if (impl->read_buffer_enabled && !impl->read_cache.enabled()) {
+      // Without a cache the buffered data is only useful for sequential
+      // reads from here; with one, the next read realigns as needed.
       impl->read_buffer.clear();
       impl->read_eof_flag = false;
-      impl->read_buffer_generation++;
+      impl->restartReadAhead(new_pos);
       impl->read_cv_consumer.notify_all();
-      impl->read_cv_producer.notify_all();
+      impl->wakeReadWorkers();
     }
     impl->current_file_offset = new_pos;
-    impl->read_head_in_storage = new_pos;
     // Reset heuristics
     impl->sequential_read_counter = 0;
   }
@@ -537,14 +3505,22 @@ int conveyor_flush(conveyor_t *conv) {
     return LIBCONVEYOR_ERROR;
   }
   std::unique_lock<std::mutex> lock(impl->write_mutex);
+  impl->drainStagedWrites();
+  size_t pending = impl->write_ring_buffer.size;
+  int64_t traced = LIBCONVEYOR_TRACE_BEGIN(impl, CONVEYOR_TRACE_FLUSH_BEGIN, 0,
+                                           pending);
+  int64_t started = libconveyor::ConveyorImpl::nowNs();
   if (!impl->write_queue.empty()) {
     impl->write_buffer_needs_flush = true;
-    impl->write_cv_consumer.notify_one();
+    impl->wakeWriteWorkers();
     impl->write_cv_producer.wait(lock, [&] {
-      return impl->write_queue.empty() || impl->write_worker_stop_flag;
+      return impl->write_queue.empty() || impl->write_worker_stop_flag ||
+             impl->stats.last_error_code.load() != 0;
     });
   }
   impl->write_buffer_needs_flush = false;
+  impl->recordFlushWait(started);
+  LIBCONVEYOR_TRACE_END(impl, CONVEYOR_TRACE_FLUSH_END, 0, pending, traced);
   if (impl->stats.last_error_code.load() != 0) {
     errno = impl->stats.last_error_code.load();
     return LIBCONVEYOR_ERROR;
@@ -552,28 +3528,316 @@ int conveyor_flush(conveyor_t *conv) {
   return 0;
 }
 
+namespace {
+
+int queueFlushBarrier(conveyor_t *conv, conveyor_flush_fn callback,
+                      void *context, bool durable) {
+  if (!conv) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  if (!callback) {
+    errno = EINVAL;
+    return LIBCONVEYOR_ERROR;
+  }
+  auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  libconveyor::ConveyorImpl::FlushBarrier barrier;
+  barrier.durable = durable;
+  barrier.callback = callback;
+  barrier.context = context;
+  barrier.queued_ns = libconveyor::ConveyorImpl::nowNs();
+  std::unique_lock<std::mutex> lock(impl->write_mutex);
+  impl->queueBarrier(lock, barrier);
+  return 0;
+}
+
+} // namespace
+
+int conveyor_flush_async(conveyor_t *conv, conveyor_flush_fn callback,
+                         void *context) {
+  return queueFlushBarrier(conv, callback, context, false);
+}
+
+int conveyor_fsync_async(conveyor_t *conv, conveyor_flush_fn callback,
+                         void *context) {
+  return queueFlushBarrier(conv, callback, context, true);
+}
+
+int conveyor_fsync(conveyor_t *conv) {
+  struct Waiter {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    int error = 0;
+  } waiter;
+  auto on_done = [](void *context, int error) {
+    auto *w = static_cast<Waiter *>(context);
+    std::lock_guard<std::mutex> lock(w->mutex);
+    w->error = error;
+    w->done = true;
+    w->cv.notify_one();
+  };
+  if (conveyor_fsync_async(conv, on_done, &waiter) != 0)
+    return LIBCONVEYOR_ERROR;
+  std::unique_lock<std::mutex> lock(waiter.mutex);
+  waiter.cv.wait(lock, [&] { return waiter.done; });
+  if (waiter.error != 0) {
+    errno = waiter.error;
+    return LIBCONVEYOR_ERROR;
+  }
+  return 0;
+}
+
+namespace {
+
+// How far 'counter' moved since 'mark', which then catches up.
+template <typename T>
+uint64_t windowDelta(const std::atomic<T> &counter, uint64_t &mark) {
+  uint64_t now = static_cast<uint64_t>(counter.load());
+  uint64_t moved = now - mark;
+  mark = now;
+  return moved;
+}
+
+// Reports one window of counters from 'impl' into 'stats' and starts the
+// next window.
+void takeStats(libconveyor::ConveyorImpl *impl, conveyor_stats_t *stats) {
+  auto &c = impl->stats;
+  std::lock_guard<std::mutex> lock(impl->stats_window_mutex);
+  auto &w = impl->stats_window;
+  stats->bytes_written = windowDelta(c.bytes_written, w.bytes_written);
+  stats->bytes_read = windowDelta(c.bytes_read, w.bytes_read);
+  uint64_t w_latency =
+      windowDelta(c.total_write_latency_ns, w.total_write_latency_ns);
+  uint64_t w_ops = windowDelta(c.write_ops_count, w.write_ops_count);
+  uint64_t r_latency = windowDelta(c.total_read_latency_ns, w.total_read_latency_ns);
+  uint64_t r_ops = windowDelta(c.read_ops_count, w.read_ops_count);
+  stats->write_buffer_full_events =
+      windowDelta(c.write_buffer_full_events, w.write_buffer_full_events);
+  stats->read_hits = windowDelta(c.read_hits, w.read_hits);
+  stats->read_misses = windowDelta(c.read_misses, w.read_misses);
+  stats->bytes_absorbed = windowDelta(c.bytes_absorbed, w.bytes_absorbed);
+  stats->throttled_ops = windowDelta(c.throttled_ops, w.throttled_ops);
+  stats->throttle_wait_ms = static_cast<size_t>(
+      windowDelta(c.throttle_wait_ns, w.throttle_wait_ns) / 1000000);
+  stats->last_error_code = c.last_error_code.load();
+  stats->avg_write_latency_ms = (w_ops > 0) ? (w_latency / w_ops / 1000000) : 0;
+  stats->avg_read_latency_ms = (r_ops > 0) ? (r_latency / r_ops / 1000000) : 0;
+}
+
+// Moves one window of 'h' into 'out'. With a null 'out' the window is
+// just discarded, so the histograms stay in step with the counters.
+void takeLatency(libconveyor::LatencyHistogram &h, conveyor_latency_t *out) {
+  libconveyor::LatencyHistogram::Snapshot snap;
+  h.take(snap);
+  if (!out)
+    return;
+  out->count = snap.count;
+  out->p50_ns = snap.percentile(0.50);
+  out->p99_ns = snap.percentile(0.99);
+  out->p999_ns = snap.percentile(0.999);
+  out->max_ns = snap.max;
+}
+
+} // namespace
+
 int conveyor_get_stats(conveyor_t *conv, conveyor_stats_t *stats) {
   if (!conv || !stats) {
     errno = EBADF;
     return LIBCONVEYOR_ERROR;
   }
   auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  takeStats(impl, stats);
+  takeLatency(impl->latency.backend_write, nullptr);
+  takeLatency(impl->latency.backend_read, nullptr);
+  takeLatency(impl->latency.write_call, nullptr);
+  takeLatency(impl->latency.read_call, nullptr);
+  return 0;
+}
 
-  stats->bytes_written = impl->stats.bytes_written.exchange(0);
-  stats->bytes_read = impl->stats.bytes_read.exchange(0);
-  size_t w_latency = impl->stats.total_write_latency_ms.exchange(0);
-  size_t w_ops = impl->stats.write_ops_count.exchange(0);
-  size_t r_latency = impl->stats.total_read_latency_ms.exchange(0);
-  size_t r_ops = impl->stats.read_ops_count.exchange(0);
-  stats->write_buffer_full_events =
-      impl->stats.write_buffer_full_events.exchange(0);
-  stats->last_error_code = impl->stats.last_error_code.load();
-  stats->avg_write_latency_ms = (w_ops > 0) ? (w_latency / w_ops) : 0;
-  stats->avg_read_latency_ms = (r_ops > 0) ? (r_latency / r_ops) : 0;
+int conveyor_get_stats_ex(conveyor_t *conv, conveyor_stats_ex_t *stats) {
+  if (!conv || !stats) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  takeStats(impl, &stats->basic);
+  takeLatency(impl->latency.backend_write, &stats->backend_write);
+  takeLatency(impl->latency.backend_read, &stats->backend_read);
+  takeLatency(impl->latency.write_call, &stats->write_call);
+  takeLatency(impl->latency.read_call, &stats->read_call);
+  return 0;
+}
+
+int conveyor_get_metrics(conveyor_t *conv, conveyor_metrics_t *metrics,
+                         size_t size) {
+  if (!conv) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+  if (!metrics || size < sizeof(metrics->version)) {
+    errno = EINVAL;
+    return LIBCONVEYOR_ERROR;
+  }
+  auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  const auto &c = impl->stats;
+  conveyor_metrics_t m = {};
+  m.version = CONVEYOR_METRICS_VERSION;
+  m.bytes_written = c.bytes_written.load();
+  m.bytes_read = c.bytes_read.load();
+  m.backend_writes = c.write_ops_count.load();
+  m.backend_write_ns = c.total_write_latency_ns.load();
+  m.backend_reads = c.read_ops_count.load();
+  m.backend_read_ns = c.total_read_latency_ns.load();
+  m.write_buffer_full_events = c.write_buffer_full_events.load();
+  m.read_hits = c.read_hits.load();
+  m.read_misses = c.read_misses.load();
+  m.read_hit_bytes = c.read_hit_bytes.load();
+  m.read_miss_bytes = c.read_miss_bytes.load();
+  m.snoop_patched_bytes = c.snoop_patched_bytes.load();
+  m.bytes_absorbed = c.bytes_absorbed.load();
+  m.read_invalidations = c.read_invalidations.load();
+  m.write_resizes = c.write_resizes.load();
+  m.read_resizes = c.read_resizes.load();
+  m.flushes = c.flushes.load();
+  m.flush_wait_ns = c.flush_wait_ns.load();
+  m.throttled_ops = c.throttled_ops.load();
+  m.throttle_wait_ns = c.throttle_wait_ns.load();
+  if (impl->write_buffer_enabled) {
+    std::lock_guard<std::mutex> lock(impl->write_mutex);
+    impl->drainStagedWrites();
+    m.write_capacity = impl->write_ring_buffer.capacity;
+    m.write_buffered = impl->write_ring_buffer.size;
+    m.write_queue_depth = impl->write_queue.size();
+  }
+  if (impl->read_buffer_enabled) {
+    std::lock_guard<std::mutex> lock(impl->read_mutex);
+    m.read_capacity = impl->read_buffer.capacity;
+    m.read_buffered = impl->read_buffer.available_data();
+  }
+  m.last_error_code = c.last_error_code.load();
+  std::memcpy(metrics, &m, std::min(size, sizeof(m)));
+  return 0;
+}
+
+ssize_t conveyor_trace_read(conveyor_t *conv, conveyor_trace_record_t *records,
+                            size_t max) {
+  if (!conv || (!records && max > 0)) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+#ifndef LIBCONVEYOR_NO_TRACING
+  auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  if (!impl->trace_log) {
+    errno = EINVAL;
+    return LIBCONVEYOR_ERROR;
+  }
+  return static_cast<ssize_t>(impl->trace_log->drain(records, max));
+#else
+  errno = ENOSYS;
+  return LIBCONVEYOR_ERROR;
+#endif
+}
+
+namespace {
+
+// Slice (or instant) name of an event in exported traces. Both halves of a
+// pair map to the same name; only the *_END is exported.
+const char *traceEventName(conveyor_trace_event_t event, bool &end,
+                           bool &instant) {
+  end = false;
+  instant = false;
+  switch (event) {
+  case CONVEYOR_TRACE_ENQUEUE: instant = true; return "enqueue";
+  case CONVEYOR_TRACE_DEQUEUE: instant = true; return "dequeue";
+  case CONVEYOR_TRACE_BACKEND_WRITE_BEGIN: return "backend_write";
+  case CONVEYOR_TRACE_BACKEND_WRITE_END: end = true; return "backend_write";
+  case CONVEYOR_TRACE_BACKEND_READ_BEGIN: return "backend_read";
+  case CONVEYOR_TRACE_BACKEND_READ_END: end = true; return "backend_read";
+  case CONVEYOR_TRACE_WRITE_RESIZE: instant = true; return "write_resize";
+  case CONVEYOR_TRACE_READ_RESIZE: instant = true; return "read_resize";
+  case CONVEYOR_TRACE_GROW_WAIT_BEGIN: return "grow_wait";
+  case CONVEYOR_TRACE_GROW_WAIT_END: end = true; return "grow_wait";
+  case CONVEYOR_TRACE_BACKPRESSURE_BEGIN: return "backpressure";
+  case CONVEYOR_TRACE_BACKPRESSURE_END: end = true; return "backpressure";
+  case CONVEYOR_TRACE_INVALIDATE: instant = true; return "invalidate";
+  case CONVEYOR_TRACE_FLUSH_BEGIN: return "flush";
+  case CONVEYOR_TRACE_FLUSH_END: end = true; return "flush";
+  case CONVEYOR_TRACE_FSYNC_BEGIN: return "fsync";
+  case CONVEYOR_TRACE_FSYNC_END: end = true; return "fsync";
+  }
+  return "unknown";
+}
+
+} // namespace
+
+int conveyor_trace_export_chrome(conveyor_t *conv, const char *path) {
+  if (!path) {
+    errno = EINVAL;
+    return LIBCONVEYOR_ERROR;
+  }
+  conveyor_trace_record_t records[256];
+  ssize_t n = conveyor_trace_read(conv, records, 0); // Validates conv
+  if (n < 0)
+    return LIBCONVEYOR_ERROR;
+  FILE *out = std::fopen(path, "w");
+  if (!out)
+    return LIBCONVEYOR_ERROR;
 
+  // Slices are written as complete ("X") events from their *_END record,
+  // so a pair may begin and end on different threads.
+  std::fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  bool first = true;
+  while ((n = conveyor_trace_read(conv, records, 256)) > 0) {
+    for (ssize_t i = 0; i < n; ++i) {
+      const conveyor_trace_record_t &r = records[i];
+      bool end, instant;
+      const char *name = traceEventName(r.event, end, instant);
+      if (!end && !instant)
+        continue;
+      double ts = (r.timestamp_ns - r.duration_ns) / 1000.0;
+      std::fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"conveyor\",",
+                   first ? "" : ",", name);
+      if (instant)
+        std::fprintf(out, "\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,", ts);
+      else
+        std::fprintf(out, "\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,", ts,
+                     r.duration_ns / 1000.0);
+      std::fprintf(out,
+                   "\"pid\":1,\"tid\":%llu,\"args\":{\"offset\":%lld,"
+                   "\"bytes\":%llu}}",
+                   r.thread_id, static_cast<long long>(r.offset),
+                   static_cast<unsigned long long>(r.bytes));
+      first = false;
+    }
+  }
+  std::fprintf(out, "\n]}\n");
+  if (std::fclose(out) != 0)
+    return LIBCONVEYOR_ERROR;
   return 0;
 }
 
+int conveyor_writable_fd(conveyor_t *conv) {
+  if (!conv) {
+    errno = EBADF;
+    return LIBCONVEYOR_ERROR;
+  }
+#ifdef __linux__
+  auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  std::lock_guard<std::mutex> lock(impl->write_mutex);
+  if (impl->writable_fd.load() < 0) {
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0)
+      return LIBCONVEYOR_ERROR;
+    impl->writable_fd = fd;
+  }
+  return impl->writable_fd.load();
+#else
+  errno = ENOSYS;
+  return LIBCONVEYOR_ERROR;
+#endif
+}
+
 void conveyor_stop(conveyor_t *conv) {
   if (!conv)
     return;
@@ -596,6 +3860,13 @@ int conveyor_clear_error(conveyor_t *conv) {
     return LIBCONVEYOR_ERROR;
   }
   auto *impl = reinterpret_cast<libconveyor::ConveyorImpl *>(conv);
+  std::lock_guard<std::mutex> lock(impl->write_mutex);
+  // Later retires would drop the kept records' neighbours instead of
+  // their own; the stream has to go through conveyor_recover.
+  if (impl->journal_kept) {
+    errno = EBUSY;
+    return LIBCONVEYOR_ERROR;
+  }
   impl->stats.last_error_code = 0;
   return 0;
 }
@@ -0,0 +1,294 @@
+#include "libconveyor/io_uring_backend.h"
+
+#include <cerrno>
+
+#if defined(__linux__) && !defined(LIBCONVEYOR_NO_IO_URING) &&                \
+    __has_include(<linux/io_uring.h>)
+#define LIBCONVEYOR_USE_IO_URING 1
+#endif
+
+#ifdef LIBCONVEYOR_USE_IO_URING
+
+#include <algorithm> // For std::max
+#include <cstdint>
+#include <cstring> // For memset
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace libconveyor {
+namespace {
+
+// One io_uring instance, talked to through raw syscalls so there is no
+// liburing dependency. Each queue is driven by a single thread (the
+// conveyor's worker for that direction), so the ring indices only need
+// acquire/release ordering against the kernel.
+struct UringQueue {
+  int ring_fd = -1;
+  int file_fd = -1;
+
+  void *sq_ptr = MAP_FAILED;
+  size_t sq_size = 0;
+  void *cq_ptr = MAP_FAILED;
+  size_t cq_size = 0;
+  io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+  size_t sqes_size = 0;
+
+  unsigned *sq_head = nullptr;
+  unsigned *sq_tail = nullptr;
+  unsigned *sq_mask = nullptr;
+  unsigned *sq_array = nullptr;
+  unsigned sq_entries = 0;
+  unsigned *cq_head = nullptr;
+  unsigned *cq_tail = nullptr;
+  unsigned *cq_mask = nullptr;
+  io_uring_cqe *cqes = nullptr;
+
+  unsigned to_submit = 0; // Queued SQEs the kernel has not consumed yet
+
+  bool init(int fd, unsigned entries) {
+    file_fd = fd;
+    io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+    if (ring_fd < 0)
+      return false;
+
+    sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap)
+      sq_size = cq_size = std::max(sq_size, cq_size);
+
+    sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED)
+      return false;
+    if (single_mmap) {
+      cq_ptr = sq_ptr;
+    } else {
+      cq_ptr = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+      if (cq_ptr == MAP_FAILED)
+        return false;
+    }
+    sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe *>(mmap(nullptr, sqes_size,
+                                            PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, ring_fd,
+                                            IORING_OFF_SQES));
+    if (sqes == MAP_FAILED)
+      return false;
+
+    char *sq = static_cast<char *>(sq_ptr);
+    sq_head = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    sq_entries = p.sq_entries;
+
+    char *cq = static_cast<char *>(cq_ptr);
+    cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+    return true;
+  }
+
+  void destroy() {
+    if (sqes != MAP_FAILED)
+      munmap(sqes, sqes_size);
+    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+      munmap(cq_ptr, cq_size);
+    if (sq_ptr != MAP_FAILED)
+      munmap(sq_ptr, sq_size);
+    if (ring_fd >= 0)
+      close(ring_fd);
+    ring_fd = -1;
+  }
+
+  int enter(unsigned submit, unsigned min_complete, unsigned flags) {
+    while (true) {
+      int r = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, submit,
+                                       min_complete, flags, nullptr, 0));
+      if (r >= 0) {
+        to_submit -= std::min(to_submit, static_cast<unsigned>(r));
+        return r;
+      }
+      if (errno != EINTR)
+        return -1;
+    }
+  }
+
+  int submit(int op, const conveyor_iovec_t *iov, int iovcnt, off_t offset,
+             unsigned long long user_data) {
+    unsigned tail = *sq_tail;
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= sq_entries) {
+      // Ring full: push what we have to the kernel to make room.
+      if (enter(to_submit, 0, 0) < 0)
+        return -1;
+      head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+      if (tail - head >= sq_entries) {
+        errno = EAGAIN;
+        return -1;
+      }
+    }
+    unsigned idx = tail & *sq_mask;
+    io_uring_sqe *sqe = &sqes[idx];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (op == CONVEYOR_OP_WRITE) ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = file_fd;
+    sqe->addr = reinterpret_cast<uint64_t>(iov);
+    sqe->len = static_cast<unsigned>(iovcnt);
+    sqe->off = static_cast<uint64_t>(offset);
+    sqe->user_data = user_data;
+    sq_array[idx] = idx;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    to_submit++;
+    return 0;
+  }
+
+  int harvest(conveyor_completion_t *out, int max) {
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    int n = 0;
+    while (head != tail && n < max) {
+      const io_uring_cqe *cqe = &cqes[head & *cq_mask];
+      out[n].user_data = cqe->user_data;
+      out[n].result = cqe->res;
+      head++;
+      n++;
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    return n;
+  }
+
+  // Submits everything queued and waits for 'min' completions in as few
+  // io_uring_enter calls as possible (usually one).
+  int reap(conveyor_completion_t *out, int max, int min) {
+    int got = harvest(out, max);
+    while (to_submit > 0 || got < min) {
+      unsigned want = (got < min) ? static_cast<unsigned>(min - got) : 0;
+      if (enter(to_submit, want, want ? IORING_ENTER_GETEVENTS : 0) < 0)
+        return -1;
+      got += harvest(out + got, max - got);
+      if (want == 0)
+        break;
+    }
+    return got;
+  }
+};
+
+struct UringFile {
+  int fd;
+  UringQueue queues[2]; // Indexed by CONVEYOR_QUEUE_WRITE / _READ
+};
+
+UringFile *as_file(storage_handle_t h) { return static_cast<UringFile *>(h); }
+
+ssize_t uring_pwrite(storage_handle_t h, const void *buf, size_t count,
+                     off_t offset) {
+  return ::pwrite(as_file(h)->fd, buf, count, offset);
+}
+
+ssize_t uring_pread(storage_handle_t h, void *buf, size_t count, off_t offset) {
+  return ::pread(as_file(h)->fd, buf, count, offset);
+}
+
+off_t uring_lseek(storage_handle_t h, off_t offset, int whence) {
+  return ::lseek(as_file(h)->fd, offset, whence);
+}
+
+ssize_t uring_pwritev(storage_handle_t h, const conveyor_iovec_t *iov,
+                      int iovcnt, off_t offset) {
+  return ::pwritev(as_file(h)->fd, reinterpret_cast<const struct iovec *>(iov),
+                   iovcnt, offset);
+}
+
+int uring_fsync(storage_handle_t h) { return ::fdatasync(as_file(h)->fd); }
+
+int uring_truncate(storage_handle_t h, off_t length) {
+  return ::ftruncate(as_file(h)->fd, length);
+}
+
+int uring_submit(storage_handle_t h, int queue, int op,
+                 const conveyor_iovec_t *iov, int iovcnt, off_t offset,
+                 unsigned long long user_data) {
+  if (queue != CONVEYOR_QUEUE_WRITE && queue != CONVEYOR_QUEUE_READ) {
+    errno = EINVAL;
+    return -1;
+  }
+  return as_file(h)->queues[queue].submit(op, iov, iovcnt, offset, user_data);
+}
+
+int uring_reap(storage_handle_t h, int queue, conveyor_completion_t *out,
+               int max, int min) {
+  if (queue != CONVEYOR_QUEUE_WRITE && queue != CONVEYOR_QUEUE_READ) {
+    errno = EINVAL;
+    return -1;
+  }
+  return as_file(h)->queues[queue].reap(out, max, min);
+}
+
+} // namespace
+} // namespace libconveyor
+
+storage_handle_t conveyor_uring_open(int fd, unsigned queue_depth) {
+  if (fd < 0) {
+    errno = EBADF;
+    return nullptr;
+  }
+  auto *file = new libconveyor::UringFile();
+  file->fd = fd;
+  unsigned entries = std::max(queue_depth, 1u);
+  for (auto &q : file->queues) {
+    if (!q.init(fd, entries)) {
+      int err = errno;
+      conveyor_uring_close(file);
+      errno = err;
+      return nullptr;
+    }
+  }
+  return file;
+}
+
+void conveyor_uring_close(storage_handle_t handle) {
+  auto *file = static_cast<libconveyor::UringFile *>(handle);
+  if (!file)
+    return;
+  for (auto &q : file->queues)
+    q.destroy();
+  delete file;
+}
+
+storage_operations_t conveyor_uring_ops(void) {
+  storage_operations_t ops = {};
+  ops.pwrite = libconveyor::uring_pwrite;
+  ops.pread = libconveyor::uring_pread;
+  ops.lseek = libconveyor::uring_lseek;
+  ops.pwritev = libconveyor::uring_pwritev;
+  ops.submit = libconveyor::uring_submit;
+  ops.reap = libconveyor::uring_reap;
+  ops.fsync = libconveyor::uring_fsync;
+  ops.truncate = libconveyor::uring_truncate;
+  return ops;
+}
+
+#else // !LIBCONVEYOR_USE_IO_URING
+
+storage_handle_t conveyor_uring_open(int, unsigned) {
+  errno = ENOSYS;
+  return nullptr;
+}
+
+void conveyor_uring_close(storage_handle_t) {}
+
+storage_operations_t conveyor_uring_ops(void) {
+  storage_operations_t ops = {};
+  return ops;
+}
+
+#endif // LIBCONVEYOR_USE_IO_URING
@@ -0,0 +1,200 @@
+#include "libconveyor/mmap_backend.h"
+
+#include <cerrno>
+
+#if !defined(_WIN32) && !defined(LIBCONVEYOR_NO_MMAP) &&                      \
+    __has_include(<sys/mman.h>)
+#define LIBCONVEYOR_USE_MMAP 1
+#endif
+
+#ifdef LIBCONVEYOR_USE_MMAP
+
+#include <algorithm> // For std::min
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace libconveyor {
+namespace {
+
+constexpr size_t kDefaultReserve =
+    sizeof(void *) >= 8 ? (size_t(1) << 40) : (size_t(1) << 30);
+
+// A file mapped into a fixed reservation of address space. The mapping only
+// ever grows, in whole pages, into the reservation, so a pointer handed out
+// by map() stays valid until the handle is closed; the pages are the page
+// cache's, so writes that reach the file show through them.
+struct MmapFile {
+  int fd = -1;
+  char *base = nullptr;
+  size_t reserved = 0;
+  size_t page = 4096;
+
+  std::mutex mutex;           // Serializes growth
+  size_t mapped = 0;          // Bytes mapped, a multiple of 'page'; under mutex
+  off_t file_size = 0;        // As of the last growth; under mutex
+  std::atomic<size_t> size{0}; // Bytes readable through the mapping
+
+  // Follows the file to its current size, as far as the reservation goes.
+  // Returns false with errno set.
+  bool grow() {
+    std::lock_guard<std::mutex> lock(mutex);
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+      return false;
+    file_size = st.st_size;
+    size_t want = std::min(static_cast<size_t>(st.st_size), reserved);
+    size_t pages = (want + page - 1) / page * page;
+    if (pages > mapped) {
+      // MAP_FIXED replaces only the reserved range past what is mapped.
+      void *p = ::mmap(base + mapped, pages - mapped, PROT_READ,
+                       MAP_SHARED | MAP_FIXED, fd, static_cast<off_t>(mapped));
+      if (p == MAP_FAILED)
+        return false;
+      mapped = pages;
+    }
+    if (want > size.load(std::memory_order_relaxed))
+      size.store(want, std::memory_order_release);
+    return true;
+  }
+
+  // Readable bytes at 'offset', growing the mapping when the range runs past
+  // it. Returns -1 with errno set.
+  ssize_t available(off_t offset, size_t count) {
+    size_t pos = static_cast<size_t>(offset);
+    size_t have = size.load(std::memory_order_acquire);
+    if (pos >= have || count > have - pos) {
+      if (!grow())
+        return -1;
+      have = size.load(std::memory_order_acquire);
+      if (pos >= have) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (offset < file_size) {
+          errno = EFBIG; // Past the reservation
+          return -1;
+        }
+        return 0;
+      }
+    }
+    return static_cast<ssize_t>(std::min(count, have - pos));
+  }
+};
+
+MmapFile *as_file(storage_handle_t h) { return static_cast<MmapFile *>(h); }
+
+ssize_t mmap_pwrite(storage_handle_t h, const void *buf, size_t count,
+                    off_t offset) {
+  return ::pwrite(as_file(h)->fd, buf, count, offset);
+}
+
+ssize_t mmap_pread(storage_handle_t h, void *buf, size_t count, off_t offset) {
+  return ::pread(as_file(h)->fd, buf, count, offset);
+}
+
+off_t mmap_lseek(storage_handle_t h, off_t offset, int whence) {
+  return ::lseek(as_file(h)->fd, offset, whence);
+}
+
+ssize_t mmap_pwritev(storage_handle_t h, const conveyor_iovec_t *iov,
+                     int iovcnt, off_t offset) {
+  return ::pwritev(as_file(h)->fd, reinterpret_cast<const struct iovec *>(iov),
+                   iovcnt, offset);
+}
+
+int mmap_fsync(storage_handle_t h) { return ::fdatasync(as_file(h)->fd); }
+
+ssize_t mmap_map(storage_handle_t h, off_t offset, size_t count,
+                 const void **data) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  MmapFile *file = as_file(h);
+  ssize_t n = file->available(offset, count);
+  if (n > 0)
+    *data = file->base + offset;
+  return n;
+}
+
+int mmap_advise(storage_handle_t h, off_t offset, size_t count) {
+  MmapFile *file = as_file(h);
+  ssize_t n = (offset < 0) ? 0 : file->available(offset, count);
+  if (n <= 0)
+    return static_cast<int>(n);
+  size_t start = static_cast<size_t>(offset) / file->page * file->page;
+  size_t end = static_cast<size_t>(offset) + static_cast<size_t>(n);
+  return ::madvise(file->base + start, end - start, MADV_WILLNEED);
+}
+
+} // namespace
+} // namespace libconveyor
+
+storage_handle_t conveyor_mmap_open(int fd, size_t max_size) {
+  if (fd < 0) {
+    errno = EBADF;
+    return nullptr;
+  }
+  auto *file = new libconveyor::MmapFile();
+  file->fd = fd;
+  long page = ::sysconf(_SC_PAGESIZE);
+  if (page > 0)
+    file->page = static_cast<size_t>(page);
+  size_t reserve = max_size > 0 ? max_size : libconveyor::kDefaultReserve;
+  file->reserved = (reserve + file->page - 1) / file->page * file->page;
+  void *p = ::mmap(nullptr, file->reserved, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) {
+    int err = errno;
+    delete file;
+    errno = err;
+    return nullptr;
+  }
+  file->base = static_cast<char *>(p);
+  if (!file->grow()) {
+    int err = errno;
+    conveyor_mmap_close(file);
+    errno = err;
+    return nullptr;
+  }
+  return file;
+}
+
+void conveyor_mmap_close(storage_handle_t handle) {
+  auto *file = static_cast<libconveyor::MmapFile *>(handle);
+  if (!file)
+    return;
+  ::munmap(file->base, file->reserved);
+  delete file;
+}
+
+storage_operations_t conveyor_mmap_ops(void) {
+  storage_operations_t ops = {};
+  ops.pwrite = libconveyor::mmap_pwrite;
+  ops.pread = libconveyor::mmap_pread;
+  ops.lseek = libconveyor::mmap_lseek;
+  ops.pwritev = libconveyor::mmap_pwritev;
+  ops.fsync = libconveyor::mmap_fsync;
+  ops.map = libconveyor::mmap_map;
+  ops.advise = libconveyor::mmap_advise;
+  return ops;
+}
+
+#else // !LIBCONVEYOR_USE_MMAP
+
+storage_handle_t conveyor_mmap_open(int, size_t) {
+  errno = ENOSYS;
+  return nullptr;
+}
+
+void conveyor_mmap_close(storage_handle_t) {}
+
+storage_operations_t conveyor_mmap_ops(void) {
+  storage_operations_t ops = {};
+  return ops;
+}
+
+#endif // LIBCONVEYOR_USE_MMAP
@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 #include "mock_storage.hpp"
 #include "libconveyor/conveyor.h"
+#include "libconveyor/detail/ring_buffer.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
 
 class AdaptiveTest : public ::testing::Test {
 protected:
@@ -10,8 +15,19 @@ protected:
         mock = new MockStorage(1024 * 1024);
     }
     void TearDown() override {
+        conveyor_set_memory_budget(0);
         delete mock;
     }
+
+    conveyor_config_t write_config(MockStorage* storage, size_t max_write) {
+        conveyor_config_t cfg = {0};
+        cfg.handle = (storage_handle_t)storage;
+        cfg.ops = storage->get_ops();
+        cfg.flags = O_WRONLY;
+        cfg.initial_write_size = 4096;
+        cfg.max_write_size = max_write;
+        return cfg;
+    }
 };
 
 // Test 1: Simple Growth
@@ -110,6 +126,158 @@ TEST_F(AdaptiveTest, ResizeWhileWrapped) {
     conveyor_destroy(conv);
 }
 
+// Growing while the queued bytes do not wrap extends the ring in place, so
+// the writer is not held up until the slow backend has drained everything.
+TEST_F(AdaptiveTest, WriteGrowthDoesNotWaitForDrain) {
+    conveyor_config_t cfg = {0};
+    cfg.handle = (storage_handle_t)mock;
+    cfg.ops = mock->get_ops();
+    cfg.flags = O_WRONLY;
+    cfg.initial_write_size = 1000;
+    cfg.max_write_size = 64 * 1024;
+
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    mock->write_delay_ms = 300;
+
+    std::vector<char> first(800, 'F');
+    std::vector<char> second(4000, 'S');
+    ASSERT_EQ(conveyor_write(conv, first.data(), first.size()), (ssize_t)first.size());
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(conveyor_write(conv, second.data(), second.size()), (ssize_t)second.size());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(150));
+
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    std::vector<char> expected(first);
+    expected.insert(expected.end(), second.begin(), second.end());
+    EXPECT_EQ(std::memcmp(mock->data.data(), expected.data(), expected.size()), 0);
+    conveyor_destroy(conv);
+}
+
+// RingBuffer on arena storage: growth within the reservation leaves data
+// and positions alone, growth past it or with wrapped data unrolls, and
+// shrinking only succeeds while the data already fits below the new size.
+TEST_F(AdaptiveTest, RingBufferGrowsInPlaceAndShrinks) {
+    libconveyor::RingBuffer ring(100, 10000);
+    EXPECT_GE(ring.reserved(), 10000u);
+    std::vector<char> a(60, 'a');
+    ASSERT_EQ(ring.write(a.data(), a.size()), a.size());
+    char skip[20];
+    ASSERT_EQ(ring.read(skip, sizeof(skip)), sizeof(skip)); // Tail at 20
+
+    ring.resize(1000);
+    EXPECT_EQ(ring.capacity, 1000u);
+    EXPECT_EQ(ring.tail, 20u);
+    EXPECT_EQ(ring.head, 60u);
+    std::vector<char> b(950, 'b');
+    ASSERT_EQ(ring.write(b.data(), b.size()), b.size()); // Wraps at 1000
+    EXPECT_FALSE(ring.contiguous());
+    EXPECT_FALSE(ring.shrink(500));
+
+    ring.resize(2000); // Wrapped: unrolled to the start
+    EXPECT_EQ(ring.tail, 0u);
+    EXPECT_EQ(ring.size, 990u);
+    std::vector<char> out(990);
+    ASSERT_EQ(ring.read(out.data(), out.size()), out.size());
+    EXPECT_EQ(std::string(out.begin(), out.begin() + 40), std::string(40, 'a'));
+    EXPECT_EQ(std::string(out.begin() + 40, out.end()), std::string(950, 'b'));
+
+    EXPECT_TRUE(ring.shrink(100)); // Empty: restarts at 0
+    EXPECT_EQ(ring.capacity, 100u);
+    EXPECT_EQ(ring.head, 0u);
+    ASSERT_EQ(ring.write(a.data(), a.size()), a.size());
+    EXPECT_TRUE(ring.shrink(80));
+    EXPECT_FALSE(ring.shrink(50));
+    ASSERT_EQ(ring.read(out.data(), 60), 60u);
+    EXPECT_EQ(std::string(out.begin(), out.begin() + 60), std::string(60, 'a'));
+}
+
+// With idle_shrink_ms set, grown buffers go back to their initial sizes
+// once the conveyor has been left alone, and the budget sees it.
+TEST_F(AdaptiveTest, IdleShrinkReturnsCapacity) {
+    auto cfg = write_config(mock, 1024 * 1024);
+    cfg.flags = O_RDWR;
+    cfg.initial_read_size = 4096;
+    cfg.max_read_size = 256 * 1024;
+    cfg.idle_shrink_ms = 50;
+    size_t before = conveyor_memory_in_use();
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    size_t base = conveyor_memory_in_use();
+    EXPECT_EQ(base - before, 2 * 4096u);
+
+    std::vector<char> data(200 * 1024, 'I');
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    ASSERT_EQ(conveyor_lseek(conv, 0, SEEK_SET), 0);
+    std::vector<char> out(100 * 1024);
+    ASSERT_EQ(conveyor_read(conv, out.data(), out.size()), (ssize_t)out.size());
+    EXPECT_GT(conveyor_memory_in_use(), base + 200 * 1024);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (conveyor_memory_in_use() > base && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(conveyor_memory_in_use(), base);
+
+    // Still fully usable at the smaller size.
+    ASSERT_EQ(conveyor_read(conv, out.data(), out.size()), (ssize_t)out.size());
+    EXPECT_EQ(std::string(out.begin(), out.end()), std::string(out.size(), 'I'));
+    conveyor_destroy(conv);
+    EXPECT_EQ(conveyor_memory_in_use(), before);
+}
+
+// Under a budget, a conveyor that needs to grow takes the capacity of a
+// cold one of equal priority instead of exceeding the limit. One of higher
+// priority is left alone, and growth that would not fit is refused.
+TEST_F(AdaptiveTest, BudgetReclaimsFromColdConveyors) {
+    MockStorage hot_storage(0);
+    std::vector<char> big(256 * 1024, 'C');
+
+    auto cold_cfg = write_config(mock, 1024 * 1024);
+    conveyor_t* cold = conveyor_create(&cold_cfg);
+    ASSERT_NE(cold, nullptr);
+    ASSERT_EQ(conveyor_write(cold, big.data(), big.size()), (ssize_t)big.size());
+    ASSERT_EQ(conveyor_flush(cold), 0);
+    size_t in_use = conveyor_memory_in_use();
+
+    auto hot_cfg = write_config(&hot_storage, 1024 * 1024);
+    conveyor_t* hot = conveyor_create(&hot_cfg);
+    ASSERT_NE(hot, nullptr);
+    const size_t limit = in_use + 4096 + 64 * 1024;
+    conveyor_set_memory_budget(limit);
+
+    std::vector<char> data(200 * 1024, 'H');
+    ASSERT_EQ(conveyor_write(hot, data.data(), data.size()), (ssize_t)data.size());
+    EXPECT_LE(conveyor_memory_in_use(), limit);
+    ASSERT_EQ(conveyor_flush(hot), 0);
+    EXPECT_EQ(std::memcmp(hot_storage.data.data(), data.data(), data.size()), 0);
+
+    // The cold conveyor still works after giving its capacity up.
+    ASSERT_EQ(conveyor_write(cold, big.data(), 4096), 4096);
+    ASSERT_EQ(conveyor_flush(cold), 0);
+    conveyor_destroy(hot);
+    conveyor_destroy(cold);
+
+    // A higher-priority conveyor keeps its capacity; the lower-priority one
+    // stays at its initial size and applies backpressure instead.
+    conveyor_set_memory_budget(0);
+    cold_cfg.memory_priority = 1;
+    cold = conveyor_create(&cold_cfg);
+    ASSERT_NE(cold, nullptr);
+    ASSERT_EQ(conveyor_write(cold, big.data(), big.size()), (ssize_t)big.size());
+    ASSERT_EQ(conveyor_flush(cold), 0);
+    hot = conveyor_create(&hot_cfg);
+    ASSERT_NE(hot, nullptr);
+    in_use = conveyor_memory_in_use();
+    conveyor_set_memory_budget(in_use);
+    for (int i = 0; i < 16; ++i)
+        ASSERT_EQ(conveyor_write(hot, data.data(), 4096), 4096);
+    EXPECT_EQ(conveyor_memory_in_use(), in_use);
+    ASSERT_EQ(conveyor_flush(hot), 0);
+    conveyor_destroy(hot);
+    conveyor_destroy(cold);
+}
+
 // Test 3: Read Heuristic (Sequential Exhaustion)
 TEST_F(AdaptiveTest, ReadSequentialGrowth) {
     auto ops = mock->get_ops();
@@ -0,0 +1,74 @@
+#ifndef BACKEND_FIXTURE_HPP
+#define BACKEND_FIXTURE_HPP
+
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include "libconveyor/conveyor.h"
+
+// Base fixture for tests that run a conveyor over a storage backend: the
+// 64 KiB buffer shape they share and a byte pattern that does not repeat
+// every 256 bytes. The conveyor in 'conv' is destroyed after the test.
+class BackendTest : public ::testing::Test {
+protected:
+    conveyor_t* conv = nullptr;
+
+    void TearDown() override {
+        if (conv) conveyor_destroy(conv);
+        conv = nullptr;
+    }
+
+    static conveyor_config_t backend_config(storage_handle_t handle, const storage_operations_t& ops,
+                                            int flags) {
+        conveyor_config_t cfg = {0};
+        cfg.handle = handle;
+        cfg.flags = flags;
+        cfg.ops = ops;
+        cfg.initial_write_size = 64 * 1024;
+        cfg.initial_read_size = 64 * 1024;
+        cfg.max_write_size = 64 * 1024;
+        cfg.max_read_size = 64 * 1024;
+        return cfg;
+    }
+
+    static std::vector<char> pattern(size_t len) {
+        std::vector<char> v(len);
+        for (size_t i = 0; i < len; ++i) v[i] = static_cast<char>(i * 7 + (i >> 11));
+        return v;
+    }
+};
+
+// A BackendTest against a real temporary file ('path', open as 'fd').
+// Subclasses open 'handle' over it and supply the backend's operations and
+// close; the conveyor goes before the handle, and the file last.
+class TempFileTest : public BackendTest {
+protected:
+    char path[64];
+    int fd = -1;
+    storage_handle_t handle = nullptr;
+
+    virtual storage_operations_t backend_ops() const = 0;
+    virtual void close_backend() = 0;
+
+    void SetUp() override {
+        std::strcpy(path, "/tmp/conveyor_file_XXXXXX");
+        fd = mkstemp(path);
+        ASSERT_GE(fd, 0);
+    }
+
+    void TearDown() override {
+        BackendTest::TearDown();
+        if (handle) close_backend();
+        handle = nullptr;
+        if (fd >= 0) close(fd);
+        unlink(path);
+    }
+
+    virtual conveyor_config_t make_config(int flags) {
+        return backend_config(handle, backend_ops(), flags);
+    }
+};
+
+#endif // BACKEND_FIXTURE_HPP
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include "mock_storage.hpp"
+#include "libconveyor/codecs.h"
+#include "libconveyor/conveyor.h"
+
+#include <vector>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+// Run-length codec: (count, byte) pairs. Counts calls so tests can see
+// where the work happened.
+struct RleCodec {
+    std::atomic<int> compress_calls{0};
+    std::atomic<int> decompress_calls{0};
+
+    static ssize_t compress(void* ctx, const void* src, size_t len, void* dst, size_t cap) {
+        static_cast<RleCodec*>(ctx)->compress_calls++;
+        const unsigned char* in = static_cast<const unsigned char*>(src);
+        unsigned char* out = static_cast<unsigned char*>(dst);
+        size_t o = 0;
+        for (size_t i = 0; i < len;) {
+            size_t run = 1;
+            while (i + run < len && run < 255 && in[i + run] == in[i]) run++;
+            if (o + 2 > cap) return 0;
+            out[o++] = static_cast<unsigned char>(run);
+            out[o++] = in[i];
+            i += run;
+        }
+        return static_cast<ssize_t>(o);
+    }
+
+    static ssize_t decompress(void* ctx, const void* src, size_t len, void* dst, size_t cap) {
+        static_cast<RleCodec*>(ctx)->decompress_calls++;
+        const unsigned char* in = static_cast<const unsigned char*>(src);
+        unsigned char* out = static_cast<unsigned char*>(dst);
+        size_t o = 0;
+        for (size_t i = 0; i + 1 < len; i += 2) {
+            if (o + in[i] > cap) {
+                errno = EIO;
+                return -1;
+            }
+            std::memset(out + o, in[i + 1], in[i]);
+            o += in[i];
+        }
+        return static_cast<ssize_t>(o);
+    }
+
+    conveyor_codec_t codec() { return {compress, decompress, this}; }
+};
+
+class ConveyorCodecTest : public ::testing::Test {
+protected:
+    static constexpr size_t kBlock = 4096;
+    MockStorage* mock;
+    RleCodec rle;
+    conveyor_t* conv;
+
+    void SetUp() override {
+        mock = new MockStorage(0);
+        conv = nullptr;
+    }
+
+    void TearDown() override {
+        if (conv) conveyor_destroy(conv);
+        delete mock;
+    }
+
+    conveyor_config_t make_config() {
+        conveyor_config_t cfg = {0};
+        cfg.handle = mock;
+        cfg.flags = O_RDWR;
+        cfg.ops = mock->get_ops();
+        cfg.initial_write_size = 64 * 1024;
+        cfg.max_write_size = 64 * 1024;
+        cfg.initial_read_size = 64 * 1024;
+        cfg.max_read_size = 64 * 1024;
+        cfg.codec = rle.codec();
+        cfg.codec_block_size = kBlock;
+        return cfg;
+    }
+
+    void reopen() {
+        conveyor_destroy(conv);
+        auto cfg = make_config();
+        conv = conveyor_create(&cfg);
+        ASSERT_NE(conv, nullptr);
+    }
+};
+
+// Long runs of one byte: packs to a few bytes per block.
+static std::vector<char> make_runs(size_t len) {
+    std::vector<char> data(len);
+    for (size_t i = 0; i < len; ++i) data[i] = static_cast<char>('a' + (i / 1000) % 26);
+    return data;
+}
+
+TEST_F(ConveyorCodecTest, SequentialWritesArePackedAndReadBack) {
+    auto cfg = make_config();
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto data = make_runs(10 * kBlock + 123);
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    EXPECT_GT(rle.compress_calls.load(), 0);
+
+    // Only headers and packed bytes crossed to storage.
+    EXPECT_LT(mock->bytes_written.load(), data.size() / 10);
+
+    reopen();
+    EXPECT_EQ(conveyor_lseek(conv, 0, SEEK_END), (off_t)data.size());
+    ASSERT_EQ(conveyor_lseek(conv, 0, SEEK_SET), 0);
+    std::vector<char> out(data.size());
+    size_t got = 0;
+    while (got < out.size()) {
+        ssize_t n = conveyor_read(conv, out.data() + got, out.size() - got);
+        ASSERT_GT(n, 0);
+        got += n;
+    }
+    EXPECT_EQ(out, data);
+    EXPECT_EQ(conveyor_read(conv, out.data(), 1), 0);
+}
+
+TEST_F(ConveyorCodecTest, PartialBlockWritesPatchExistingBlocks) {
+    auto cfg = make_config();
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto expected = make_runs(4 * kBlock);
+    ASSERT_EQ(conveyor_pwrite(conv, expected.data(), expected.size(), 0), (ssize_t)expected.size());
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    // Unaligned and incompressible, straddling a block boundary.
+    std::srand(7);
+    std::vector<char> noise(3000);
+    for (auto& c : noise) c = static_cast<char>(std::rand());
+    off_t at = kBlock - 1000;
+    ASSERT_EQ(conveyor_pwrite(conv, noise.data(), noise.size(), at), (ssize_t)noise.size());
+    std::memcpy(expected.data() + at, noise.data(), noise.size());
+    // Past the end, leaving a hole that reads back as zeros.
+    ASSERT_EQ(conveyor_pwrite(conv, "tail", 4, 6 * kBlock + 10), 4);
+    expected.resize(6 * kBlock + 14, 0);
+    std::memcpy(expected.data() + 6 * kBlock + 10, "tail", 4);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    reopen();
+    std::vector<char> out(expected.size() + 100);
+    size_t got = 0;
+    while (got < out.size()) {
+        ssize_t n = conveyor_pread(conv, out.data() + got, out.size() - got, got);
+        ASSERT_GE(n, 0);
+        if (n == 0) break;
+        got += n;
+    }
+    ASSERT_EQ(got, expected.size());
+    out.resize(got);
+    EXPECT_EQ(out, expected);
+}
+
+TEST_F(ConveyorCodecTest, RejectsMismatchedStorageAndCodec) {
+    auto cfg = make_config();
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    auto data = make_runs(kBlock);
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    conveyor_destroy(conv);
+    conv = nullptr;
+
+    // Written with another block size.
+    cfg.codec_block_size = 2 * kBlock;
+    errno = 0;
+    EXPECT_EQ(conveyor_create(&cfg), nullptr);
+    EXPECT_EQ(errno, EIO);
+
+    // Half a codec.
+    cfg.codec_block_size = kBlock;
+    cfg.codec.decompress = nullptr;
+    errno = 0;
+    EXPECT_EQ(conveyor_create(&cfg), nullptr);
+    EXPECT_EQ(errno, EINVAL);
+}
+
+TEST_F(ConveyorCodecTest, BuiltInCodecsRoundTripWhenAvailable) {
+    conveyor_codec_t codecs[2];
+    int errors[2] = {0, 0};
+    if (conveyor_codec_lz4(&codecs[0]) != 0) errors[0] = errno;
+    if (conveyor_codec_zstd(3, &codecs[1]) != 0) errors[1] = errno;
+    for (int i = 0; i < 2; ++i) {
+        if (errors[i] != 0) {
+            EXPECT_EQ(errors[i], ENOSYS); // Built without the library
+            continue;
+        }
+        MockStorage storage(0);
+        auto cfg = make_config();
+        cfg.handle = &storage;
+        cfg.ops = storage.get_ops();
+        cfg.codec = codecs[i];
+        conveyor_t* c = conveyor_create(&cfg);
+        ASSERT_NE(c, nullptr);
+        auto data = make_runs(3 * kBlock + 5);
+        ASSERT_EQ(conveyor_pwrite(c, data.data(), data.size(), 0), (ssize_t)data.size());
+        std::vector<char> out(data.size());
+        ASSERT_EQ(conveyor_flush(c), 0);
+        ASSERT_EQ(conveyor_pread(c, out.data(), out.size(), 0), (ssize_t)out.size());
+        EXPECT_EQ(out, data);
+        conveyor_destroy(c);
+    }
+}
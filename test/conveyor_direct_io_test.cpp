@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+#include "backend_fixture.hpp"
+#include "mock_storage.hpp"
+#include "libconveyor/conveyor.h"
+#include "libconveyor/io_uring_backend.h"
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+// MockStorage that insists on O_DIRECT rules: every offset, length and
+// buffer must be a multiple of kBlock. Violations are counted, not served.
+struct AlignedMock : MockStorage {
+    static constexpr size_t kBlock = 512;
+    std::atomic<int> misaligned{0};
+    std::atomic<int> truncate_calls{0};
+
+    AlignedMock() : MockStorage(0) {}
+
+    bool check(const void* buf, size_t count, off_t offset) {
+        bool ok = reinterpret_cast<uintptr_t>(buf) % kBlock == 0 && count % kBlock == 0 &&
+                  offset % kBlock == 0;
+        if (!ok) misaligned++;
+        return ok;
+    }
+
+    static AlignedMock* self(storage_handle_t h) { return static_cast<AlignedMock*>(h); }
+
+    static ssize_t pwrite(storage_handle_t h, const void* buf, size_t count, off_t offset) {
+        if (!self(h)->check(buf, count, offset)) { errno = EINVAL; return -1; }
+        return pwrite_callback(h, buf, count, offset);
+    }
+    static ssize_t pread(storage_handle_t h, void* buf, size_t count, off_t offset) {
+        if (!self(h)->check(buf, count, offset)) { errno = EINVAL; return -1; }
+        return pread_callback(h, buf, count, offset);
+    }
+    static ssize_t pwritev(storage_handle_t h, const conveyor_iovec_t* iov, int iovcnt, off_t offset) {
+        for (int i = 0; i < iovcnt; ++i) {
+            if (!self(h)->check(iov[i].iov_base, iov[i].iov_len, offset)) { errno = EINVAL; return -1; }
+        }
+        return pwritev_callback(h, iov, iovcnt, offset);
+    }
+    static int truncate(storage_handle_t h, off_t length) {
+        auto* m = self(h);
+        std::lock_guard<std::mutex> lock(m->mx);
+        m->truncate_calls++;
+        m->data.resize(length);
+        return 0;
+    }
+
+    storage_operations_t ops() {
+        storage_operations_t o = {};
+        o.pwrite = pwrite;
+        o.pread = pread;
+        o.lseek = lseek_callback;
+        o.pwritev = pwritev;
+        o.truncate = truncate;
+        return o;
+    }
+};
+
+class ConveyorDirectIoTest : public BackendTest {
+protected:
+    AlignedMock mock;
+
+    conveyor_config_t make_config(int flags) {
+        conveyor_config_t cfg = backend_config(&mock, mock.ops(), flags);
+        cfg.initial_read_size = 60 * 1000; // Rounded up to whole blocks
+        cfg.max_read_size = 60 * 1000;
+        cfg.max_coalesce_size = 64 * 1024;
+        cfg.direct_io_block_size = AlignedMock::kBlock;
+        return cfg;
+    }
+};
+
+TEST_F(ConveyorDirectIoTest, UnalignedStreamReachesStorageAligned) {
+    auto cfg = make_config(O_WRONLY);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto data = pattern(200 * 1000 + 17);
+    for (size_t off = 0; off < data.size(); off += 1000) {
+        size_t len = std::min<size_t>(1000, data.size() - off);
+        ASSERT_EQ(conveyor_write(conv, data.data() + off, len), (ssize_t)len);
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    EXPECT_EQ(mock.misaligned.load(), 0);
+    EXPECT_EQ(conveyor_lseek(conv, 0, SEEK_END), (off_t)data.size());
+
+    // The padding past the end was trimmed once the writes were done.
+    EXPECT_GT(mock.truncate_calls.load(), 0);
+    EXPECT_EQ(mock.data, data);
+}
+
+TEST_F(ConveyorDirectIoTest, RandomWritesAndReadsStayAligned) {
+    auto expected = pattern(40 * 1024);
+    mock.data = expected;
+    auto cfg = make_config(O_RDWR);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    std::srand(11);
+    for (int i = 0; i < 200; ++i) {
+        size_t len = 1 + std::rand() % 3000;
+        off_t at = std::rand() % (expected.size() - len);
+        std::vector<char> buf(len, static_cast<char>('a' + i % 26));
+        ASSERT_EQ(conveyor_pwrite(conv, buf.data(), len, at), (ssize_t)len);
+        std::memcpy(expected.data() + at, buf.data(), len);
+        if (i % 20 == 0) {
+            ASSERT_EQ(conveyor_flush(conv), 0);
+        }
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    for (int i = 0; i < 50; ++i) {
+        size_t len = 1 + std::rand() % 5000;
+        off_t at = std::rand() % (expected.size() - len);
+        std::vector<char> out(len);
+        ASSERT_EQ(conveyor_pread(conv, out.data() + 0, len, at), (ssize_t)len);
+        ASSERT_EQ(0, std::memcmp(out.data(), expected.data() + at, len)) << "at " << at;
+    }
+    EXPECT_EQ(mock.misaligned.load(), 0);
+    EXPECT_EQ(mock.data, expected);
+}
+
+TEST_F(ConveyorDirectIoTest, ReadAheadAfterUnalignedSeek) {
+    auto data = pattern(300 * 1024 + 123);
+    mock.data = data;
+    auto cfg = make_config(O_RDONLY);
+    cfg.read_chunk_size = 5000;
+    cfg.read_ahead_depth = 3;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    ASSERT_EQ(conveyor_lseek(conv, 777, SEEK_SET), 777);
+    std::vector<char> out;
+    char buf[3333];
+    ssize_t n;
+    while ((n = conveyor_read(conv, buf, sizeof(buf))) > 0) out.insert(out.end(), buf, buf + n);
+    ASSERT_EQ(n, 0);
+    EXPECT_EQ(out, std::vector<char>(data.begin() + 777, data.end()));
+    EXPECT_EQ(mock.misaligned.load(), 0);
+}
+
+TEST_F(ConveyorDirectIoTest, RejectsUnsupportedBlockSizes) {
+    auto cfg = make_config(O_RDWR);
+    for (size_t bs : {size_t(3000), size_t(8192)}) {
+        cfg.direct_io_block_size = bs;
+        errno = 0;
+        EXPECT_EQ(conveyor_create(&cfg), nullptr);
+        EXPECT_EQ(errno, EINVAL);
+    }
+}
+
+// Against a real O_DIRECT file, where the filesystem supports one.
+TEST_F(ConveyorDirectIoTest, RealDirectFileRoundTrip) {
+    char path[] = "/var/tmp/conveyor_direct_XXXXXX";
+    int tmp = mkstemp(path);
+    if (tmp < 0) GTEST_SKIP() << "no scratch directory";
+    close(tmp);
+    int fd = ::open(path, O_RDWR | O_DIRECT);
+    if (fd < 0) {
+        unlink(path);
+        GTEST_SKIP() << "O_DIRECT unsupported here: " << std::strerror(errno);
+    }
+    storage_handle_t handle = conveyor_uring_open(fd, 4);
+    if (!handle) {
+        close(fd);
+        unlink(path);
+        GTEST_SKIP() << "io_uring unavailable";
+    }
+    auto cfg = make_config(O_RDWR);
+    cfg.handle = handle;
+    cfg.ops = conveyor_uring_ops();
+    cfg.direct_io_block_size = 4096;
+    conveyor_t* c = conveyor_create(&cfg);
+    ASSERT_NE(c, nullptr);
+
+    auto data = pattern(100 * 1000 + 3);
+    for (size_t off = 0; off < data.size(); off += 999) {
+        size_t len = std::min<size_t>(999, data.size() - off);
+        ASSERT_EQ(conveyor_write(c, data.data() + off, len), (ssize_t)len);
+    }
+    ASSERT_EQ(conveyor_lseek(c, 0, SEEK_SET), 0);
+    std::vector<char> out(data.size() + 10);
+    size_t got = 0;
+    ssize_t n;
+    while ((n = conveyor_read(c, out.data() + got, out.size() - got)) > 0) got += n;
+    EXPECT_EQ(n, 0);
+    out.resize(got);
+    EXPECT_EQ(out, data);
+    conveyor_destroy(c);
+    conveyor_uring_close(handle);
+    EXPECT_EQ(::lseek(fd, 0, SEEK_END), (off_t)data.size());
+    close(fd);
+    unlink(path);
+}
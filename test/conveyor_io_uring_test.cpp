@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include "backend_fixture.hpp"
+#include "libconveyor/conveyor.h"
+#include "libconveyor/io_uring_backend.h"
+
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+// --- Test Fixture ---
+// Runs the conveyor against a real temporary file through the io_uring
+// backend. Skips when the kernel (or the build) has no io_uring.
+class ConveyorIoUringTest : public TempFileTest {
+protected:
+    void SetUp() override {
+        TempFileTest::SetUp();
+        if (HasFatalFailure()) return;
+        handle = conveyor_uring_open(fd, 8);
+        if (!handle) GTEST_SKIP() << "io_uring unavailable: " << std::strerror(errno);
+    }
+
+    storage_operations_t backend_ops() const override { return conveyor_uring_ops(); }
+    void close_backend() override { conveyor_uring_close(handle); }
+};
+
+TEST_F(ConveyorIoUringTest, WritesReachTheFile) {
+    auto cfg = make_config(O_WRONLY);
+    cfg.write_queue_depth = 4;
+    cfg.max_coalesce_size = 16 * 1024;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto data = pattern(512 * 1024);
+    for (size_t off = 0; off < data.size(); off += 3000) {
+        size_t len = std::min<size_t>(3000, data.size() - off);
+        ASSERT_EQ(conveyor_write(conv, data.data() + off, len), (ssize_t)len);
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    conveyor_stats_t stats;
+    conveyor_get_stats(conv, &stats);
+    EXPECT_EQ(stats.last_error_code, 0);
+    EXPECT_EQ(stats.bytes_written, data.size());
+
+    std::vector<char> out(data.size());
+    ASSERT_EQ(::pread(fd, out.data(), out.size(), 0), (ssize_t)out.size());
+    EXPECT_EQ(out, data);
+}
+
+TEST_F(ConveyorIoUringTest, ReadAheadStreamsTheFile) {
+    auto data = pattern(300 * 1024 + 123);
+    ASSERT_EQ(::pwrite(fd, data.data(), data.size(), 0), (ssize_t)data.size());
+
+    auto cfg = make_config(O_RDONLY);
+    cfg.read_chunk_size = 8 * 1024;
+    cfg.read_ahead_depth = 4;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    std::vector<char> out;
+    char buf[5000];
+    ssize_t n;
+    while ((n = conveyor_read(conv, buf, sizeof(buf))) > 0) {
+        out.insert(out.end(), buf, buf + n);
+    }
+    ASSERT_EQ(n, 0);
+    EXPECT_EQ(out, data);
+}
+
+TEST_F(ConveyorIoUringTest, ReadWriteWithSeek) {
+    auto cfg = make_config(O_RDWR);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto data = pattern(40 * 1024);
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    ASSERT_EQ(conveyor_lseek(conv, 4096, SEEK_SET), 4096);
+
+    std::vector<char> out(16 * 1024);
+    size_t total = 0;
+    while (total < out.size()) {
+        ssize_t got = conveyor_read(conv, out.data() + total, out.size() - total);
+        ASSERT_GT(got, 0);
+        total += got;
+    }
+    EXPECT_EQ(0, std::memcmp(out.data(), data.data() + 4096, out.size()));
+}
+
+// Forwards to the io_uring backend, failing the next 'fail_write_reaps'
+// write reaps outright, as a backend that briefly lost its ring would.
+struct FlakyReap {
+    storage_handle_t inner;
+    storage_operations_t ops = conveyor_uring_ops();
+    std::atomic<int> fail_write_reaps{0};
+    std::atomic<int> submitted{0};
+    std::atomic<int> reaped{0};
+
+    static FlakyReap* self(storage_handle_t h) { return static_cast<FlakyReap*>(h); }
+
+    static ssize_t pwrite(storage_handle_t h, const void* buf, size_t n, off_t off) {
+        return self(h)->ops.pwrite(self(h)->inner, buf, n, off);
+    }
+    static ssize_t pread(storage_handle_t h, void* buf, size_t n, off_t off) {
+        return self(h)->ops.pread(self(h)->inner, buf, n, off);
+    }
+    static off_t lseek(storage_handle_t h, off_t off, int whence) {
+        return self(h)->ops.lseek(self(h)->inner, off, whence);
+    }
+    static int submit(storage_handle_t h, int queue, int op, const conveyor_iovec_t* iov, int iovcnt,
+                      off_t off, unsigned long long user_data) {
+        int r = self(h)->ops.submit(self(h)->inner, queue, op, iov, iovcnt, off, user_data);
+        if (r == 0 && queue == CONVEYOR_QUEUE_WRITE) self(h)->submitted++;
+        return r;
+    }
+    static int reap(storage_handle_t h, int queue, conveyor_completion_t* out, int max, int min) {
+        if (queue == CONVEYOR_QUEUE_WRITE && self(h)->fail_write_reaps.load() > 0) {
+            self(h)->fail_write_reaps--;
+            errno = EIO;
+            return -1;
+        }
+        int n = self(h)->ops.reap(self(h)->inner, queue, out, max, min);
+        if (n > 0 && queue == CONVEYOR_QUEUE_WRITE) self(h)->reaped += n;
+        return n;
+    }
+
+    storage_operations_t wrapped() const {
+        storage_operations_t o = {};
+        o.pwrite = pwrite;
+        o.pread = pread;
+        o.lseek = lseek;
+        o.submit = submit;
+        o.reap = reap;
+        return o;
+    }
+};
+
+// A failed reap sets the sticky error but retires nothing: the kernel may
+// still be reading those ring bytes. The writes complete on a later reap,
+// and every one is reaped before conveyor_destroy returns.
+TEST_F(ConveyorIoUringTest, FailedReapKeepsWritesInFlight) {
+    FlakyReap flaky;
+    flaky.inner = handle;
+    auto cfg = make_config(O_WRONLY);
+    cfg.handle = &flaky;
+    cfg.ops = flaky.wrapped();
+    cfg.write_queue_depth = 4;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    flaky.fail_write_reaps = 3;
+    auto data = pattern(64 * 1024);
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    EXPECT_EQ(conveyor_flush(conv), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EIO);
+    EXPECT_EQ(conveyor_write(conv, data.data(), 100), LIBCONVEYOR_ERROR); // Sticky
+    conveyor_destroy(conv);
+    conv = nullptr;
+
+    EXPECT_EQ(flaky.fail_write_reaps.load(), 0);
+    EXPECT_GT(flaky.submitted.load(), 0);
+    EXPECT_EQ(flaky.reaped.load(), flaky.submitted.load());
+    std::vector<char> out(data.size());
+    ASSERT_EQ(::pread(fd, out.data(), out.size(), 0), (ssize_t)out.size());
+    EXPECT_EQ(out, data);
+}
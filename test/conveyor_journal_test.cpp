@@ -0,0 +1,237 @@
+#include <gtest/gtest.h>
+#include "mock_storage.hpp"
+#include "libconveyor/conveyor.h"
+
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// --- Test Fixture ---
+class ConveyorJournalTest : public ::testing::Test {
+protected:
+    MockStorage mock{0};
+    std::string path;
+
+    void SetUp() override {
+        char name[] = "/tmp/conveyor_journal_XXXXXX";
+        int fd = mkstemp(name);
+        ASSERT_GE(fd, 0);
+        close(fd);
+        path = name;
+    }
+
+    void TearDown() override { unlink(path.c_str()); }
+
+    conveyor_config_t make_config(MockStorage& m, size_t write_size) {
+        conveyor_config_t cfg = {0};
+        cfg.handle = &m;
+        cfg.flags = O_WRONLY;
+        cfg.ops = m.get_ops();
+        cfg.initial_write_size = write_size;
+        cfg.max_write_size = write_size;
+        cfg.journal_path = path.c_str();
+        return cfg;
+    }
+
+    static std::vector<char> pattern(size_t len, int seed) {
+        std::vector<char> v(len);
+        for (size_t i = 0; i < len; ++i) v[i] = static_cast<char>(i * 13 + seed);
+        return v;
+    }
+};
+
+TEST_F(ConveyorJournalTest, CleanShutdownLeavesNothingToRecover) {
+    auto cfg = make_config(mock, 64 * 1024);
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    auto data = pattern(10000, 1);
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    conveyor_destroy(conv);
+    EXPECT_EQ(mock.data, data);
+
+    EXPECT_EQ(conveyor_recover(&cfg), 0);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    conveyor_destroy(conv);
+}
+
+TEST_F(ConveyorJournalTest, RejectsBadConfigurations) {
+    auto cfg = make_config(mock, 64 * 1024);
+    cfg.journal_size = 1024; // Smaller than one full-buffer write
+    errno = 0;
+    EXPECT_EQ(conveyor_create(&cfg), nullptr);
+    EXPECT_EQ(errno, EINVAL);
+
+    cfg = make_config(mock, 0); // No write buffer to journal
+    errno = 0;
+    EXPECT_EQ(conveyor_create(&cfg), nullptr);
+    EXPECT_EQ(errno, EINVAL);
+
+    cfg = make_config(mock, 64 * 1024);
+    conveyor_t* first = conveyor_create(&cfg);
+    ASSERT_NE(first, nullptr);
+    errno = 0;
+    EXPECT_EQ(conveyor_create(&cfg), nullptr);
+    EXPECT_EQ(errno, EBUSY);
+    conveyor_destroy(first);
+
+    cfg.journal_path = nullptr;
+    EXPECT_EQ(conveyor_recover(&cfg), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EINVAL);
+}
+
+// Appends only get their offset when issued, so journal mode refuses
+// O_APPEND rather than record an offset the bytes will not land at.
+TEST_F(ConveyorJournalTest, RejectsAppendMode) {
+    mock.data.assign(1000, 'o');
+    auto cfg = make_config(mock, 64 * 1024);
+    cfg.flags = O_WRONLY | O_APPEND;
+    errno = 0;
+    EXPECT_EQ(conveyor_create(&cfg), nullptr);
+    EXPECT_EQ(errno, EINVAL);
+    errno = 0;
+    EXPECT_EQ(conveyor_recover(&cfg), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EINVAL);
+
+    // Nothing was journaled or written; a plain conveyor still appends.
+    cfg.journal_path = nullptr;
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    ASSERT_EQ(conveyor_write(conv, "tail", 4), 4);
+    conveyor_destroy(conv);
+    EXPECT_EQ(std::string(mock.data.begin(), mock.data.end()), std::string(1000, 'o') + "tail");
+}
+
+// The process dies with writes acknowledged but not yet on the backend;
+// they come back from the journal, synced or not.
+TEST_F(ConveyorJournalTest, RecoversWritesLostWithTheProcess) {
+    auto first = pattern(20000, 3), second = pattern(5000, 7);
+    for (int no_sync : {0, 1}) {
+        SCOPED_TRACE(no_sync ? "journal_no_sync" : "synced");
+        pid_t child = fork();
+        ASSERT_GE(child, 0);
+        if (child == 0) {
+            MockStorage stuck(0);
+            stuck.write_delay_ms = 60 * 1000; // Nothing reaches the backend
+            auto cfg = make_config(stuck, 64 * 1024);
+            cfg.journal_no_sync = no_sync;
+            conveyor_t* conv = conveyor_create(&cfg);
+            if (!conv) _exit(1);
+            if (conveyor_write(conv, first.data(), first.size()) != (ssize_t)first.size()) _exit(2);
+            if (conveyor_pwrite(conv, second.data(), second.size(), 100000) != (ssize_t)second.size()) _exit(3);
+            if (conveyor_pwrite(conv, "HEAD", 4, 0) != 4) _exit(4);
+            _exit(0); // No destroy, no flush
+        }
+        int status = 0;
+        ASSERT_EQ(waitpid(child, &status, 0), child);
+        ASSERT_TRUE(WIFEXITED(status));
+        ASSERT_EQ(WEXITSTATUS(status), 0);
+
+        mock.data.clear();
+        auto cfg = make_config(mock, 64 * 1024);
+        errno = 0;
+        EXPECT_EQ(conveyor_create(&cfg), nullptr);
+        EXPECT_EQ(errno, EEXIST);
+
+        ASSERT_EQ(conveyor_recover(&cfg), 3);
+        std::vector<char> expected(100000 + second.size(), 0);
+        std::memcpy(expected.data(), first.data(), first.size());
+        std::memcpy(expected.data() + 100000, second.data(), second.size());
+        std::memcpy(expected.data(), "HEAD", 4);
+        EXPECT_EQ(mock.data, expected);
+
+        // Replayed once; the journal is usable again.
+        EXPECT_EQ(conveyor_recover(&cfg), 0);
+        conveyor_t* conv = conveyor_create(&cfg);
+        ASSERT_NE(conv, nullptr);
+        conveyor_destroy(conv);
+    }
+}
+
+// Many more records than the journal holds at once, so it wraps round
+// several times; a backend failure then leaves the tail of the stream in
+// it, and recovery completes the file.
+TEST_F(ConveyorJournalTest, KeepsRecordsAcrossWrapAndBackendError) {
+    auto cfg = make_config(mock, 4096);
+    cfg.max_coalesce_size = 4096;
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    std::vector<char> expected;
+    for (int i = 0; i < 300; ++i) {
+        auto chunk = pattern(100 + i % 50, i);
+        if (i == 250) {
+            ASSERT_EQ(conveyor_flush(conv), 0);
+            mock.write_delay_ms = 20;
+            mock.next_write_error = EIO;
+        }
+        ssize_t n = conveyor_write(conv, chunk.data(), chunk.size());
+        if (n < 0) break; // The failure is sticky
+        ASSERT_EQ(n, (ssize_t)chunk.size());
+        expected.insert(expected.end(), chunk.begin(), chunk.end());
+    }
+    EXPECT_EQ(conveyor_flush(conv), LIBCONVEYOR_ERROR);
+    conveyor_destroy(conv);
+
+    mock.write_delay_ms = 0;
+    EXPECT_GT(conveyor_recover(&cfg), 0);
+    EXPECT_EQ(mock.data, expected);
+}
+
+// Clearing the error would let later retires drop records that were never
+// written, so it is refused; the writes that follow fail as before and
+// recovery still completes the file.
+TEST_F(ConveyorJournalTest, ClearErrorRefusedWhileRecordsAreKept) {
+    auto cfg = make_config(mock, 64 * 1024);
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto first = pattern(3000, 5), second = pattern(2000, 9);
+    ASSERT_EQ(conveyor_write(conv, first.data(), first.size()), (ssize_t)first.size());
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    mock.next_write_error = EIO;
+    ASSERT_EQ(conveyor_write(conv, second.data(), second.size()), (ssize_t)second.size());
+    EXPECT_EQ(conveyor_flush(conv), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EIO);
+
+    errno = 0;
+    EXPECT_EQ(conveyor_clear_error(conv), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EBUSY);
+    auto third = pattern(1000, 11);
+    EXPECT_EQ(conveyor_write(conv, third.data(), third.size()), LIBCONVEYOR_ERROR);
+    conveyor_destroy(conv);
+
+    ASSERT_EQ(conveyor_recover(&cfg), 1);
+    std::vector<char> expected = first;
+    expected.insert(expected.end(), second.begin(), second.end());
+    EXPECT_EQ(mock.data, expected);
+}
+
+// Small writes fill the journal long before the ring: FAIL backpressure
+// reports it, and the writes still all land once the backend catches up.
+TEST_F(ConveyorJournalTest, JournalSpaceAppliesBackpressure) {
+    auto cfg = make_config(mock, 4096);
+    cfg.journal_size = 4096 + 64;
+    cfg.write_backpressure = CONVEYOR_BACKPRESSURE_FAIL;
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock.write_delay_ms = 100;
+    int accepted = 0;
+    errno = 0;
+    for (int i = 0; i < 4096; ++i) {
+        if (conveyor_write(conv, "x", 1) != 1) break;
+        accepted++;
+    }
+    EXPECT_EQ(errno, EAGAIN);
+    EXPECT_GT(accepted, 50);
+    EXPECT_LT(accepted, 200); // 40 journal bytes a record, 1 of ring
+    mock.write_delay_ms = 0;
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    EXPECT_EQ(mock.data, std::vector<char>(accepted, 'x'));
+    conveyor_destroy(conv);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include "backend_fixture.hpp"
+#include "libconveyor/conveyor.h"
+#include "libconveyor/mmap_backend.h"
+
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+// --- Test Fixture ---
+// Runs the conveyor against a real temporary file through the mmap backend.
+class ConveyorMmapTest : public TempFileTest {
+protected:
+    storage_operations_t backend_ops() const override { return conveyor_mmap_ops(); }
+    void close_backend() override { conveyor_mmap_close(handle); }
+
+    // Opens the backend over whatever the file holds by now.
+    conveyor_config_t make_config(int flags) override {
+        handle = conveyor_mmap_open(fd, 0);
+        EXPECT_NE(handle, nullptr) << std::strerror(errno);
+        return TempFileTest::make_config(flags);
+    }
+};
+
+TEST_F(ConveyorMmapTest, ReadsStreamFromTheMappingWithoutABuffer) {
+    auto data = pattern(300 * 1024 + 123);
+    ASSERT_EQ(::pwrite(fd, data.data(), data.size(), 0), (ssize_t)data.size());
+
+    size_t before = conveyor_memory_in_use();
+    auto cfg = make_config(O_RDONLY);
+    ASSERT_NE(handle, nullptr);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    EXPECT_EQ(conveyor_memory_in_use(), before);
+
+    std::vector<char> out;
+    char buf[5000];
+    ssize_t n;
+    while ((n = conveyor_read(conv, buf, sizeof(buf))) > 0) {
+        out.insert(out.end(), buf, buf + n);
+    }
+    ASSERT_EQ(n, 0);
+    EXPECT_EQ(out, data);
+
+    std::vector<char> tail(1000);
+    EXPECT_EQ(conveyor_pread(conv, tail.data(), tail.size(), data.size() - 100), 100);
+    EXPECT_EQ(0, std::memcmp(tail.data(), data.data() + data.size() - 100, 100));
+    EXPECT_EQ(conveyor_pread(conv, tail.data(), tail.size(), data.size() + 5), 0);
+}
+
+TEST_F(ConveyorMmapTest, ReadViewLendsTheMappedPages) {
+    auto data = pattern(64 * 1024);
+    ASSERT_EQ(::pwrite(fd, data.data(), data.size(), 0), (ssize_t)data.size());
+    auto cfg = make_config(O_RDONLY);
+    ASSERT_NE(handle, nullptr);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    conveyor_iovec_t segs[2];
+    int nsegs = 0;
+    ASSERT_EQ(conveyor_read_acquire(conv, data.size(), segs, &nsegs), (ssize_t)data.size());
+    ASSERT_EQ(nsegs, 1);
+    EXPECT_EQ(0, std::memcmp(segs[0].iov_base, data.data(), data.size()));
+
+    // The view is the file: a write made behind the conveyor's back shows.
+    ASSERT_EQ(::pwrite(fd, "XYZ", 3, 10), 3);
+    EXPECT_EQ(0, std::memcmp(static_cast<char*>(segs[0].iov_base) + 10, "XYZ", 3));
+
+    char c;
+    EXPECT_EQ(conveyor_read(conv, &c, 1), -1);
+    EXPECT_EQ(errno, EBUSY);
+    ASSERT_EQ(conveyor_read_release(conv, 1000), 0);
+    ASSERT_EQ(conveyor_read(conv, &c, 1), 1);
+    EXPECT_EQ(c, data[1000]);
+}
+
+TEST_F(ConveyorMmapTest, SeesItsOwnWritesAsTheFileGrows) {
+    auto cfg = make_config(O_RDWR);
+    ASSERT_NE(handle, nullptr);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    // Still pending: snooped from the write buffer.
+    auto data = pattern(40 * 1024);
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    std::vector<char> out(data.size());
+    ASSERT_EQ(conveyor_pread(conv, out.data(), out.size(), 0), (ssize_t)out.size());
+    EXPECT_EQ(out, data);
+
+    conveyor_iovec_t segs[2];
+    int nsegs = 0;
+    ASSERT_EQ(conveyor_lseek(conv, 0, SEEK_SET), 0);
+    ASSERT_EQ(conveyor_write(conv, "head", 4), 4);
+    ASSERT_EQ(conveyor_lseek(conv, 0, SEEK_SET), 0);
+    std::memcpy(data.data(), "head", 4);
+    ASSERT_EQ(conveyor_pwrite(conv, "mid", 3, 100), 3);
+    std::memcpy(data.data() + 100, "mid", 3);
+    ssize_t n = conveyor_read_acquire(conv, data.size(), segs, &nsegs);
+    ASSERT_EQ(n, (ssize_t)data.size());
+    EXPECT_EQ(0, std::memcmp(segs[0].iov_base, data.data(), data.size()));
+    ASSERT_EQ(conveyor_read_release(conv, n), 0);
+
+    // Flushed: the mapping follows the file past where it ended at open.
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    ASSERT_EQ(conveyor_lseek(conv, 0, SEEK_SET), 0);
+    size_t total = 0;
+    while (total < out.size()) {
+        ssize_t got = conveyor_read(conv, out.data() + total, out.size() - total);
+        ASSERT_GT(got, 0);
+        total += got;
+    }
+    EXPECT_EQ(out, data);
+}
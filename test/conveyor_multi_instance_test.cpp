@@ -7,17 +7,29 @@
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <memory>
+#include <string>
+#include <fstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 // --- Mock Storage Backend ---
 class MockStorage {
 public:
     std::vector<char> data;
     std::mutex mx;
+    std::atomic<int> write_delay_ms{0};
 
     MockStorage(size_t size) : data(size, 0) {}
 
     static ssize_t pwrite_callback(storage_handle_t h, const void* buf, size_t count, off_t offset) {
         auto* self = static_cast<MockStorage*>(h);
+        if (self->write_delay_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(self->write_delay_ms));
         std::lock_guard<std::mutex> lock(self->mx);
         if (offset + count > self->data.size()) {
             self->data.resize(offset + count);
@@ -118,3 +130,230 @@ TEST_F(ConveyorMultiInstanceTest, OverlappingWrites) {
     }
     ASSERT_TRUE(all_A || all_B);
 }
+
+#ifdef __linux__
+static int current_thread_count() {
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    while (status >> key) {
+        if (key == "Threads:") {
+            int n = 0;
+            status >> n;
+            return n;
+        }
+    }
+    return -1;
+}
+#endif
+
+// 10k open conveyors on a 4-thread executor: no per-instance threads, and
+// every instance still writes and reads back its own data.
+TEST(ConveyorExecutorTest, TenThousandInstancesShareFourThreads) {
+    const size_t instances = 10000;
+    conveyor_executor_t* executor = conveyor_executor_create(4);
+    ASSERT_NE(executor, nullptr);
+
+    std::vector<std::unique_ptr<MockStorage>> storage;
+    std::vector<conveyor_t*> convs;
+    for (size_t i = 0; i < instances; ++i) {
+        storage.emplace_back(new MockStorage(0));
+        conveyor_config_t cfg = {0};
+        cfg.handle = storage.back().get();
+        cfg.flags = O_RDWR;
+        cfg.ops = storage.back()->get_ops();
+        cfg.initial_write_size = 256;
+        cfg.initial_read_size = 256;
+        cfg.executor = executor;
+        conveyor_t* conv = conveyor_create(&cfg);
+        ASSERT_NE(conv, nullptr);
+        convs.push_back(conv);
+    }
+#ifdef __linux__
+    EXPECT_LT(current_thread_count(), 16);
+#endif
+
+    for (size_t i = 0; i < instances; ++i) {
+        std::string rec = "instance-" + std::to_string(i);
+        ASSERT_EQ(conveyor_write(convs[i], rec.data(), rec.size()), (ssize_t)rec.size());
+    }
+    for (size_t i = 0; i < instances; ++i) {
+        std::string rec = "instance-" + std::to_string(i);
+        ASSERT_EQ(conveyor_lseek(convs[i], 0, SEEK_SET), 0);
+        std::string out(rec.size(), '\0');
+        ASSERT_EQ(conveyor_read(convs[i], &out[0], out.size()), (ssize_t)out.size());
+        ASSERT_EQ(out, rec);
+    }
+
+    for (conveyor_t* conv : convs) conveyor_destroy(conv);
+    conveyor_executor_destroy(executor);
+}
+
+// On a single-thread executor a conveyor with a long backlog must not hold
+// the thread until it is drained: a second conveyor's flush gets a turn.
+TEST(ConveyorExecutorTest, BusyInstanceDoesNotStarveOthers) {
+    conveyor_executor_t* executor = conveyor_executor_create(1);
+    ASSERT_NE(executor, nullptr);
+
+    MockStorage busy(0);
+    MockStorage quiet(0);
+    busy.write_delay_ms = 5;
+
+    auto make = [&](MockStorage& m) {
+        conveyor_config_t cfg = {0};
+        cfg.handle = &m;
+        cfg.flags = O_WRONLY;
+        cfg.ops = m.get_ops();
+        cfg.initial_write_size = 64 * 1024;
+        cfg.executor = executor;
+        return conveyor_create(&cfg);
+    };
+    conveyor_t* a = make(busy);
+    conveyor_t* b = make(quiet);
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+
+    std::string rec(100, 'a');
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(conveyor_write(a, rec.data(), rec.size()), (ssize_t)rec.size());
+    }
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(conveyor_write(b, "b", 1), 1);
+    ASSERT_EQ(conveyor_flush(b), 0);
+    auto waited = std::chrono::steady_clock::now() - start;
+
+    // Draining 'a' takes ~500ms; 'b' should only wait a turn or two.
+    EXPECT_LT(waited, std::chrono::milliseconds(200));
+    ASSERT_EQ(conveyor_flush(a), 0);
+    EXPECT_EQ(busy.data.size(), 100u * rec.size());
+
+    conveyor_destroy(a);
+    conveyor_destroy(b);
+    conveyor_executor_destroy(executor);
+}
+
+#ifdef __linux__
+// Records, from inside each backend write, whether the calling worker was
+// pinned to CPU 0 alone.
+struct AffinityMock : MockStorage {
+    std::atomic<int> pinned{0};
+    std::atomic<int> unpinned{0};
+
+    AffinityMock() : MockStorage(0) {}
+
+    static ssize_t pwrite(storage_handle_t h, const void* buf, size_t count, off_t offset) {
+        auto* self = static_cast<AffinityMock*>(h);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+        if (CPU_COUNT(&set) == 1 && CPU_ISSET(0, &set)) self->pinned++;
+        else self->unpinned++;
+        return pwrite_callback(h, buf, count, offset);
+    }
+
+    storage_operations_t ops() { return { pwrite, pread_callback, lseek_callback }; }
+};
+
+TEST(ConveyorPlacementTest, WorkersRunOnTheGivenCpus) {
+    AffinityMock m;
+    const int cpus[] = {0};
+    conveyor_config_t cfg = {0};
+    cfg.handle = &m;
+    cfg.flags = O_WRONLY;
+    cfg.ops = m.ops();
+    cfg.initial_write_size = 4096;
+    cfg.write_queue_depth = 2;
+    cfg.placement.cpus = cpus;
+    cfg.placement.cpu_count = 1;
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_EQ(conveyor_pwrite(conv, "x", 1, i * 100), 1);
+        if (i % 5 == 0) {
+            ASSERT_EQ(conveyor_flush(conv), 0);
+        }
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    conveyor_destroy(conv);
+    EXPECT_GT(m.pinned.load(), 0);
+    EXPECT_EQ(m.unpinned.load(), 0);
+}
+
+TEST(ConveyorPlacementTest, PlacedExecutorPinsItsThreads) {
+    AffinityMock m;
+    const int cpus[] = {0};
+    conveyor_placement_t where = {cpus, 1, 0, 0};
+    conveyor_executor_t* executor = conveyor_executor_create_placed(2, &where);
+    ASSERT_NE(executor, nullptr);
+    conveyor_config_t cfg = {0};
+    cfg.handle = &m;
+    cfg.flags = O_WRONLY;
+    cfg.ops = m.ops();
+    cfg.initial_write_size = 4096;
+    cfg.executor = executor;
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    ASSERT_EQ(conveyor_write(conv, "abc", 3), 3);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    conveyor_destroy(conv);
+    conveyor_executor_destroy(executor);
+    EXPECT_GT(m.pinned.load(), 0);
+    EXPECT_EQ(m.unpinned.load(), 0);
+}
+
+// The write buffer of a conveyor bound to node 0 carries a preferred-node
+// policy; the memory it hands out is seen through conveyor_write_reserve.
+TEST(ConveyorPlacementTest, BuffersAreBoundToTheNode) {
+    if (access("/sys/devices/system/node/node0", F_OK) != 0) GTEST_SKIP() << "no NUMA sysfs";
+    MockStorage m(0);
+    conveyor_config_t cfg = {0};
+    cfg.handle = &m;
+    cfg.flags = O_RDWR;
+    cfg.ops = m.get_ops();
+    cfg.initial_write_size = 64 * 1024;
+    cfg.initial_read_size = 64 * 1024;
+    cfg.placement.bind_numa_node = 1;
+    cfg.placement.numa_node = 0;
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    conveyor_iovec_t segs[2];
+    int nsegs = 0;
+    ASSERT_EQ(conveyor_write_reserve(conv, 4096, segs, &nsegs), 4096);
+    std::memset(segs[0].iov_base, 'n', segs[0].iov_len);
+    int mode = -1;
+    unsigned long mask[16] = {0};
+    long rc = syscall(SYS_get_mempolicy, &mode, mask, sizeof(mask) * 8, segs[0].iov_base,
+                      2 /* MPOL_F_ADDR */);
+    ASSERT_EQ(conveyor_write_commit(conv, 4096), 4096);
+    conveyor_destroy(conv);
+    if (rc != 0) GTEST_SKIP() << "get_mempolicy unavailable: " << std::strerror(errno);
+    EXPECT_EQ(mode, 1); // MPOL_PREFERRED
+    EXPECT_EQ(mask[0] & 1UL, 1UL);
+}
+
+TEST(ConveyorPlacementTest, RejectsCpusAndNodesThatDoNotExist) {
+    MockStorage m(0);
+    conveyor_config_t cfg = {0};
+    cfg.handle = &m;
+    cfg.flags = O_WRONLY;
+    cfg.ops = m.get_ops();
+    cfg.initial_write_size = 4096;
+
+    const int bad_cpu[] = {1 << 20};
+    cfg.placement.cpus = bad_cpu;
+    cfg.placement.cpu_count = 1;
+    errno = 0;
+    EXPECT_EQ(conveyor_create(&cfg), nullptr);
+    EXPECT_EQ(errno, EINVAL);
+
+    cfg.placement = conveyor_placement_t{};
+    cfg.placement.bind_numa_node = 1;
+    cfg.placement.numa_node = 4096;
+    errno = 0;
+    EXPECT_EQ(conveyor_create(&cfg), nullptr);
+    EXPECT_EQ(errno, EINVAL);
+    errno = 0;
+    EXPECT_EQ(conveyor_executor_create_placed(1, &cfg.placement), nullptr);
+    EXPECT_EQ(errno, EINVAL);
+}
+#endif
@@ -203,3 +203,63 @@ TEST_F(ConveyorMultiThreadTest, ConcurrentReadWrite) {
 
     ASSERT_FALSE(test_failed) << "Data corruption detected by a reader thread.";
 }
+
+// Positional I/O from many threads on one conveyor: each thread rewrites
+// blocks in its own region and must always read back its latest version,
+// whether it is still pending, cached, in read-ahead or only in storage.
+TEST_F(ConveyorMultiThreadTest, ConcurrentPositionalReadWrite) {
+    conveyor_config_t cfg = {0};
+    cfg.handle = mock;
+    cfg.flags = O_RDWR;
+    cfg.ops = mock->get_ops();
+    cfg.initial_write_size = 256 * 1024;
+    cfg.initial_read_size = 256 * 1024;
+    cfg.max_write_size = cfg.initial_write_size;
+    cfg.max_read_size = cfg.initial_read_size;
+    cfg.read_cache_block_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    const int num_threads = 4;
+    const size_t slots_per_thread = 32;
+    std::atomic<bool> stop_flag = false;
+    std::atomic<int> failures = 0;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([this, &stop_flag, &failures, t]() {
+            std::vector<uint64_t> current(slots_per_thread, 0);
+            uint64_t seq = 0;
+            DataBlock block, back;
+            while (!stop_flag) {
+                size_t slot = rand() % slots_per_thread;
+                off_t offset = (t * slots_per_thread + slot) * sizeof(DataBlock);
+                if (rand() % 2) {
+                    block.sequence = ++seq;
+                    block.thread_id = t;
+                    std::memset(block.data, 'a' + (seq % 26), sizeof(block.data));
+                    block.checksum = calculate_checksum(block);
+                    if (conveyor_pwrite(conv, &block, sizeof(block), offset) != sizeof(block)) {
+                        failures++;
+                        break;
+                    }
+                    current[slot] = seq;
+                } else if (current[slot] != 0) {
+                    if (conveyor_pread(conv, &back, sizeof(back), offset) != sizeof(back) ||
+                        back.sequence != current[slot] || back.thread_id != (uint32_t)t ||
+                        back.checksum != calculate_checksum(back)) {
+                        failures++;
+                        break;
+                    }
+                }
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    stop_flag = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(failures.load(), 0);
+}
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+#include "mock_storage.hpp"
+#include "libconveyor/conveyor.h"
+
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+using Clock = std::chrono::steady_clock;
+
+static long long ms_since(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+// --- Test Fixture ---
+class ConveyorRateLimitTest : public ::testing::Test {
+protected:
+    MockStorage mock{0};
+
+    void TearDown() override { conveyor_set_rate_limit(nullptr); }
+
+    conveyor_config_t make_config(MockStorage& m, int flags) {
+        conveyor_config_t cfg = {0};
+        cfg.handle = &m;
+        cfg.flags = flags;
+        cfg.ops = m.get_ops();
+        cfg.initial_write_size = 1024 * 1024;
+        cfg.initial_read_size = 64 * 1024;
+        cfg.max_coalesce_size = 64 * 1024;
+        return cfg;
+    }
+
+    static void write_chunks(conveyor_t* conv, size_t total, size_t chunk) {
+        std::vector<char> buf(chunk, 'r');
+        for (size_t off = 0; off < total; off += chunk) {
+            ASSERT_EQ(conveyor_write(conv, buf.data(), chunk), (ssize_t)chunk);
+        }
+    }
+};
+
+TEST_F(ConveyorRateLimitTest, WriteBehindHonoursTheByteRate) {
+    auto cfg = make_config(mock, O_WRONLY);
+    cfg.rate_limit.bytes_per_sec = 1024 * 1024; // 100 KiB of burst
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto start = Clock::now();
+    write_chunks(conv, 400 * 1024, 4096);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    long long elapsed = ms_since(start);
+
+    // 300 KiB past the burst at 1 MiB/s; the last batch may ride on debt.
+    EXPECT_GE(elapsed, 180);
+    EXPECT_LT(elapsed, 3000);
+    EXPECT_EQ(mock.bytes_written.load(), 400u * 1024);
+
+    conveyor_stats_t stats;
+    ASSERT_EQ(conveyor_get_stats(conv, &stats), 0);
+    EXPECT_GT(stats.throttled_ops, 0u);
+    EXPECT_GT(stats.throttle_wait_ms, 100u);
+    conveyor_destroy(conv);
+}
+
+TEST_F(ConveyorRateLimitTest, OperationRateCapsBackendCalls) {
+    auto cfg = make_config(mock, O_WRONLY);
+    cfg.max_coalesce_size = 0;
+    cfg.rate_limit.ops_per_sec = 50; // Burst of 5
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto start = Clock::now();
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_EQ(conveyor_pwrite(conv, "op", 2, i * 10), 2);
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    EXPECT_GE(ms_since(start), 250); // 15 past the burst at 50/s
+    EXPECT_EQ(mock.pwrite_calls.load(), 20);
+    conveyor_destroy(conv);
+}
+
+TEST_F(ConveyorRateLimitTest, ProcessLimitIsSharedByAllConveyors) {
+    conveyor_rate_limit_t limit = {1024 * 1024, 0};
+    conveyor_set_rate_limit(&limit);
+    MockStorage other(0);
+    auto cfg_a = make_config(mock, O_WRONLY);
+    auto cfg_b = make_config(other, O_WRONLY);
+    conveyor_t* a = conveyor_create(&cfg_a);
+    conveyor_t* b = conveyor_create(&cfg_b);
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+
+    auto start = Clock::now();
+    write_chunks(a, 200 * 1024, 4096);
+    write_chunks(b, 200 * 1024, 4096);
+    ASSERT_EQ(conveyor_flush(a), 0);
+    ASSERT_EQ(conveyor_flush(b), 0);
+    EXPECT_GE(ms_since(start), 180);
+
+    // Lifting the limit takes effect at once.
+    conveyor_set_rate_limit(nullptr);
+    start = Clock::now();
+    write_chunks(a, 400 * 1024, 4096);
+    ASSERT_EQ(conveyor_flush(a), 0);
+    EXPECT_LT(ms_since(start), 150);
+    conveyor_destroy(a);
+    conveyor_destroy(b);
+}
+
+// A background bulk writer has seconds of backlog under the process limit;
+// a foreground reader on another conveyor is still served within a batch
+// or two instead of queueing behind it. Latency is judged against how long
+// the backlog takes to drain, which scales with the machine's load too.
+TEST_F(ConveyorRateLimitTest, ForegroundReadsGoAheadOfBackgroundWrites) {
+    conveyor_rate_limit_t limit = {1024 * 1024, 0};
+    conveyor_set_rate_limit(&limit);
+    MockStorage source(256 * 1024);
+    auto bulk_cfg = make_config(mock, O_WRONLY);
+    bulk_cfg.qos_class = CONVEYOR_QOS_BACKGROUND;
+    auto read_cfg = make_config(source, O_RDONLY);
+    conveyor_t* bulk = conveyor_create(&bulk_cfg);
+    conveyor_t* reader = conveyor_create(&read_cfg);
+    ASSERT_NE(bulk, nullptr);
+    ASSERT_NE(reader, nullptr);
+
+    auto bulk_start = Clock::now();
+    write_chunks(bulk, 1024 * 1024, 64 * 1024); // ~1 s to drain
+    std::this_thread::sleep_for(std::chrono::milliseconds(150)); // Burst spent
+
+    std::vector<char> out(4096);
+    long long worst = 0;
+    for (int i = 0; i < 5; ++i) {
+        auto start = Clock::now();
+        ASSERT_EQ(conveyor_pread(reader, out.data(), out.size(), 100 * 1024 + i * 8192),
+                  (ssize_t)out.size());
+        worst = std::max(worst, ms_since(start));
+    }
+
+    ASSERT_EQ(conveyor_flush(bulk), 0);
+    long long drain = ms_since(bulk_start);
+    EXPECT_GE(drain, 700);
+    EXPECT_LT(worst * 4, drain);
+    conveyor_destroy(reader);
+    conveyor_destroy(bulk);
+}
+
+// On a one-thread executor, a throttled conveyor waits off the pool: an
+// unthrottled one sharing it flushes without waiting out the other's limit,
+// in a small fraction of the time the throttled backlog takes.
+TEST_F(ConveyorRateLimitTest, ThrottledExecutorJobsDoNotHoldTheThread) {
+    conveyor_executor_t* executor = conveyor_executor_create(1);
+    ASSERT_NE(executor, nullptr);
+    MockStorage quick(0);
+    auto slow_cfg = make_config(mock, O_WRONLY);
+    slow_cfg.rate_limit.bytes_per_sec = 256 * 1024;
+    slow_cfg.executor = executor;
+    auto quick_cfg = make_config(quick, O_WRONLY);
+    quick_cfg.executor = executor;
+    conveyor_t* slow = conveyor_create(&slow_cfg);
+    conveyor_t* fast = conveyor_create(&quick_cfg);
+    ASSERT_NE(slow, nullptr);
+    ASSERT_NE(fast, nullptr);
+
+    auto slow_start = Clock::now();
+    write_chunks(slow, 400 * 1024, 4096); // ~1.5 s to drain
+    auto start = Clock::now();
+    ASSERT_EQ(conveyor_write(fast, "now", 3), 3);
+    ASSERT_EQ(conveyor_flush(fast), 0);
+    long long quick_flush = ms_since(start);
+
+    ASSERT_EQ(conveyor_flush(slow), 0);
+    long long drain = ms_since(slow_start);
+    EXPECT_GE(drain, 1000);
+    EXPECT_LT(quick_flush * 4, drain);
+    EXPECT_EQ(mock.bytes_written.load(), 400u * 1024);
+    conveyor_destroy(fast);
+    conveyor_destroy(slow);
+    conveyor_executor_destroy(executor);
+}
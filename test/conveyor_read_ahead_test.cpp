@@ -0,0 +1,375 @@
+#include <gtest/gtest.h>
+#include "mock_storage.hpp"
+#include "libconveyor/conveyor.h"
+
+#include <vector>
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+// --- Test Fixture ---
+class ConveyorReadAheadTest : public ::testing::Test {
+protected:
+    MockStorage* mock;
+    conveyor_t* conv;
+
+    void SetUp() override {
+        mock = new MockStorage(0);
+        conv = nullptr;
+    }
+
+    void TearDown() override {
+        if (conv) conveyor_destroy(conv);
+        delete mock;
+    }
+
+    void fill_storage(size_t len) {
+        mock->data.resize(len);
+        for (size_t i = 0; i < len; ++i) mock->data[i] = static_cast<char>(i * 131 + (i >> 9));
+    }
+
+    conveyor_config_t make_config(size_t read_size) {
+        conveyor_config_t cfg = {0};
+        cfg.handle = mock;
+        cfg.flags = O_RDONLY;
+        cfg.ops = mock->get_ops();
+        cfg.initial_read_size = read_size;
+        cfg.max_read_size = read_size;
+        return cfg;
+    }
+};
+
+TEST_F(ConveyorReadAheadTest, ChunksAreFetchedConcurrently) {
+    fill_storage(256 * 1024);
+    mock->read_delay_ms = 20;
+
+    auto cfg = make_config(64 * 1024);
+    cfg.read_chunk_size = 8 * 1024;
+    cfg.read_ahead_depth = 4;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    std::vector<char> out(mock->data.size());
+    size_t total = 0;
+    while (total < out.size()) {
+        ssize_t n = conveyor_read(conv, out.data() + total, 16 * 1024);
+        ASSERT_GT(n, 0);
+        total += n;
+    }
+    EXPECT_GT(mock->max_inflight_reads.load(), 1);
+    EXPECT_LE(mock->max_inflight_reads.load(), 4);
+    EXPECT_EQ(std::memcmp(out.data(), mock->data.data(), out.size()), 0);
+}
+
+// Random per-pread delays make chunks finish out of order; the stream the
+// application sees must still be in file order.
+TEST_F(ConveyorReadAheadTest, OutOfOrderCompletionIsCommittedInOrder) {
+    fill_storage(512 * 1024 + 123);
+    mock->read_jitter_ms = 5;
+
+    auto cfg = make_config(32 * 1024);
+    cfg.read_chunk_size = 2 * 1024;
+    cfg.read_ahead_depth = 8;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    std::vector<char> out;
+    char buf[3000];
+    while (true) {
+        ssize_t n = conveyor_read(conv, buf, sizeof(buf));
+        ASSERT_GE(n, 0);
+        if (n == 0) break;
+        out.insert(out.end(), buf, buf + n);
+    }
+    ASSERT_EQ(out.size(), mock->data.size());
+    EXPECT_EQ(std::memcmp(out.data(), mock->data.data(), out.size()), 0);
+}
+
+TEST_F(ConveyorReadAheadTest, SeekDiscardsInFlightChunks) {
+    fill_storage(128 * 1024);
+    mock->read_delay_ms = 10;
+
+    auto cfg = make_config(16 * 1024);
+    cfg.read_chunk_size = 1024;
+    cfg.read_ahead_depth = 4;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    char buf[512];
+    for (off_t target : {off_t(70000), off_t(100), off_t(120000), off_t(5000)}) {
+        ASSERT_EQ(conveyor_lseek(conv, target, SEEK_SET), target);
+        ASSERT_EQ(conveyor_read(conv, buf, sizeof(buf)), (ssize_t)sizeof(buf));
+        EXPECT_EQ(std::memcmp(buf, mock->data.data() + target, sizeof(buf)), 0) << "at " << target;
+    }
+}
+
+TEST_F(ConveyorReadAheadTest, ReadReturnsZeroAtEof) {
+    fill_storage(10000);
+
+    auto cfg = make_config(4096);
+    cfg.read_chunk_size = 1000;
+    cfg.read_ahead_depth = 3;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    std::vector<char> out(20000);
+    size_t total = 0;
+    while (true) {
+        ssize_t n = conveyor_read(conv, out.data() + total, 1500);
+        ASSERT_GE(n, 0);
+        if (n == 0) break;
+        total += n;
+    }
+    EXPECT_EQ(total, 10000u);
+    EXPECT_EQ(std::memcmp(out.data(), mock->data.data(), total), 0);
+}
+
+// Streaming a file through borrowed views must reproduce it exactly, and a
+// ring that is not a multiple of the view size will hand out wrapped views.
+TEST_F(ConveyorReadAheadTest, ReadViewStreamsFile) {
+    fill_storage(256 * 1024);
+
+    auto cfg = make_config(10000);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    std::vector<char> out;
+    bool saw_wrap = false;
+    while (true) {
+        conveyor_iovec_t segs[2];
+        int nsegs = 0;
+        // Let read-ahead top the ring up so views start at shifting offsets.
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ssize_t n = conveyor_read_acquire(conv, 7000, segs, &nsegs);
+        ASSERT_GE(n, 0);
+        if (n == 0) break;
+        size_t sum = 0;
+        for (int i = 0; i < nsegs; ++i) {
+            const char* p = static_cast<const char*>(segs[i].iov_base);
+            out.insert(out.end(), p, p + segs[i].iov_len);
+            sum += segs[i].iov_len;
+        }
+        EXPECT_EQ(sum, (size_t)n);
+        if (nsegs == 2) saw_wrap = true;
+        ASSERT_EQ(conveyor_read_release(conv, n), 0);
+    }
+    EXPECT_TRUE(saw_wrap);
+    ASSERT_EQ(out.size(), mock->data.size());
+    EXPECT_EQ(std::memcmp(out.data(), mock->data.data(), out.size()), 0);
+}
+
+// Bytes that are not consumed on release come back on the next read.
+TEST_F(ConveyorReadAheadTest, ReadViewPartialRelease) {
+    fill_storage(4096);
+
+    auto cfg = make_config(4096);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    conveyor_iovec_t segs[2];
+    int nsegs = 0;
+    ssize_t n = conveyor_read_acquire(conv, 100, segs, &nsegs);
+    ASSERT_GT(n, 40);
+    ASSERT_EQ(conveyor_read_release(conv, 40), 0);
+
+    std::vector<char> out(60);
+    ASSERT_EQ(conveyor_read(conv, out.data(), out.size()), 60);
+    EXPECT_EQ(std::memcmp(out.data(), mock->data.data() + 40, out.size()), 0);
+}
+
+// While a view is out nothing may move the bytes under it.
+TEST_F(ConveyorReadAheadTest, ReadViewExcludesReadAndSeek) {
+    fill_storage(4096);
+
+    auto cfg = make_config(4096);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    conveyor_iovec_t segs[2];
+    int nsegs = 0;
+    ASSERT_GT(conveyor_read_acquire(conv, 100, segs, &nsegs), 0);
+
+    char c;
+    EXPECT_EQ(conveyor_read(conv, &c, 1), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EBUSY);
+    EXPECT_EQ(conveyor_lseek(conv, 0, SEEK_SET), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EBUSY);
+    EXPECT_EQ(conveyor_read_acquire(conv, 100, segs, &nsegs), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EBUSY);
+
+    ASSERT_EQ(conveyor_read_release(conv, 0), 0);
+    EXPECT_EQ(conveyor_read_release(conv, 0), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EINVAL);
+    ASSERT_EQ(conveyor_read(conv, &c, 1), 1);
+    EXPECT_EQ(c, mock->data[0]);
+}
+
+// Hopping back and forth inside data that has already been read must be
+// served from the read cache without going back to storage.
+TEST_F(ConveyorReadAheadTest, ReadCacheServesSeeksWithoutRefetching) {
+    fill_storage(256 * 1024);
+
+    auto cfg = make_config(32 * 1024);
+    cfg.read_cache_block_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    char buf[4096];
+    for (off_t off = 0; off < 32 * 1024; off += sizeof(buf)) {
+        ASSERT_EQ(conveyor_read(conv, buf, sizeof(buf)), (ssize_t)sizeof(buf));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // Let read-ahead settle
+    int preads = mock->pread_calls.load();
+
+    for (int i = 0; i < 50; ++i) {
+        off_t target = (i * 7919 + i * i * 131) % (28 * 1024); // No fixed stride
+        ASSERT_EQ(conveyor_lseek(conv, target, SEEK_SET), target);
+        ASSERT_EQ(conveyor_read(conv, buf, 1000), 1000);
+        EXPECT_EQ(std::memcmp(buf, mock->data.data() + target, 1000), 0) << "at " << target;
+    }
+    EXPECT_EQ(mock->pread_calls.load(), preads);
+
+    // Forward past the cache: served from the read-ahead already buffered.
+    ASSERT_EQ(conveyor_lseek(conv, 40 * 1024, SEEK_SET), 40 * 1024);
+    ASSERT_EQ(conveyor_read(conv, buf, sizeof(buf)), (ssize_t)sizeof(buf));
+    EXPECT_EQ(std::memcmp(buf, mock->data.data() + 40 * 1024, sizeof(buf)), 0);
+}
+
+// A cache smaller than the data read must evict and still return the right
+// bytes once evicted blocks are needed again.
+TEST_F(ConveyorReadAheadTest, ReadCacheEvictsAndRefetches) {
+    fill_storage(128 * 1024);
+
+    auto cfg = make_config(16 * 1024);
+    cfg.read_cache_block_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    std::vector<char> out(mock->data.size());
+    for (size_t off = 0; off < out.size(); off += 3000) {
+        size_t len = std::min<size_t>(3000, out.size() - off);
+        ASSERT_EQ(conveyor_read(conv, out.data() + off, len), (ssize_t)len);
+    }
+    EXPECT_EQ(out, mock->data);
+
+    for (off_t target : {off_t(0), off_t(100000), off_t(5000), off_t(127 * 1024)}) {
+        char buf[1024];
+        ASSERT_EQ(conveyor_lseek(conv, target, SEEK_SET), target);
+        ASSERT_EQ(conveyor_read(conv, buf, sizeof(buf)), (ssize_t)sizeof(buf));
+        EXPECT_EQ(std::memcmp(buf, mock->data.data() + target, sizeof(buf)), 0) << "at " << target;
+    }
+}
+
+// Writes that reach storage must replace both cached blocks and read-ahead
+// that was fetched before them.
+TEST_F(ConveyorReadAheadTest, ReadCacheSeesWrites) {
+    fill_storage(64 * 1024);
+
+    auto cfg = make_config(16 * 1024);
+    cfg.flags = O_RDWR;
+    cfg.initial_write_size = 16 * 1024;
+    cfg.read_cache_block_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    char buf[8192];
+    ASSERT_EQ(conveyor_read(conv, buf, sizeof(buf)), (ssize_t)sizeof(buf));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20)); // Read-ahead past 10000
+
+    std::vector<char> patch(100, 'X');
+    ASSERT_EQ(conveyor_lseek(conv, 1000, SEEK_SET), 1000); // Cached
+    ASSERT_EQ(conveyor_write(conv, patch.data(), patch.size()), 100);
+    ASSERT_EQ(conveyor_lseek(conv, 10000, SEEK_SET), 10000); // Read-ahead
+    ASSERT_EQ(conveyor_write(conv, patch.data(), patch.size()), 100);
+
+    ASSERT_EQ(conveyor_lseek(conv, 0, SEEK_SET), 0);
+    std::vector<char> out(12000);
+    ASSERT_EQ(conveyor_read(conv, out.data(), out.size()), (ssize_t)out.size());
+    std::vector<char> expected(mock->data.begin(), mock->data.begin() + out.size());
+    EXPECT_EQ(out, expected);
+    EXPECT_EQ(std::memcmp(out.data() + 1000, patch.data(), 100), 0);
+    EXPECT_EQ(std::memcmp(out.data() + 10000, patch.data(), 100), 0);
+}
+
+// Fixed-size records with a fixed gap: once the stride is confirmed, the
+// following records are prefetched into the cache ahead of the reader.
+TEST_F(ConveyorReadAheadTest, StridedReadsArePrefetched) {
+    fill_storage(4 * 1024 * 1024);
+    mock->read_delay_ms = 2;
+
+    auto cfg = make_config(64 * 1024);
+    cfg.read_cache_block_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    const size_t record = 1000;
+    const off_t stride = 100000; // Well past what sequential read-ahead covers
+    char buf[record];
+    for (int i = 0; i < 40; ++i) {
+        off_t target = 3000 + i * stride;
+        ASSERT_EQ(conveyor_lseek(conv, target, SEEK_SET), target);
+        ASSERT_EQ(conveyor_read(conv, buf, record), (ssize_t)record);
+        ASSERT_EQ(std::memcmp(buf, mock->data.data() + target, record), 0) << "at " << target;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10)); // "Process" the record
+    }
+
+    conveyor_stats_t stats;
+    conveyor_get_stats(conv, &stats);
+    EXPECT_EQ(stats.read_hits + stats.read_misses, 40u);
+    EXPECT_GE(stats.read_hits, 30u);
+}
+
+// Walking a file backwards with positional reads gets the same help.
+TEST_F(ConveyorReadAheadTest, ReverseScanIsPrefetched) {
+    fill_storage(512 * 1024);
+    mock->read_delay_ms = 2;
+
+    auto cfg = make_config(64 * 1024);
+    cfg.read_cache_block_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    const size_t record = 4096;
+    char buf[record];
+    int reads = 0;
+    for (off_t target = 512 * 1024 - record; target >= 0; target -= 4 * record) {
+        ASSERT_EQ(conveyor_pread(conv, buf, record, target), (ssize_t)record);
+        ASSERT_EQ(std::memcmp(buf, mock->data.data() + target, record), 0) << "at " << target;
+        reads++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    conveyor_stats_t stats;
+    conveyor_get_stats(conv, &stats);
+    EXPECT_EQ(stats.read_hits + stats.read_misses, (size_t)reads);
+    EXPECT_GE(stats.read_hits, (size_t)reads * 3 / 4);
+}
+
+TEST_F(ConveyorReadAheadTest, ReadvScattersInFileOrder) {
+    fill_storage(10000);
+    auto cfg = make_config(4096);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    char header[16], payload[3000], trailer[100];
+    conveyor_iovec_t iov[3] = {{header, sizeof(header)}, {payload, sizeof(payload)},
+                               {trailer, sizeof(trailer)}};
+    size_t total = sizeof(header) + sizeof(payload) + sizeof(trailer);
+    size_t pos = 0;
+    for (int round = 0; round < 3; ++round) {
+        ASSERT_EQ(conveyor_readv(conv, iov, 3), (ssize_t)total);
+        EXPECT_EQ(std::memcmp(header, mock->data.data() + pos, sizeof(header)), 0);
+        EXPECT_EQ(std::memcmp(payload, mock->data.data() + pos + 16, sizeof(payload)), 0);
+        EXPECT_EQ(std::memcmp(trailer, mock->data.data() + pos + 3016, sizeof(trailer)), 0);
+        pos += total;
+    }
+    // Short at EOF: the list is filled in order up to the end.
+    ssize_t n = conveyor_readv(conv, iov, 3);
+    ASSERT_EQ(n, (ssize_t)(10000 - pos));
+    EXPECT_EQ(std::memcmp(payload, mock->data.data() + pos + 16, n - 16), 0);
+    EXPECT_EQ(conveyor_readv(conv, iov, 3), 0);
+
+    errno = 0;
+    EXPECT_EQ(conveyor_readv(conv, nullptr, 2), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EINVAL);
+}
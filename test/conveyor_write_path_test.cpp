@@ -0,0 +1,1029 @@
+#include <gtest/gtest.h>
+#include "mock_storage.hpp"
+#include "libconveyor/conveyor.h"
+#include "libconveyor/detail/latency_histogram.h"
+
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <chrono>
+
+// --- Test Fixture ---
+class ConveyorWritePathTest : public ::testing::Test {
+protected:
+    MockStorage* mock;
+    conveyor_t* conv;
+    // Callback contexts live here so they outlive the conveyor, which may
+    // still call back from conveyor_destroy in TearDown.
+    std::atomic<int> callbacks{0};
+
+    void SetUp() override {
+        mock = new MockStorage(0);
+        conv = nullptr;
+    }
+
+    void TearDown() override {
+        if (conv) conveyor_destroy(conv);
+        delete mock;
+    }
+
+    conveyor_config_t make_config(size_t write_size) {
+        conveyor_config_t cfg = {0};
+        cfg.handle = mock;
+        cfg.flags = O_WRONLY;
+        cfg.ops = mock->get_ops();
+        cfg.initial_write_size = write_size;
+        cfg.max_write_size = write_size;
+        return cfg;
+    }
+};
+
+static std::vector<char> make_pattern(size_t len) {
+    std::vector<char> data(len);
+    for (size_t i = 0; i < len; ++i) data[i] = static_cast<char>('a' + (i % 23));
+    return data;
+}
+
+// While the worker is stuck in the first (slow) pwrite, the remaining
+// contiguous writes pile up and must go out as one backend call.
+TEST_F(ConveyorWritePathTest, CoalescesContiguousWrites) {
+    auto cfg = make_config(256 * 1024);
+    cfg.max_coalesce_size = 1024 * 1024;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    const size_t block = 4096;
+    const size_t blocks = 16;
+    auto data = make_pattern(block * blocks);
+
+    mock->write_delay_ms = 50;
+    for (size_t i = 0; i < blocks; ++i) {
+        ASSERT_EQ(conveyor_write(conv, data.data() + i * block, block), (ssize_t)block);
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    EXPECT_LE(mock->pwrite_calls.load(), 2);
+    ASSERT_EQ(mock->data.size(), data.size());
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), data.size()), 0);
+}
+
+TEST_F(ConveyorWritePathTest, CoalesceRespectsLimit) {
+    auto cfg = make_config(256 * 1024);
+    cfg.max_coalesce_size = 3 * 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    const size_t block = 4096;
+    const size_t blocks = 16;
+    auto data = make_pattern(block * blocks);
+
+    mock->write_delay_ms = 20;
+    for (size_t i = 0; i < blocks; ++i) {
+        ASSERT_EQ(conveyor_write(conv, data.data() + i * block, block), (ssize_t)block);
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    EXPECT_LE(mock->max_pwrite_size.load(), cfg.max_coalesce_size);
+    EXPECT_GE(mock->pwrite_calls.load(), (int)(blocks / 3));
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), data.size()), 0);
+}
+
+// A seek between writes breaks file contiguity; the two runs must not merge.
+TEST_F(ConveyorWritePathTest, DoesNotCoalesceAcrossGaps) {
+    auto cfg = make_config(64 * 1024);
+    cfg.max_coalesce_size = 1024 * 1024;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    std::vector<char> a(1000, 'A');
+    std::vector<char> b(1000, 'B');
+    ASSERT_EQ(conveyor_write(conv, a.data(), a.size()), (ssize_t)a.size());
+    ASSERT_EQ(conveyor_lseek(conv, 5000, SEEK_SET), 5000);
+    ASSERT_EQ(conveyor_write(conv, b.data(), b.size()), (ssize_t)b.size());
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    ASSERT_GE(mock->data.size(), 6000u);
+    EXPECT_EQ(std::memcmp(mock->data.data(), a.data(), a.size()), 0);
+    EXPECT_EQ(mock->data[1000], 0);
+    EXPECT_EQ(std::memcmp(mock->data.data() + 5000, b.data(), b.size()), 0);
+}
+
+// Flush must wait for the batch that is currently in flight, not just for
+// the queue to look empty.
+TEST_F(ConveyorWritePathTest, FlushWaitsForInFlightWrite) {
+    auto cfg = make_config(64 * 1024);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 100;
+    std::vector<char> a(512, 'Z');
+    ASSERT_EQ(conveyor_write(conv, a.data(), a.size()), (ssize_t)a.size());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    std::lock_guard<std::mutex> lock(mock->mx);
+    ASSERT_EQ(mock->data.size(), a.size());
+    EXPECT_EQ(std::memcmp(mock->data.data(), a.data(), a.size()), 0);
+}
+
+// With pwritev available the worker must never fall back to pwrite, and a
+// batch that wraps the end of the ring arrives as two iovec segments.
+TEST_F(ConveyorWritePathTest, VectoredWriteUsesRingSegments) {
+    auto cfg = make_config(1000);
+    cfg.ops = mock->get_vectored_ops();
+    cfg.max_coalesce_size = 1000;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto data = make_pattern(1400);
+
+    // Advance head/tail to 700 so the next batch straddles the wrap point.
+    ASSERT_EQ(conveyor_write(conv, data.data(), 700), 700);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    mock->write_delay_ms = 50;
+    ASSERT_EQ(conveyor_write(conv, data.data() + 700, 100), 100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(conveyor_write(conv, data.data() + 800, 300), 300);
+    ASSERT_EQ(conveyor_write(conv, data.data() + 1100, 300), 300);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    EXPECT_EQ(mock->pwrite_calls.load(), 0);
+    EXPECT_EQ(mock->max_pwritev_iovcnt.load(), 2);
+    ASSERT_EQ(mock->data.size(), data.size());
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), data.size()), 0);
+}
+
+TEST_F(ConveyorWritePathTest, VectoredWriteHandlesShortWrites) {
+    auto cfg = make_config(1000);
+    cfg.ops = mock->get_vectored_ops();
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto data = make_pattern(1600);
+    mock->pwritev_short_limit = 7;
+    for (size_t off = 0; off < data.size(); off += 400) {
+        ASSERT_EQ(conveyor_write(conv, data.data() + off, 400), 400);
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    ASSERT_EQ(mock->data.size(), data.size());
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), data.size()), 0);
+}
+
+TEST_F(ConveyorWritePathTest, QueueDepthIssuesWritesConcurrently) {
+    auto cfg = make_config(64 * 1024);
+    cfg.write_queue_depth = 4;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    const size_t block = 1024;
+    const size_t blocks = 16;
+    auto data = make_pattern(block * blocks);
+
+    mock->write_delay_ms = 30;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < blocks; ++i) {
+        ASSERT_EQ(conveyor_write(conv, data.data() + i * block, block), (ssize_t)block);
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_GT(mock->max_inflight_writes.load(), 1);
+    EXPECT_LE(mock->max_inflight_writes.load(), 4);
+    // 16 writes at 30ms each would take ~480ms one at a time.
+    EXPECT_LT(elapsed, std::chrono::milliseconds(400));
+    ASSERT_EQ(mock->data.size(), data.size());
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), data.size()), 0);
+}
+
+TEST_F(ConveyorWritePathTest, QueueDepthKeepsErrorSticky) {
+    auto cfg = make_config(64 * 1024);
+    cfg.write_queue_depth = 4;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    std::vector<char> block(512, 'E');
+    mock->write_delay_ms = 10;
+    mock->next_write_error = ENOSPC;
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_EQ(conveyor_write(conv, block.data(), block.size()), (ssize_t)block.size());
+    }
+    ASSERT_EQ(conveyor_flush(conv), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, ENOSPC);
+
+    errno = 0;
+    EXPECT_EQ(conveyor_write(conv, block.data(), block.size()), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, ENOSPC);
+
+    conveyor_stats_t stats;
+    conveyor_get_stats(conv, &stats);
+    EXPECT_EQ(stats.last_error_code, ENOSPC);
+}
+
+TEST_F(ConveyorWritePathTest, QueueDepthWithAppend) {
+    std::string initial = "HEAD";
+    mock->data.assign(initial.begin(), initial.end());
+
+    auto cfg = make_config(64 * 1024);
+    cfg.flags = O_WRONLY | O_APPEND;
+    cfg.write_queue_depth = 3;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 5;
+    std::string expected = initial;
+    for (int i = 0; i < 20; ++i) {
+        std::string rec = "<" + std::to_string(i) + ">";
+        ASSERT_EQ(conveyor_write(conv, rec.data(), rec.size()), (ssize_t)rec.size());
+        expected += rec;
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    EXPECT_EQ(std::string(mock->data.begin(), mock->data.end()), expected);
+}
+
+// Many small writes are indexed by offset while queued; reading back the
+// middle of them (the seek drains the queue first) must match exactly.
+TEST_F(ConveyorWritePathTest, SnoopFindsPendingWritesAmongMany) {
+    auto cfg = make_config(1024 * 1024);
+    cfg.flags = O_RDWR;
+    cfg.initial_read_size = 4096;
+    cfg.max_read_size = 4096;
+    cfg.max_coalesce_size = 1024 * 1024; // Keep teardown to a couple of pwrites
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    const size_t block = 64;
+    const size_t blocks = 2000;
+    auto data = make_pattern(block * blocks);
+
+    mock->write_delay_ms = 200;
+    for (size_t i = 0; i < blocks; ++i) {
+        ASSERT_EQ(conveyor_write(conv, data.data() + i * block, block), (ssize_t)block);
+    }
+
+    const off_t offset = 1000 * block + 10;
+    std::vector<char> out(300, 0);
+    ASSERT_EQ(conveyor_lseek(conv, offset, SEEK_SET), offset);
+    ASSERT_EQ(conveyor_read(conv, out.data(), out.size()), (ssize_t)out.size());
+    EXPECT_EQ(std::memcmp(out.data(), data.data() + offset, out.size()), 0);
+}
+
+// When writes overlap, the newest one wins regardless of where it starts
+// relative to the older ones.
+TEST_F(ConveyorWritePathTest, SnoopAppliesOverlappingWritesInOrder) {
+    auto cfg = make_config(64 * 1024);
+    cfg.flags = O_RDWR;
+    cfg.initial_read_size = 4096;
+    cfg.max_read_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 200;
+    std::vector<char> a(100, 'A');
+    std::vector<char> b(20, 'B');
+    std::vector<char> c(50, 'C');
+    ASSERT_EQ(conveyor_write(conv, a.data(), a.size()), (ssize_t)a.size());
+    ASSERT_EQ(conveyor_lseek(conv, 40, SEEK_SET), 40);
+    ASSERT_EQ(conveyor_write(conv, b.data(), b.size()), (ssize_t)b.size());
+    ASSERT_EQ(conveyor_lseek(conv, 10, SEEK_SET), 10);
+    ASSERT_EQ(conveyor_write(conv, c.data(), c.size()), (ssize_t)c.size());
+
+    std::string expected(100, 'A');
+    expected.replace(40, 20, 20, 'B');
+    expected.replace(10, 50, 50, 'C');
+
+    std::vector<char> out(100, 0);
+    ASSERT_EQ(conveyor_lseek(conv, 0, SEEK_SET), 0);
+    ASSERT_EQ(conveyor_read(conv, out.data(), out.size()), (ssize_t)out.size());
+    EXPECT_EQ(std::string(out.begin(), out.end()), expected);
+}
+
+// A read that does not touch anything this conveyor wrote returns the
+// bytes already in storage.
+TEST_F(ConveyorWritePathTest, SnoopSkipsReadsOutsidePendingRange) {
+    std::string initial(8192, 'x');
+    mock->data.assign(initial.begin(), initial.end());
+
+    auto cfg = make_config(64 * 1024);
+    cfg.flags = O_RDWR;
+    cfg.initial_read_size = 4096;
+    cfg.max_read_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 200;
+    std::vector<char> w(100, 'W');
+    ASSERT_EQ(conveyor_write(conv, w.data(), w.size()), (ssize_t)w.size());
+
+    std::vector<char> out(100, 0);
+    ASSERT_EQ(conveyor_lseek(conv, 4000, SEEK_SET), 4000);
+    ASSERT_EQ(conveyor_read(conv, out.data(), out.size()), (ssize_t)out.size());
+    EXPECT_EQ(std::string(out.begin(), out.end()), std::string(100, 'x'));
+}
+
+// Positional writes queue without a flush barrier, and a positional read
+// sees all of them (newest wins) without waiting for the slow backend.
+TEST_F(ConveyorWritePathTest, PositionalIoSnoopsWithoutFlushing) {
+    auto cfg = make_config(64 * 1024);
+    cfg.flags = O_RDWR;
+    cfg.initial_read_size = 4096;
+    cfg.max_read_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 200;
+    std::vector<char> a(100, 'A');
+    std::vector<char> b(20, 'B');
+    std::vector<char> c(50, 'C');
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(conveyor_pwrite(conv, a.data(), a.size(), 0), (ssize_t)a.size());
+    ASSERT_EQ(conveyor_pwrite(conv, b.data(), b.size(), 40), (ssize_t)b.size());
+    ASSERT_EQ(conveyor_pwrite(conv, c.data(), c.size(), 10), (ssize_t)c.size());
+
+    std::string expected(100, 'A');
+    expected.replace(40, 20, 20, 'B');
+    expected.replace(10, 50, 50, 'C');
+
+    std::vector<char> out(100, 0);
+    ASSERT_EQ(conveyor_pread(conv, out.data(), out.size(), 0), (ssize_t)out.size());
+    EXPECT_EQ(std::string(out.begin(), out.end()), expected);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(150));
+
+    // The file position was left alone: a plain write still lands at 0.
+    ASSERT_EQ(conveyor_write(conv, "Z", 1), 1);
+    ASSERT_EQ(conveyor_pread(conv, out.data(), 2, 0), 2);
+    EXPECT_EQ(out[0], 'Z');
+    EXPECT_EQ(out[1], 'A');
+
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    mock->write_delay_ms = 0;
+    ASSERT_EQ(conveyor_pread(conv, out.data(), out.size(), 0), (ssize_t)out.size());
+    expected[0] = 'Z';
+    EXPECT_EQ(std::string(out.begin(), out.end()), expected);
+    EXPECT_EQ(conveyor_pread(conv, out.data(), out.size(), 1000), 0); // Past EOF
+}
+
+// A pwrite over bytes already read ahead retires while conveyor_read sits
+// between copying them and snooping for pending writes (waiting on a slow
+// fetch for the rest of the call); the read must not return the old bytes.
+TEST_F(ConveyorWritePathTest, SequentialReadSeesWriteRetiredMidCall) {
+    mock->data = make_pattern(16 * 1024);
+    auto cfg = make_config(64 * 1024);
+    cfg.flags = O_RDWR;
+    cfg.initial_read_size = 4096;
+    cfg.max_read_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // Read ahead
+
+    mock->write_delay_ms = 50;
+    mock->read_delay_ms = 150;
+    std::vector<char> patch(64, 'P');
+    ASSERT_EQ(conveyor_pwrite(conv, patch.data(), patch.size(), 100), (ssize_t)patch.size());
+    std::vector<char> out(8192);
+    ASSERT_EQ(conveyor_read(conv, out.data(), out.size()), (ssize_t)out.size());
+    auto expected = make_pattern(16 * 1024);
+    std::memcpy(expected.data() + 100, patch.data(), patch.size());
+    EXPECT_EQ(std::memcmp(out.data(), expected.data(), out.size()), 0);
+}
+
+// Write absorption: while the backend is busy, rewrites of a header drop
+// the pending versions they cover, so only the first (already in flight)
+// and the last header reach storage. Writes that only partly overlap the
+// header are kept, and reads see the newest bytes throughout.
+TEST_F(ConveyorWritePathTest, AbsorbsCoveredPendingWrites) {
+    auto cfg = make_config(64 * 1024);
+    cfg.flags = O_RDWR;
+    cfg.initial_read_size = 4096;
+    cfg.max_read_size = 4096;
+    cfg.write_absorb = 1;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 50;
+    const size_t header = 64;
+    const size_t record = 100;
+    const int records = 10;
+    std::vector<char> h(header, '0');
+    ASSERT_EQ(conveyor_pwrite(conv, h.data(), header, 0), (ssize_t)header);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::vector<char> r(record);
+    for (int i = 1; i <= records; ++i) {
+        std::fill(r.begin(), r.end(), static_cast<char>('a' + i));
+        ASSERT_EQ(conveyor_pwrite(conv, r.data(), record, header + (i - 1) * record), (ssize_t)record);
+        std::fill(h.begin(), h.end(), static_cast<char>('0' + i));
+        ASSERT_EQ(conveyor_pwrite(conv, h.data(), header, 0), (ssize_t)header);
+    }
+    // Straddles the header, so it covers none of it and nothing covers it.
+    std::vector<char> x(header, 'X');
+    ASSERT_EQ(conveyor_pwrite(conv, x.data(), header, header / 2), (ssize_t)header);
+
+    std::string expected(header + records * record, '?');
+    for (int i = 1; i <= records; ++i)
+        expected.replace(header + (i - 1) * record, record, record, static_cast<char>('a' + i));
+    expected.replace(0, header, header, static_cast<char>('0' + records));
+    expected.replace(header / 2, header, header, 'X');
+
+    std::vector<char> out(expected.size(), 0);
+    ASSERT_EQ(conveyor_pread(conv, out.data(), out.size(), 0), (ssize_t)out.size());
+    EXPECT_EQ(std::string(out.begin(), out.end()), expected);
+
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    {
+        std::lock_guard<std::mutex> lock(mock->mx);
+        EXPECT_EQ(std::string(mock->data.begin(), mock->data.end()), expected);
+    }
+    // First header + records + last header + the straddling write.
+    EXPECT_EQ(mock->pwrite_calls.load(), 1 + records + 1 + 1);
+    conveyor_stats_t stats;
+    ASSERT_EQ(conveyor_get_stats(conv, &stats), 0);
+    EXPECT_EQ(stats.bytes_absorbed, (records - 1) * header);
+}
+
+// Single-producer mode: a long run of small writes through a ring that
+// wraps many times and has to grow must land byte-exact.
+TEST_F(ConveyorWritePathTest, SingleProducerRoundTrip) {
+    auto cfg = make_config(64 * 1024);
+    cfg.initial_write_size = 1000;
+    cfg.single_producer = 1;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto data = make_pattern(512 * 1024);
+    size_t pos = 0;
+    size_t len = 1;
+    while (pos < data.size()) {
+        size_t n = std::min(len, data.size() - pos);
+        ASSERT_EQ(conveyor_write(conv, data.data() + pos, n), (ssize_t)n);
+        pos += n;
+        len = (len % 700) + 37;
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    std::lock_guard<std::mutex> lock(mock->mx);
+    ASSERT_EQ(mock->data.size(), data.size());
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), data.size()), 0);
+}
+
+// More writes than the staging queue holds pile up behind a slow backend;
+// the overflow takes the locked path and ordering is preserved.
+TEST_F(ConveyorWritePathTest, SingleProducerOverflowsStagingQueue) {
+    auto cfg = make_config(1024 * 1024);
+    cfg.single_producer = 1;
+    cfg.max_coalesce_size = 1024 * 1024;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    const size_t block = 16;
+    const size_t blocks = 5000;
+    auto data = make_pattern(block * blocks);
+
+    mock->write_delay_ms = 20;
+    for (size_t i = 0; i < blocks; ++i) {
+        ASSERT_EQ(conveyor_write(conv, data.data() + i * block, block), (ssize_t)block);
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    std::lock_guard<std::mutex> lock(mock->mx);
+    ASSERT_EQ(mock->data.size(), data.size());
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), data.size()), 0);
+}
+
+// Writes that have only been staged (not yet seen by a worker) must be
+// picked up by the seek's flush so the read back sees them.
+TEST_F(ConveyorWritePathTest, SingleProducerReadSeesStagedWrites) {
+    auto cfg = make_config(64 * 1024);
+    cfg.flags = O_RDWR;
+    cfg.initial_read_size = 4096;
+    cfg.max_read_size = 4096;
+    cfg.single_producer = 1;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 100;
+    std::string a = "first-";
+    std::string b = "second";
+    ASSERT_EQ(conveyor_write(conv, a.data(), a.size()), (ssize_t)a.size());
+    ASSERT_EQ(conveyor_write(conv, b.data(), b.size()), (ssize_t)b.size());
+
+    char out[12] = {0};
+    ASSERT_EQ(conveyor_lseek(conv, 0, SEEK_SET), 0);
+    ASSERT_EQ(conveyor_read(conv, out, sizeof(out)), (ssize_t)sizeof(out));
+    EXPECT_EQ(std::string(out, sizeof(out)), a + b);
+}
+
+// A sticky backend error surfaces on the lock-free path too.
+TEST_F(ConveyorWritePathTest, SingleProducerReportsStickyError) {
+    auto cfg = make_config(64 * 1024);
+    cfg.single_producer = 1;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->next_write_error = EIO;
+    std::vector<char> a(100, 'E');
+    ASSERT_EQ(conveyor_write(conv, a.data(), a.size()), (ssize_t)a.size());
+    EXPECT_EQ(conveyor_flush(conv), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EIO);
+    EXPECT_EQ(conveyor_write(conv, a.data(), a.size()), LIBCONVEYOR_ERROR);
+    conveyor_clear_error(conv);
+}
+
+static void fill_segments(const conveyor_iovec_t* segs, int nsegs, const char* src) {
+    for (int i = 0; i < nsegs; ++i) {
+        std::memcpy(segs[i].iov_base, src, segs[i].iov_len);
+        src += segs[i].iov_len;
+    }
+}
+
+// Records serialized straight into the ring, including ones that straddle
+// the wrap point, land exactly like ordinary writes.
+TEST_F(ConveyorWritePathTest, ReserveCommitWritesInPlace) {
+    auto cfg = make_config(1000);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto data = make_pattern(300 * 20);
+    bool saw_wrap = false;
+    for (size_t i = 0; i < 20; ++i) {
+        conveyor_iovec_t segs[2];
+        int nsegs = 0;
+        ASSERT_EQ(conveyor_write_reserve(conv, 300, segs, &nsegs), 300);
+        if (nsegs == 2) saw_wrap = true;
+        fill_segments(segs, nsegs, data.data() + i * 300);
+        ASSERT_EQ(conveyor_write_commit(conv, 300), 300);
+    }
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    EXPECT_TRUE(saw_wrap);
+    ASSERT_EQ(mock->data.size(), data.size());
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), data.size()), 0);
+}
+
+// Committing less than was reserved queues only that much; committing
+// zero cancels.
+TEST_F(ConveyorWritePathTest, ReserveCommitPartialAndCancel) {
+    auto cfg = make_config(4096);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    conveyor_iovec_t segs[2];
+    int nsegs = 0;
+    ASSERT_EQ(conveyor_write_reserve(conv, 100, segs, &nsegs), 100);
+    std::memset(segs[0].iov_base, 'X', 100);
+    ASSERT_EQ(conveyor_write_commit(conv, 0), 0);
+
+    ASSERT_EQ(conveyor_write_reserve(conv, 100, segs, &nsegs), 100);
+    std::memcpy(segs[0].iov_base, "hello", 5);
+    ASSERT_EQ(conveyor_write_commit(conv, 5), 5);
+    EXPECT_EQ(conveyor_write_commit(conv, 0), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EINVAL);
+
+    ASSERT_EQ(conveyor_write(conv, "!", 1), 1);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    EXPECT_EQ(std::string(mock->data.begin(), mock->data.end()), "hello!");
+}
+
+// A reservation larger than the free space grows the ring the same way a
+// large conveyor_write would.
+TEST_F(ConveyorWritePathTest, ReserveGrowsRing) {
+    auto cfg = make_config(64 * 1024);
+    cfg.initial_write_size = 1024;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    auto data = make_pattern(8000);
+    conveyor_iovec_t segs[2];
+    int nsegs = 0;
+    ASSERT_EQ(conveyor_write_reserve(conv, data.size(), segs, &nsegs), (ssize_t)data.size());
+    fill_segments(segs, nsegs, data.data());
+    ASSERT_EQ(conveyor_write_commit(conv, data.size()), (ssize_t)data.size());
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), data.size()), 0);
+
+    EXPECT_EQ(conveyor_write_reserve(conv, 128 * 1024, segs, &nsegs), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EMSGSIZE);
+}
+
+// Another writer waits for an outstanding reservation instead of writing
+// over the reserved bytes.
+TEST_F(ConveyorWritePathTest, ReserveHoldsOffOtherWriters) {
+    auto cfg = make_config(4096);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    conveyor_iovec_t segs[2];
+    int nsegs = 0;
+    ASSERT_EQ(conveyor_write_reserve(conv, 4, segs, &nsegs), 4);
+
+    std::atomic<bool> writer_done{false};
+    std::thread writer([&] {
+        conveyor_write(conv, "BBBB", 4);
+        writer_done = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(writer_done.load());
+
+    std::memcpy(segs[0].iov_base, "AAAA", 4);
+    ASSERT_EQ(conveyor_write_commit(conv, 4), 4);
+    writer.join();
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    EXPECT_EQ(std::string(mock->data.begin(), mock->data.end()), "AAAABBBB");
+}
+
+TEST_F(ConveyorWritePathTest, LatencyHistogramPercentiles) {
+    libconveyor::LatencyHistogram h;
+    for (uint64_t ns = 1; ns <= 100000; ++ns) h.record(ns * 1000); // 1 us .. 100 ms
+    libconveyor::LatencyHistogram::Snapshot snap;
+    h.take(snap);
+    EXPECT_EQ(snap.count, 100000u);
+    EXPECT_EQ(snap.max, 100000000u);
+    EXPECT_NEAR(snap.percentile(0.50), 50e6, 50e6 * 0.04);
+    EXPECT_NEAR(snap.percentile(0.99), 99e6, 99e6 * 0.04);
+    EXPECT_NEAR(snap.percentile(0.999), 99.9e6, 99.9e6 * 0.04);
+    EXPECT_LE(snap.percentile(1.0), snap.max);
+
+    // take() starts a new window.
+    h.take(snap);
+    EXPECT_EQ(snap.count, 0u);
+    EXPECT_EQ(snap.percentile(0.5), 0u);
+}
+
+TEST_F(ConveyorWritePathTest, StatsExReportsLatencyPercentiles) {
+    auto cfg = make_config(4096);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 5;
+    auto data = make_pattern(64);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+        ASSERT_EQ(conveyor_flush(conv), 0);
+    }
+
+    conveyor_stats_ex_t stats;
+    ASSERT_EQ(conveyor_get_stats_ex(conv, &stats), 0);
+    EXPECT_EQ(stats.basic.bytes_written, 4 * data.size());
+    EXPECT_EQ(stats.write_call.count, 4u);
+    EXPECT_EQ(stats.backend_write.count, 4u);
+    EXPECT_GE(stats.backend_write.p50_ns, 5000000u);
+    EXPECT_LE(stats.backend_write.p50_ns, stats.backend_write.p99_ns);
+    EXPECT_LE(stats.backend_write.p99_ns, stats.backend_write.p999_ns);
+    EXPECT_LE(stats.backend_write.p999_ns, stats.backend_write.max_ns);
+    // Buffered writes return without waiting for the backend.
+    EXPECT_LT(stats.write_call.p50_ns, stats.backend_write.p50_ns);
+    EXPECT_EQ(stats.read_call.count, 0u);
+
+    ASSERT_EQ(conveyor_get_stats_ex(conv, &stats), 0);
+    EXPECT_EQ(stats.backend_write.count, 0u);
+    EXPECT_EQ(stats.backend_write.max_ns, 0u);
+}
+
+static void count_trace_event(void* context, const conveyor_trace_record_t*) {
+    static_cast<std::atomic<int>*>(context)->fetch_add(1);
+}
+
+TEST_F(ConveyorWritePathTest, TracesWritePathAndExportsChromeTrace) {
+    auto cfg = make_config(4096);
+    cfg.trace_callback = count_trace_event;
+    cfg.trace_context = &callbacks;
+    cfg.trace_log_events = 1024;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 5;
+    auto data = make_pattern(100);
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    std::vector<conveyor_trace_record_t> records(1024);
+    ssize_t n = conveyor_trace_read(conv, records.data(), records.size());
+    ASSERT_GT(n, 0);
+    EXPECT_EQ(callbacks.load(), n);
+    std::vector<conveyor_trace_event_t> seen;
+    for (ssize_t i = 0; i < n; ++i) {
+        seen.push_back(records[i].event);
+        if (records[i].event == CONVEYOR_TRACE_BACKEND_WRITE_END) {
+            EXPECT_EQ(records[i].bytes, data.size());
+            EXPECT_GE(records[i].duration_ns, 5000000u);
+        }
+    }
+    const conveyor_trace_event_t expected[] = {
+        CONVEYOR_TRACE_ENQUEUE, CONVEYOR_TRACE_DEQUEUE, CONVEYOR_TRACE_BACKEND_WRITE_BEGIN,
+        CONVEYOR_TRACE_BACKEND_WRITE_END, CONVEYOR_TRACE_FLUSH_BEGIN, CONVEYOR_TRACE_FLUSH_END};
+    for (conveyor_trace_event_t ev : expected)
+        EXPECT_NE(std::find(seen.begin(), seen.end(), ev), seen.end()) << "missing event " << ev;
+    EXPECT_EQ(conveyor_trace_read(conv, records.data(), records.size()), 0); // Drained
+
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    std::string path = ::testing::TempDir() + "conveyor_trace.json";
+    ASSERT_EQ(conveyor_trace_export_chrome(conv, path.c_str()), 0);
+    FILE* f = std::fopen(path.c_str(), "r");
+    ASSERT_NE(f, nullptr);
+    std::string json;
+    char buf[512];
+    size_t got;
+    while ((got = std::fread(buf, 1, sizeof(buf), f)) > 0) json.append(buf, got);
+    std::fclose(f);
+    std::remove(path.c_str());
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(json.find("\"name\":\"backend_write\",\"cat\":\"conveyor\",\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"enqueue\""), std::string::npos);
+}
+
+TEST_F(ConveyorWritePathTest, TraceApiNeedsALog) {
+    auto cfg = make_config(4096);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    conveyor_trace_record_t record;
+    errno = 0;
+    EXPECT_EQ(conveyor_trace_read(conv, &record, 1), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EINVAL);
+}
+
+static void count_writable(void* context) {
+    static_cast<std::atomic<int>*>(context)->fetch_add(1);
+}
+
+static bool wait_for_count(const std::atomic<int>& n, int expected) {
+    for (int i = 0; i < 400 && n.load() < expected; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    return n.load() >= expected;
+}
+
+TEST_F(ConveyorWritePathTest, BackpressureFailReturnsEagainAndSignalsWritable) {
+    std::atomic<int> writable{0};
+    auto cfg = make_config(4096);
+    cfg.write_backpressure = CONVEYOR_BACKPRESSURE_FAIL;
+    cfg.writable_callback = count_writable;
+    cfg.writable_context = &writable;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+#ifdef __linux__
+    int fd = conveyor_writable_fd(conv);
+    ASSERT_GE(fd, 0);
+#endif
+
+    mock->write_delay_ms = 50;
+    auto data = make_pattern(4096);
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    errno = 0;
+    EXPECT_EQ(conveyor_write(conv, data.data(), 100), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EAGAIN);
+    EXPECT_EQ(writable.load(), 0);
+
+    ASSERT_TRUE(wait_for_count(writable, 1));
+#ifdef __linux__
+    uint64_t signalled = 0;
+    EXPECT_EQ(::read(fd, &signalled, sizeof(signalled)), (ssize_t)sizeof(signalled));
+    EXPECT_EQ(signalled, 1u);
+#endif
+    EXPECT_EQ(conveyor_write(conv, data.data(), 100), 100);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    EXPECT_EQ(writable.load(), 1); // Only a refusal arms it
+}
+
+TEST_F(ConveyorWritePathTest, BackpressurePartialTakesWhatFits) {
+    auto cfg = make_config(4096);
+    cfg.write_backpressure = CONVEYOR_BACKPRESSURE_PARTIAL;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 50;
+    auto data = make_pattern(6000);
+    ASSERT_EQ(conveyor_write(conv, data.data(), 3000), 3000);
+    ASSERT_EQ(conveyor_write(conv, data.data() + 3000, 3000), 1096);
+    errno = 0;
+    EXPECT_EQ(conveyor_write(conv, data.data() + 4096, 1000), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EAGAIN);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    // Larger than the whole buffer: the first max_write_size bytes go in.
+    EXPECT_EQ(conveyor_write(conv, data.data() + 4096, 6000 - 4096), 6000 - 4096);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    std::vector<char> big(8192, 'z');
+    EXPECT_EQ(conveyor_write(conv, big.data(), big.size()), 4096);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    ASSERT_EQ(mock->data.size(), 6000u + 4096u);
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), 6000), 0);
+}
+
+TEST_F(ConveyorWritePathTest, BackpressureBlockHonoursTimeout) {
+    auto cfg = make_config(4096);
+    cfg.write_timeout_ms = 50;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 500;
+    auto data = make_pattern(4096);
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    auto start = std::chrono::steady_clock::now();
+    errno = 0;
+    EXPECT_EQ(conveyor_write(conv, data.data(), 100), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, ETIMEDOUT);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(400));
+    mock->write_delay_ms = 0;
+}
+
+struct BarrierResult {
+    MockStorage* mock;
+    std::atomic<int> fired{0};
+    std::atomic<int> last_error{-1};
+    std::atomic<size_t> stored{0}; // Bytes in storage when it fired
+};
+
+static void on_barrier(void* context, int error) {
+    auto* r = static_cast<BarrierResult*>(context);
+    {
+        std::lock_guard<std::mutex> lock(r->mock->mx);
+        r->stored = r->mock->data.size();
+    }
+    r->last_error = error;
+    r->fired++;
+}
+
+TEST_F(ConveyorWritePathTest, FlushAsyncFiresOnceWritesReachStorage) {
+    auto cfg = make_config(64 * 1024);
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    // Nothing pending: called back before it returns.
+    BarrierResult idle{mock};
+    ASSERT_EQ(conveyor_flush_async(conv, on_barrier, &idle), 0);
+    EXPECT_EQ(idle.fired.load(), 1);
+    EXPECT_EQ(idle.last_error.load(), 0);
+
+    mock->write_delay_ms = 50;
+    auto data = make_pattern(8192);
+    ASSERT_EQ(conveyor_write(conv, data.data(), 4096), 4096);
+    ASSERT_EQ(conveyor_write(conv, data.data() + 4096, 4096), 4096);
+    BarrierResult result{mock};
+    ASSERT_EQ(conveyor_flush_async(conv, on_barrier, &result), 0);
+    EXPECT_EQ(result.fired.load(), 0);
+    ASSERT_TRUE(wait_for_count(result.fired, 1));
+    EXPECT_EQ(result.last_error.load(), 0);
+    EXPECT_EQ(result.stored.load(), data.size());
+
+    errno = 0;
+    EXPECT_EQ(conveyor_flush_async(conv, nullptr, nullptr), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EINVAL);
+}
+
+// Barriers that pass together are made durable by a single fsync.
+TEST_F(ConveyorWritePathTest, FsyncBarriersShareOneSync) {
+    auto cfg = make_config(64 * 1024);
+    cfg.ops.fsync = MockStorage::fsync_callback;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 50;
+    auto data = make_pattern(4096);
+    ASSERT_EQ(conveyor_write(conv, data.data(), data.size()), (ssize_t)data.size());
+    std::vector<std::unique_ptr<BarrierResult>> results;
+    for (int i = 0; i < 5; ++i) {
+        results.emplace_back(new BarrierResult{mock});
+        ASSERT_EQ(conveyor_fsync_async(conv, on_barrier, results.back().get()), 0);
+    }
+    ASSERT_EQ(conveyor_fsync(conv), 0);
+    EXPECT_EQ(mock->fsync_calls.load(), 1);
+    for (auto& r : results) {
+        EXPECT_EQ(r->fired.load(), 1);
+        EXPECT_EQ(r->last_error.load(), 0);
+        EXPECT_EQ(r->stored.load(), data.size());
+    }
+
+    // A failed fsync reaches the callers and sticks.
+    mock->next_fsync_error = EIO;
+    errno = 0;
+    EXPECT_EQ(conveyor_fsync(conv), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EIO);
+    EXPECT_EQ(conveyor_write(conv, data.data(), 16), LIBCONVEYOR_ERROR);
+}
+
+TEST_F(ConveyorWritePathTest, WritevQueuesOneRequest) {
+    auto cfg = make_config(64 * 1024);
+    cfg.flags = O_RDWR;
+    cfg.initial_read_size = 4096;
+    cfg.max_read_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 30;
+    std::string header = "HDR:", payload(5000, 'p'), trailer = ":END";
+    conveyor_iovec_t iov[3] = {{&header[0], header.size()}, {&payload[0], payload.size()},
+                               {&trailer[0], trailer.size()}};
+    std::string expected = header + payload + trailer;
+    ASSERT_EQ(conveyor_writev(conv, iov, 3), (ssize_t)expected.size());
+
+    // Still pending: a read sees it through the snoop, across segments.
+    std::vector<char> back(expected.size());
+    ASSERT_EQ(conveyor_pread(conv, back.data(), back.size(), 0), (ssize_t)back.size());
+    EXPECT_EQ(std::string(back.begin(), back.end()), expected);
+
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    EXPECT_EQ(mock->pwrite_calls.load(), 1);
+    EXPECT_EQ(std::string(mock->data.begin(), mock->data.end()), expected);
+}
+
+// Scattered entries that tile a range reach storage as one ascending write,
+// and the file position is left alone.
+TEST_F(ConveyorWritePathTest, SubmitBatchSortsScatteredWritesForCoalescing) {
+    auto cfg = make_config(64 * 1024);
+    cfg.max_coalesce_size = 1024 * 1024;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    const size_t block = 512;
+    const size_t blocks = 64;
+    auto data = make_pattern(block * blocks);
+    std::vector<conveyor_io_t> ios(blocks);
+    for (size_t i = 0; i < blocks; ++i) {
+        size_t b = (i * 37) % blocks; // A permutation of the blocks
+        ios[i] = {static_cast<off_t>(b * block), data.data() + b * block, block, 0, 0};
+    }
+    ASSERT_EQ(conveyor_submit_batch(conv, ios.data(), ios.size()), (ssize_t)blocks);
+    for (const auto& io : ios) {
+        EXPECT_EQ(io.result, (ssize_t)block);
+        EXPECT_EQ(io.error, 0);
+    }
+    EXPECT_EQ(conveyor_lseek(conv, 0, SEEK_CUR), 0);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+
+    EXPECT_EQ(mock->pwrite_calls.load(), 1);
+    ASSERT_EQ(mock->data.size(), data.size());
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), data.size()), 0);
+}
+
+// Overlapping entries keep their order, so the later one wins, and reads
+// see them while they are still pending.
+TEST_F(ConveyorWritePathTest, SubmitBatchKeepsOrderOfOverlappingEntries) {
+    auto cfg = make_config(64 * 1024);
+    cfg.flags = O_RDWR;
+    cfg.initial_read_size = 4096;
+    cfg.max_read_size = 4096;
+    cfg.max_coalesce_size = 64 * 1024;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 30;
+    std::string inner(10, 'i'), outer(40, 'o'), tail(5, 't');
+    conveyor_io_t ios[3] = {{20, inner.data(), inner.size(), 0, 0},
+                            {10, outer.data(), outer.size(), 0, 0},
+                            {50, tail.data(), tail.size(), 0, 0}};
+    ASSERT_EQ(conveyor_submit_batch(conv, ios, 3), 3);
+    std::string expected = std::string(10, '\0') + outer + tail;
+
+    std::vector<char> back(expected.size());
+    ASSERT_EQ(conveyor_pread(conv, back.data(), back.size(), 0), (ssize_t)back.size());
+    EXPECT_EQ(std::string(back.begin(), back.end()), expected);
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    EXPECT_EQ(std::string(mock->data.begin(), mock->data.end()), expected);
+}
+
+TEST_F(ConveyorWritePathTest, SubmitBatchReportsPerEntryResults) {
+    auto cfg = make_config(4096);
+    cfg.write_backpressure = CONVEYOR_BACKPRESSURE_PARTIAL;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+
+    mock->write_delay_ms = 50;
+    auto data = make_pattern(8192);
+    conveyor_io_t ios[5] = {{0, data.data(), 2000, 0, 0},
+                            {-1, data.data(), 10, 0, 0},
+                            {2000, data.data() + 2000, 2000, 0, 0},
+                            {9000, data.data(), 8192, 0, 0},
+                            {4000, data.data() + 4000, 2000, 0, 0}};
+    errno = 0;
+    ASSERT_EQ(conveyor_submit_batch(conv, ios, 5), 2);
+    EXPECT_EQ(ios[0].result, 2000);
+    EXPECT_EQ(ios[2].result, 2000);
+    EXPECT_EQ(ios[1].result, LIBCONVEYOR_ERROR);
+    EXPECT_EQ(ios[1].error, EINVAL);
+    EXPECT_EQ(ios[3].result, LIBCONVEYOR_ERROR);
+    EXPECT_EQ(ios[3].error, EMSGSIZE);
+    // Only part of the ring was left for the last one, which is not split.
+    EXPECT_EQ(ios[4].result, LIBCONVEYOR_ERROR);
+    EXPECT_EQ(ios[4].error, EAGAIN);
+    EXPECT_EQ(errno, EAGAIN);
+
+    ASSERT_EQ(conveyor_flush(conv), 0);
+    ASSERT_EQ(mock->data.size(), 4000u);
+    EXPECT_EQ(std::memcmp(mock->data.data(), data.data(), 4000), 0);
+
+    // A read-only conveyor refuses the whole batch.
+    conveyor_destroy(conv);
+    cfg.flags = O_RDONLY;
+    cfg.initial_read_size = 4096;
+    conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    EXPECT_EQ(conveyor_submit_batch(conv, ios, 1), LIBCONVEYOR_ERROR);
+    EXPECT_EQ(errno, EBADF);
+    EXPECT_EQ(ios[0].error, EBADF);
+}
@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include "libconveyor/conveyor.h"
 
 // Simulates a slow disk to force race conditions
@@ -16,12 +18,31 @@ struct MockStorage {
     std::atomic<int> next_write_error{0};
     std::atomic<int> read_delay_ms{0};
     std::atomic<int> write_delay_ms{0};
+    std::atomic<int> pwrite_calls{0};
+    std::atomic<size_t> max_pwrite_size{0};
+    std::atomic<int> inflight_writes{0};
+    std::atomic<int> max_inflight_writes{0};
+    std::atomic<int> pread_calls{0};
+    std::atomic<int> inflight_reads{0};
+    std::atomic<int> max_inflight_reads{0};
+    std::atomic<int> read_jitter_ms{0}; // Extra random delay in [0, n) per pread
+    std::atomic<int> pwritev_calls{0};
+    std::atomic<int> max_pwritev_iovcnt{0};
+    std::atomic<size_t> pwritev_short_limit{0}; // Cap bytes per pwritev call (0 = none)
+    std::atomic<size_t> bytes_written{0}; // Through pwrite
+    std::atomic<int> fsync_calls{0};
+    std::atomic<int> fsync_delay_ms{0};
+    std::atomic<int> next_fsync_error{0};
 
     MockStorage(size_t size) : data(size, 0) {}
 
     static ssize_t pwrite_callback(storage_handle_t h, const void* buf, size_t count, off_t offset) {
         auto* self = reinterpret_cast<MockStorage*>(h);
+        int inflight = ++self->inflight_writes;
+        int seen = self->max_inflight_writes.load();
+        while (inflight > seen && !self->max_inflight_writes.compare_exchange_weak(seen, inflight)) {}
         if (self->write_delay_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(self->write_delay_ms));
+        struct InflightGuard { std::atomic<int>& n; ~InflightGuard() { --n; } } guard{self->inflight_writes};
 
         std::lock_guard<std::mutex> lock(self->mx);
         if (self->next_write_error != 0) {
@@ -29,6 +50,9 @@ struct MockStorage {
             self->next_write_error = 0;
             return -1;
         }
+        self->pwrite_calls++;
+        self->bytes_written += count;
+        if (count > self->max_pwrite_size) self->max_pwrite_size = count;
         if (offset + count > self->data.size()) self->data.resize(offset + count);
         std::memcpy(self->data.data() + offset, buf, count);
         return count;
@@ -36,7 +60,13 @@ struct MockStorage {
 
     static ssize_t pread_callback(storage_handle_t h, void* buf, size_t count, off_t offset) {
         auto* self = reinterpret_cast<MockStorage*>(h);
+        self->pread_calls++;
+        int inflight = ++self->inflight_reads;
+        int seen = self->max_inflight_reads.load();
+        while (inflight > seen && !self->max_inflight_reads.compare_exchange_weak(seen, inflight)) {}
+        struct InflightGuard { std::atomic<int>& n; ~InflightGuard() { --n; } } guard{self->inflight_reads};
         if (self->read_delay_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(self->read_delay_ms));
+        if (self->read_jitter_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(std::rand() % self->read_jitter_ms));
 
         std::lock_guard<std::mutex> lock(self->mx);
         if (offset >= (off_t)self->data.size()) return 0;
@@ -45,6 +75,38 @@ struct MockStorage {
         return available;
     }
 
+    static ssize_t pwritev_callback(storage_handle_t h, const conveyor_iovec_t* iov, int iovcnt, off_t offset) {
+        auto* self = reinterpret_cast<MockStorage*>(h);
+        if (self->write_delay_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(self->write_delay_ms));
+
+        std::lock_guard<std::mutex> lock(self->mx);
+        self->pwritev_calls++;
+        if (iovcnt > self->max_pwritev_iovcnt) self->max_pwritev_iovcnt = iovcnt;
+        size_t limit = self->pwritev_short_limit;
+        size_t written = 0;
+        for (int i = 0; i < iovcnt; ++i) {
+            size_t len = iov[i].iov_len;
+            if (limit > 0 && written + len > limit) len = limit - written;
+            if (offset + written + len > self->data.size()) self->data.resize(offset + written + len);
+            std::memcpy(self->data.data() + offset + written, iov[i].iov_base, len);
+            written += len;
+            if (limit > 0 && written == limit) break;
+        }
+        return written;
+    }
+
+    static int fsync_callback(storage_handle_t h) {
+        auto* self = reinterpret_cast<MockStorage*>(h);
+        if (self->fsync_delay_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(self->fsync_delay_ms));
+        self->fsync_calls++;
+        int err = self->next_fsync_error.exchange(0);
+        if (err != 0) {
+            errno = err;
+            return -1;
+        }
+        return 0;
+    }
+
     static off_t lseek_callback(storage_handle_t h, off_t offset, int whence) {
         auto* self = reinterpret_cast<MockStorage*>(h);
         std::lock_guard<std::mutex> lock(self->mx);
@@ -56,6 +118,10 @@ struct MockStorage {
     storage_operations_t get_ops() {
         return { pwrite_callback, pread_callback, lseek_callback };
     }
+
+    storage_operations_t get_vectored_ops() {
+        return { pwrite_callback, pread_callback, lseek_callback, pwritev_callback };
+    }
 };
 
 #endif
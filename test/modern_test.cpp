@@ -2,6 +2,10 @@
 #include "mock_storage.hpp"
 #include "libconveyor/conveyor_modern.hpp"
 
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+
 TEST(ModernApiTest, VectorWriteAndRead) {
     MockStorage mock(4096);
     auto ops = mock.get_ops();
@@ -39,3 +43,256 @@ TEST(ModernApiTest, VectorWriteAndRead) {
     EXPECT_EQ(read_back[0], 1);
     EXPECT_EQ(read_back[3], 4);
 }
+
+TEST(ModernApiTest, ReadViewReleasesOnScopeExit) {
+    MockStorage mock(0);
+    std::string content = "zero-copy view of the read buffer";
+    mock.data.assign(content.begin(), content.end());
+
+    libconveyor::v2::Config cfg;
+    cfg.handle = (storage_handle_t)&mock;
+    cfg.ops = mock.get_ops();
+    cfg.open_flags = O_RDONLY;
+    cfg.read_capacity = 4096;
+
+    auto res = libconveyor::v2::Conveyor::create(cfg);
+    ASSERT_TRUE(res);
+    auto conveyor = std::move(res.value());
+
+    {
+        auto view = conveyor.read_view(9);
+        ASSERT_TRUE(view);
+        std::string got;
+        for (size_t i = 0; i < view.value().segment_count(); ++i) {
+            auto seg = view.value().segment(i);
+            got.append(seg.begin(), seg.end());
+        }
+        EXPECT_EQ(got, "zero-copy");
+    }
+
+    std::string rest(content.size() - 9, '\0');
+    auto read_res = conveyor.read(rest);
+    ASSERT_TRUE(read_res);
+    EXPECT_EQ(rest, content.substr(9));
+
+    auto eof = conveyor.read_view(10);
+    ASSERT_TRUE(eof);
+    EXPECT_TRUE(eof.value().empty());
+}
+
+TEST(ModernApiTest, WriteReservationCommitsOrCancels) {
+    MockStorage mock(0);
+
+    libconveyor::v2::Config cfg;
+    cfg.handle = (storage_handle_t)&mock;
+    cfg.ops = mock.get_ops();
+    cfg.open_flags = O_WRONLY;
+    cfg.write_capacity = 4096;
+
+    auto res = libconveyor::v2::Conveyor::create(cfg);
+    ASSERT_TRUE(res);
+    auto conveyor = std::move(res.value());
+
+    {
+        auto r = conveyor.reserve(16);
+        ASSERT_TRUE(r);
+        r.value().fill(0, "dropped", 7);
+        // Goes out of scope uncommitted: cancelled.
+    }
+    {
+        auto r = conveyor.reserve(16);
+        ASSERT_TRUE(r);
+        r.value().fill(0, "record", 6);
+        auto c = r.value().commit(6);
+        ASSERT_TRUE(c);
+        EXPECT_EQ(c.value(), 6u);
+    }
+    ASSERT_TRUE(conveyor.flush());
+    EXPECT_EQ(std::string(mock.data.begin(), mock.data.end()), "record");
+}
+
+TEST(ModernApiTest, PositionalReadWrite) {
+    MockStorage mock(0);
+
+    libconveyor::v2::Config cfg;
+    cfg.handle = (storage_handle_t)&mock;
+    cfg.ops = mock.get_ops();
+    cfg.write_capacity = 4096;
+    cfg.read_capacity = 4096;
+
+    auto res = libconveyor::v2::Conveyor::create(cfg);
+    ASSERT_TRUE(res);
+    auto conveyor = std::move(res.value());
+
+    std::string tail = "world";
+    std::string head = "hello ";
+    ASSERT_TRUE(conveyor.pwrite(tail, 6));
+    ASSERT_TRUE(conveyor.pwrite(head, 0));
+
+    std::string out(11, '\0');
+    auto r = conveyor.pread(out, 0);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r.value(), 11u);
+    EXPECT_EQ(out, "hello world");
+}
+
+TEST(ModernApiTest, SharedExecutor) {
+    auto pool = libconveyor::v2::Executor::create(2);
+    ASSERT_TRUE(pool);
+
+    MockStorage mock(0);
+    libconveyor::v2::Config cfg;
+    cfg.handle = (storage_handle_t)&mock;
+    cfg.ops = mock.get_ops();
+    cfg.write_capacity = 4096;
+    cfg.read_capacity = 4096;
+    cfg.executor = pool.value().get();
+
+    {
+        auto res = libconveyor::v2::Conveyor::create(cfg);
+        ASSERT_TRUE(res);
+        auto conveyor = std::move(res.value());
+        std::string msg = "pooled";
+        ASSERT_TRUE(conveyor.write(msg));
+        ASSERT_TRUE(conveyor.seek(0));
+        std::string out(msg.size(), '\0');
+        auto read_res = conveyor.read(out);
+        ASSERT_TRUE(read_res);
+        EXPECT_EQ(out, msg);
+    }
+}
+
+TEST(ModernApiTest, FsyncAsyncResolvesFuture) {
+    MockStorage mock(0);
+    libconveyor::v2::Config cfg;
+    cfg.handle = (storage_handle_t)&mock;
+    cfg.ops = mock.get_ops();
+    cfg.ops.fsync = MockStorage::fsync_callback;
+    cfg.write_capacity = 4096;
+
+    auto res = libconveyor::v2::Conveyor::create(cfg);
+    ASSERT_TRUE(res);
+    auto conveyor = std::move(res.value());
+
+    std::string record = "durable";
+    ASSERT_TRUE(conveyor.write(record));
+    auto done = conveyor.fsync_async();
+    ASSERT_EQ(done.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_FALSE(done.get());
+    EXPECT_EQ(mock.fsync_calls.load(), 1);
+    EXPECT_EQ(std::string(mock.data.begin(), mock.data.end()), "durable");
+}
+
+TEST(ModernApiTest, GatherWriteAndScatterRead) {
+    MockStorage mock(0);
+    libconveyor::v2::Config cfg;
+    cfg.handle = (storage_handle_t)&mock;
+    cfg.ops = mock.get_ops();
+    cfg.write_capacity = 4096;
+    cfg.read_capacity = 4096;
+
+    auto res = libconveyor::v2::Conveyor::create(cfg);
+    ASSERT_TRUE(res);
+    auto conveyor = std::move(res.value());
+
+    std::string a = "head|", b = "body|", c = "tail";
+    using CSpan = libconveyor::v2::Span<const char>;
+    auto w = conveyor.writev({CSpan(a.data(), a.size()), CSpan(b.data(), b.size()),
+                              CSpan(c.data(), c.size())});
+    ASSERT_TRUE(w);
+    EXPECT_EQ(w.value(), 14u);
+    ASSERT_TRUE(conveyor.flush());
+    EXPECT_EQ(mock.pwrite_calls.load(), 1);
+
+    ASSERT_TRUE(conveyor.seek(0));
+    char x[5], y[9];
+    using Span = libconveyor::v2::Span<char>;
+    auto r = conveyor.readv({Span(x, sizeof(x)), Span(y, sizeof(y))});
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r.value(), 14u);
+    EXPECT_EQ(std::string(x, 5) + std::string(y, 9), "head|body|tail");
+}
+
+// Metrics keep counting across scrapes while stats() windows still reset.
+TEST(ModernApiTest, MetricsAreCumulative) {
+    MockStorage mock(0);
+    libconveyor::v2::Config cfg;
+    cfg.handle = (storage_handle_t)&mock;
+    cfg.ops = mock.get_ops();
+    cfg.write_capacity = 4096;
+    cfg.read_capacity = 4096;
+
+    auto res = libconveyor::v2::Conveyor::create(cfg);
+    ASSERT_TRUE(res);
+    auto conveyor = std::move(res.value());
+
+    std::string data(1000, 'm');
+    ASSERT_TRUE(conveyor.write(data));
+    ASSERT_TRUE(conveyor.flush());
+    auto first = conveyor.metrics();
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first.value().version, (unsigned)CONVEYOR_METRICS_VERSION);
+    EXPECT_EQ(first.value().bytes_written, 1000u);
+    EXPECT_GE(first.value().backend_writes, 1u);
+    EXPECT_GE(first.value().flushes, 1u);
+    EXPECT_EQ(first.value().write_capacity, 4096u);
+    EXPECT_EQ(first.value().write_buffered, 0u);
+
+    EXPECT_EQ(conveyor.stats().bytes_written, 1000u);
+    EXPECT_EQ(conveyor.stats().bytes_written, 0u); // The window was reset
+
+    ASSERT_TRUE(conveyor.write(data));
+    ASSERT_TRUE(conveyor.flush());
+    EXPECT_EQ(conveyor.metrics().value().bytes_written, 2000u);
+    EXPECT_EQ(conveyor.metrics().value().bytes_written, 2000u);
+    EXPECT_EQ(conveyor.stats().bytes_written, 1000u);
+}
+
+// A caller built against a shorter struct gets only its prefix.
+TEST(ModernApiTest, MetricsFillOnlyTheCallersPrefix) {
+    MockStorage mock(0);
+    conveyor_config_t cfg = {0};
+    cfg.handle = &mock;
+    cfg.flags = O_WRONLY;
+    cfg.ops = mock.get_ops();
+    cfg.initial_write_size = 4096;
+    conveyor_t* conv = conveyor_create(&cfg);
+    ASSERT_NE(conv, nullptr);
+    ASSERT_EQ(conveyor_write(conv, "abc", 3), 3);
+
+    conveyor_metrics_t partial;
+    std::memset(&partial, 0xff, sizeof(partial));
+    size_t known = offsetof(conveyor_metrics_t, bytes_read);
+    ASSERT_EQ(conveyor_get_metrics(conv, &partial, known), 0);
+    EXPECT_EQ(partial.version, (unsigned)CONVEYOR_METRICS_VERSION);
+    EXPECT_EQ(partial.bytes_written, 3u);
+    EXPECT_EQ(partial.bytes_read, ~0ull);
+    EXPECT_EQ(conveyor_get_metrics(conv, &partial, 1), -1);
+    EXPECT_EQ(errno, EINVAL);
+    conveyor_destroy(conv);
+}
+
+TEST(ModernApiTest, PrometheusTextExport) {
+    conveyor_metrics_t a = {};
+    a.bytes_written = 4096;
+    a.backend_write_ns = 1500000000ull;
+    a.write_capacity = 65536;
+    conveyor_metrics_t b = {};
+    b.bytes_written = 7;
+
+    std::string text = libconveyor::v2::prometheus_text({{"log", a}, {"odd\"name", b}}, "app");
+    EXPECT_NE(text.find("# TYPE app_bytes_written_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("app_bytes_written_total{conveyor=\"log\"} 4096\n"), std::string::npos);
+    EXPECT_NE(text.find("app_bytes_written_total{conveyor=\"odd\\\"name\"} 7\n"), std::string::npos);
+    EXPECT_NE(text.find("app_backend_write_seconds_total{conveyor=\"log\"} 1.500000000\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("# TYPE app_write_capacity_bytes gauge\n"), std::string::npos);
+    EXPECT_NE(text.find("app_write_capacity_bytes{conveyor=\"log\"} 65536\n"), std::string::npos);
+
+    // One HELP/TYPE pair per metric, however many conveyors there are.
+    size_t types = 0;
+    for (size_t at = text.find("# TYPE "); at != std::string::npos; at = text.find("# TYPE ", at + 1)) {
+        types++;
+    }
+    EXPECT_EQ(types, 25u);
+}